@@ -475,6 +475,21 @@ BGAV_PUBLIC
 void bgav_options_set_audio_dynrange(bgav_options_t* opt,
                                      int audio_dynrange);
 
+/** \ingroup options
+ *  \brief Pass uncompressed audio without copying
+ *  \param opt Option container
+ *  \param zerocopy 1 for enabling zero copy PCM frames
+ *
+ *  If enabled, audio frames of PCM streams, which are already in the
+ *  native sample format, point directly into the demuxed packets.
+ *  The samples are valid until the next read call for the same stream.
+ *  Disabled by default.
+ */
+
+BGAV_PUBLIC
+void bgav_options_set_pcm_zerocopy(bgav_options_t* opt,
+                                   int zerocopy);
+
 
 /** \ingroup options
  *  \brief Try to be sample accurate
@@ -501,6 +516,9 @@ void bgav_options_set_sample_accurate(bgav_options_t*opt, int enable);
  *  time needed for creating the index. Indices, whose creation takes
  *  longer than the specified time will be cached. If you set this to
  *  zero, all indices are cached.
+ *
+ *  The same applies to blocks of seekable http resources, which are spilled
+ *  to a temporary file when they drop out of the in-memory block cache.
  */
 
 BGAV_PUBLIC
@@ -513,6 +531,8 @@ void bgav_options_set_cache_time(bgav_options_t*opt, int t);
  *
  *  If a new index is created and the size becomes larger than
  *  the maximum size, older indices will be deleted. Zero means infinite.
+ *
+ *  This also limits the spill file of the http block cache.
  */
 
 BGAV_PUBLIC
@@ -565,14 +585,42 @@ void bgav_options_set_postprocessing_level(bgav_options_t* opt,
 /** \ingroup options
  *  \brief Set number of threads
  *  \param opt Option container
- *  \param threads Number of threads to use
+ *  \param threads Number of threads to use per decoder (0 = one per CPU, default)
  *
- *   Not all codecs support this
+ *  Not all codecs support this. The number can be reduced further
+ *  by \ref bgav_set_thread_limit.
  */
 
 BGAV_PUBLIC
 void bgav_options_set_threads(bgav_options_t * opt, int threads);
 
+#define BGAV_THREAD_TYPE_AUTO  0 //!< Let the codec decide
+#define BGAV_THREAD_TYPE_FRAME 1 //!< Decode multiple frames in parallel (adds latency)
+#define BGAV_THREAD_TYPE_SLICE 2 //!< Decode slices of one frame in parallel
+
+/** \ingroup options
+ *  \brief Set the threading method
+ *  \param opt Option container
+ *  \param thread_type One of the BGAV_THREAD_TYPE_* values
+ *
+ *  Currently only supported by the ffmpeg video decoders.
+ */
+
+BGAV_PUBLIC
+void bgav_options_set_thread_type(bgav_options_t * opt, int thread_type);
+
+/** \ingroup options
+ *  \brief Limit the total number of decoding threads
+ *  \param num Maximum number of threads for all decoders of the process (0 = unlimited, default)
+ *
+ *  This is a global setting for all open \ref bgav_t instances.
+ *  Decoders, which are opened while the limit is reached, use only
+ *  one thread.
+ */
+
+BGAV_PUBLIC
+void bgav_set_thread_limit(int num);
+
   
 /** \ingroup options
  *  \brief Set DVB channels file
@@ -589,6 +637,24 @@ BGAV_PUBLIC
 void bgav_options_set_dvb_channels_file(bgav_options_t* opt,
                                         const char * file);
 
+/** \ingroup options
+ *  \brief Open all programs of an MPEG transport stream as one track
+ *  \param opt Option container
+ *  \param enable 1 to enable, 0 to disable (default)
+ *
+ *  By default, each program of a transport stream is a separate track.
+ *  If this is enabled, the streams of all programs are put into one track,
+ *  so several programs can be decoded while reading the file only once.
+ *  The program number of each stream is stored in the stream metadata
+ *  (see \ref BGAV_META_PROGRAM).
+ */
+
+BGAV_PUBLIC
+void bgav_options_set_mpegts_all_programs(bgav_options_t* opt,
+                                          int enable);
+
+#define BGAV_META_PROGRAM "program" //!< Program number of a stream (integer)
+
 /** \ingroup options
  *  \brief Preference of ffmpeg demultiplexers
  *  \param opt Option container
@@ -614,13 +680,46 @@ BGAV_PUBLIC
 void bgav_options_set_dv_datetime(bgav_options_t* opt,
                                   int datetime);
 
+/** \ingroup options
+ *  \brief Enable image sequences
+ *  \param opt Option container
+ *  \param enable 1 to detect image sequences, 0 to open single images
+ *
+ *  If enabled, a local image file with a number in its name
+ *  (e.g. frame_000001.png), which is followed by files with consecutive
+ *  numbers, is opened as a video stream. Default is disabled.
+ */
+
+BGAV_PUBLIC
+void bgav_options_set_image_sequence(bgav_options_t* opt,
+                                     int enable);
+
+/** \ingroup options
+ *  \brief Set the framerate of image sequences
+ *  \param opt Option container
+ *  \param timescale Timescale
+ *  \param frame_duration Duration of one frame in timescale units
+ *
+ *  Image sequences (see \ref bgav_options_set_image_sequence)
+ *  are opened as a video stream with this framerate. Default is 25 fps.
+ */
+
+BGAV_PUBLIC
+void bgav_options_set_image_sequence_rate(bgav_options_t* opt,
+                                          int timescale, int frame_duration);
+
 /** \ingroup options
  *  \brief Shrink factor
  *  \param opt Option container
  *  \param factor Exponent of the shrink factor
  *
- *  This enables downscaling of images while decoding.
- *  Currently only supported for JPEG-2000.
+ *  This enables downscaling of images while decoding by a factor of
+ *  2^factor, which is useful for thumbnails and previews. Supported for
+ *  JPEG-2000 and for the DCT based codecs in libavcodec (MJPEG, MPEG-1/2/4,
+ *  DV etc.), where the factor is limited by the codec. The reduced size is
+ *  reported in the video format. Other libavcodec codecs (e.g. H.264, HEVC)
+ *  keep their size but skip the loop filter and, for factors above 2, the
+ *  IDCT of non-reference frames.
  */
 
 BGAV_PUBLIC
@@ -1017,7 +1116,29 @@ int bgav_open_callbacks(bgav_t * bgav,
                         void * priv,
                         const char * filename, const char * mimetype, int64_t total_bytes);
 
-  
+/** \ingroup opening
+ *  \brief Open a decoder from a memory region
+ *  \param bgav A decoder instance
+ *  \param data Start of the data
+ *  \param data_size Size of the data in bytes
+ *  \param free_func Called when the decoder doesn't need the memory anymore or NULL
+ *  \param free_priv Private argument for free_func
+ *  \param filename The filename of the input or NULL if this info is not known.
+ *  \param mimetype The mimetype of the input or NULL if this info is not known.
+ *  \returns 1 on success, 0 else.
+ *
+ *  The data are read directly from the region, which must stay valid
+ *  and unchanged until free_func is called. This happens when the
+ *  decoder is closed, also if this function fails. Use free_func to
+ *  unreference refcounted buffers.
+ */
+
+BGAV_PUBLIC
+int bgav_open_memory(bgav_t * bgav,
+                     const uint8_t * data, int64_t data_size,
+                     void (*free_func)(void * priv), void * free_priv,
+                     const char * filename, const char * mimetype);
+
 
 
 
@@ -2618,6 +2739,46 @@ int bgav_set_stream_action_all(bgav_t * bgav, int idx, bgav_stream_action_t acti
  */
   
 
+/***************************************************
+ * Performance counters
+ ***************************************************/
+
+/** \defgroup stats Performance counters
+ *
+ *  Each decoder instance counts, where the time is spent. The counters are
+ *  returned as a dictionary with the following children:
+ *
+ *  - "input": "bytes_read", "read_calls", "read_time", "seeks" and
+ *    "bytes_skipped" of the input
+ *  - "demuxer": "next_packet_calls" and "next_packet_time"
+ *  - "streams": Array with one dictionary per stream of the current track
+ *    containing "type", "index", "packets" and "bytes" (coming out of
+ *    the demuxer), "parser_bytes", "packets_reused" and "packets_new"
+ *    (packet buffer reuse), "frames" and "decode_time"
+ *
+ *  All times are in \ref GAVL_TIME_SCALE units. They are inclusive:
+ *  The decode time contains the demultiplexing time needed to get
+ *  the packets and the demultiplexing time contains the time for reading
+ *  from the input.
+ */
+
+/** \ingroup stats
+ *  \brief Get the performance counters
+ *  \param bgav A decoder handle
+ *  \param ret Returns the counters
+ */
+
+BGAV_PUBLIC
+void bgav_get_stats(bgav_t * bgav, gavl_dictionary_t * ret);
+
+/** \ingroup stats
+ *  \brief Reset the performance counters
+ *  \param bgav A decoder handle
+ */
+
+BGAV_PUBLIC
+void bgav_reset_stats(bgav_t * bgav);
+
 /***************************************************
  * Debugging functions
  ***************************************************/
@@ -70,6 +70,8 @@ typedef struct bgav_track_s bgav_track_t;
 
 typedef struct bgav_timecode_table_s bgav_timecode_table_t;
 
+typedef struct bgav_si_cursor_s bgav_si_cursor_t;
+
 #include <id3.h>
 #include <yml.h>
 #include <packettimer.h>
@@ -265,6 +267,21 @@ typedef struct
   
   } bgav_stream_video_t;
   
+/* Performance counters of a stream (see stats.c) */
+
+typedef struct
+  {
+  int64_t packets;        /* Packets coming out of the demuxer */
+  int64_t bytes;
+  int64_t parser_bytes;   /* Bytes passed through the parser */
+
+  int64_t packets_reused; /* Packets from the buffer with allocated memory */
+  int64_t packets_new;    /* Packets needing a new allocation */
+  
+  int64_t frames;         /* Decoded frames */
+  gavl_time_t decode_time;
+  } bgav_stream_counters_t;
+
 struct bgav_stream_s
   {
   gavl_dictionary_t in_info;
@@ -321,6 +338,9 @@ struct bgav_stream_s
   int first_index_position;
   int last_index_position;
   int index_position;
+
+  /* Own read cursor for non-interleaved files */
+  bgav_si_cursor_t * si_cursor;
   
   /* Where to get data */
   bgav_demuxer_context_t * demuxer;
@@ -352,6 +372,8 @@ struct bgav_stream_s
   int src_flags;
   
   gavl_stream_stats_t stats;
+
+  bgav_stream_counters_t counters;
   
   /*
    *  Timestamp of the first frame in *output* timescale
@@ -738,6 +760,7 @@ struct bgav_options_s
   char * default_subtitle_encoding;
   
   int audio_dynrange;
+  int pcm_zerocopy;
   int seamless;
 
   /* Postprocessing level (0.0 .. 1.0) */
@@ -746,15 +769,26 @@ struct bgav_options_s
 
   char * dvb_channels_file;
 
+  /* Put all programs of a transport stream into one track */
+  int mpegts_all_programs;
+
   /* Prefer ffmpeg demuxers over native demuxers */
   int prefer_ffmpeg_demuxers;
 
   int dv_datetime;
+
+  /* Framerate of image sequences */
+  int image_sequence;
+  int image_sequence_timescale;
+  int image_sequence_frame_duration;
   
   int shrink;
 
   int vaapi;
 
+  int threads;
+  int thread_type;
+
   int log_level;
 
   int dump_headers;
@@ -810,6 +844,15 @@ struct bgav_input_s
   
   int (*read_block)(bgav_input_context_t*);
   int (*seek_block)(bgav_input_context_t*, int64_t block);
+
+  /*
+   *  Inputs which have the whole stream in memory: Return a pointer
+   *  to the data at the current position and the number of bytes
+   *  available from there. Peeking and skipping use this to avoid
+   *  going through the input buffer.
+   */
+  
+  const uint8_t * (*get_ptr)(bgav_input_context_t*, int64_t * len);
   
   /*
    * Time based seek function for media, which are not stored
@@ -836,6 +879,18 @@ struct bgav_input_s
 #define BGAV_INPUT_SEEK_SLOW      (1<<4)
 #define BGAV_INPUT_PAUSED         (1<<5)
 
+/* Performance counters of an input (see stats.c) */
+
+typedef struct
+  {
+  int64_t bytes_read;
+  int64_t read_calls;
+  gavl_time_t read_time;
+  
+  int64_t seeks;
+  int64_t bytes_skipped;
+  } bgav_input_counters_t;
+
 struct bgav_input_context_s
   {
   gavl_buffer_t buf;
@@ -915,6 +970,8 @@ struct bgav_input_context_s
    */
   
   int64_t clock_time;
+
+  bgav_input_counters_t counters;
   };
 
 /* input.c */
@@ -1001,9 +1058,20 @@ void bgav_input_destroy(bgav_input_context_t * ctx);
 
 void bgav_input_skip(bgav_input_context_t *, int64_t);
 
+/* Add the performance counters of src to dst */
+void bgav_input_counters_add(bgav_input_counters_t * dst,
+                             const bgav_input_counters_t * src);
+
 /* Reopen  the input. Not all inputs can do this */
 int bgav_input_reopen(bgav_input_context_t*);
 
+/*
+ *  Open a second, independent context (own position and buffer)
+ *  for the same local file. Returns NULL for other inputs.
+ */
+
+bgav_input_context_t * bgav_input_clone(bgav_input_context_t*);
+
 BGAV_PUBLIC bgav_input_context_t * bgav_input_create(bgav_t * b, const bgav_options_t *);
 
 /* For debugging purposes only: if you encounter data,
@@ -1029,8 +1097,8 @@ void bgav_input_ensure_buffer_size(bgav_input_context_t * ctx, int len);
 
 /* Input module to read from memory */
 
-bgav_input_context_t * bgav_input_open_memory(uint8_t * data,
-                                              uint32_t data_size);
+bgav_input_context_t * bgav_input_open_memory(const uint8_t * data,
+                                              int64_t data_size);
 
 bgav_input_context_t * bgav_input_open_sub(bgav_input_context_t * src,
                                            int64_t start,
@@ -1041,8 +1109,8 @@ bgav_input_context_t * bgav_input_open_sub(bgav_input_context_t * src,
 bgav_input_context_t * bgav_input_open_as_buffer(bgav_input_context_t * input);
 
 void bgav_input_reopen_memory(bgav_input_context_t * ctx,
-                              uint8_t * data,
-                              uint32_t data_size);
+                              const uint8_t * data,
+                              int64_t data_size);
 
 
 /* Input module to read from a filedescriptor */
@@ -1057,6 +1125,25 @@ bgav_input_open_fd(int fd, int64_t total_bytes, const char * mimetype);
 
 #define BGAV_SUPERINDEX_INTERLEAVED (1<<0)
 
+/*
+ *  Read position for superindex packets. Small packets are read
+ *  in runs into buf, which holds the file data starting at buf_offset.
+ *  For non-interleaved files, each stream gets its own cursor
+ *  (and if possible its own input) so all streams read sequentially.
+ */
+
+struct bgav_si_cursor_s
+  {
+  bgav_input_context_t * input;
+  int own_input;
+  /* The own input adds its counters to this one when freed */
+  bgav_input_context_t * parent;
+  gavl_buffer_t buf;
+  int64_t buf_offset;
+  };
+
+void bgav_si_cursor_free(bgav_si_cursor_t * c);
+
 typedef struct 
   {
   int num_entries;
@@ -1241,6 +1328,10 @@ struct bgav_demuxer_s
    INDEX_MODE_SIMPLE, INDEX_MODE_MPEG or INDEX_MODE_PTS */
 #define INDEX_MODE_MIXED  7
 
+/* Single stream with constant packet sizes and durations:
+   The seek() method of the demuxer is exact, see bgav_demuxer_seek_const() */
+#define INDEX_MODE_CONST  8
+
 // #define INDEX_MODE_CUSTOM 4 /* Demuxer builds index */
 
 struct bgav_demuxer_context_s
@@ -1268,8 +1359,15 @@ struct bgav_demuxer_context_s
    *  seek() functions will be used
    */
   bgav_superindex_t * si;
+
+  /* Superindex read cursor for interleaved files */
+  bgav_si_cursor_t si_cursor;
   
   bgav_t * b;
+
+  /* Performance counters (see stats.c) */
+  int64_t next_packet_calls;
+  gavl_time_t next_packet_time;
   };
 
 /* demuxer.c */
@@ -1302,6 +1400,17 @@ int bgav_demuxer_get_duration(bgav_demuxer_context_t * ctx);
 void bgav_demuxer_set_clock_time(bgav_demuxer_context_t * ctx,
                                  int64_t pts, int scale, gavl_time_t clock_time);
 
+/*
+ *  Seek helper for demuxers, whose packets have a constant size and
+ *  duration (including per-packet headers). Positions the input at the
+ *  packet containing time and returns its start time in timescale units.
+ */
+
+int64_t bgav_demuxer_seek_const(bgav_demuxer_context_t * ctx,
+                                int64_t time, int scale,
+                                int timescale, int64_t packet_duration,
+                                int64_t packet_size);
+
 /* Generic get/peek functions */
 
 void
@@ -1589,9 +1698,6 @@ void bgav_video_set_still(bgav_stream_t * stream);
 
 /* subtitle.c */
 
-void bgav_subtitle_seek(bgav_demuxer_context_t * ctx, int64_t time, int scale);
-
-
 void bgav_subtitle_dump(bgav_stream_t * s);
 
 int bgav_text_start(bgav_stream_t * s);
@@ -1759,7 +1865,8 @@ void bgav_dca_flags_2_channel_setup(int flags, gavl_audio_format_t * format);
 int bgav_video_is_divx4(uint32_t fourcc);
 
 /* Global locking around avcodec_[open|close]()
-   Defined in video_ffmpeg.c, used from audio_ffmpeg.c as well
+   Defined in video_ffmpeg.c, used from audio_ffmpeg.c as well.
+   NOOPs for libavcodec versions, which do the locking internally.
 */
 
 void bgav_ffmpeg_lock();
@@ -1778,5 +1885,51 @@ void bgav_ffmpeg_unlock();
 
 #endif
 
+/* SIMD functions are compiled with the target attribute and
+   called only if gavl_accel_supported() reports the instruction set */
+
+#if defined(__GNUC__) && (__GNUC__ >= 5 || defined(__clang__)) && \
+  (defined(__i386__) || defined(__x86_64__))
+#define BGAV_HAVE_SSSE3
+#define BGAV_SSSE3_FUNC __attribute__((target("ssse3")))
+#endif
+
+/* stats.c */
+
+/* Monotonic time for the performance counters */
+gavl_time_t bgav_stats_time(void);
+
+/* slicepool.c */
+
+/*
+ *  Small pool of worker threads for processing the rows of an image
+ *  in parallel. The calling thread processes the first slice itself.
+ */
+
+typedef struct bgav_slice_pool_s bgav_slice_pool_t;
+
+/* Process units start..end-1 */
+typedef void (*bgav_slice_func)(void * data, int start, int end);
+
+/* Returns NULL if no threads should be used */
+bgav_slice_pool_t * bgav_slice_pool_create(int num_threads);
+
+void bgav_slice_pool_run(bgav_slice_pool_t * p, bgav_slice_func func,
+                         void * data, int num);
+
+void bgav_slice_pool_destroy(bgav_slice_pool_t * p);
+
+/* threadbudget.c */
+
+/*
+ *  Get the number of threads a decoder should use (at least 1).
+ *  max > 0 is the maximum the decoder can make use of.
+ *  The returned number must be passed to bgav_threads_release()
+ *  when the decoder is closed.
+ */
+
+int bgav_threads_acquire(const bgav_options_t * opt, int max);
+void bgav_threads_release(int num);
+
 #endif // BGAV_AVDEDEC_PRIVATE_H_INCLUDED
 
@@ -22,33 +22,309 @@
 #ifndef BGAV_BITSTREAM_H_INCLUDED
 #define BGAV_BITSTREAM_H_INCLUDED
 
-/* bitstream.c */
+#include <string.h>
+#include <inttypes.h>
+
+#include <bswap.h>
+
+/*
+ *  Bitstream reader for header parsers.
+ *
+ *  Everything is inline: The parsers call these for each syntax element
+ *  so the function call overhead used to dominate.
+ *
+ *  The cache holds up to 64 bits, MSB aligned. Refilling loads a whole
+ *  64 bit word and advances by the number of complete bytes, which fit
+ *  into the cache. Bits below bit_cache are always either zero or the
+ *  real following bits of the stream, so or'ing in the next word twice
+ *  is harmless.
+ *
+ *  The *_unchecked() variants are for buffers, which are known to be
+ *  large enough (or where reading zeros past the end is acceptable). They
+ *  return the value directly and never fail.
+ */
 
 typedef struct
   {
-  const uint8_t * pos;
+  const uint8_t * pos; /* Next byte to load into the cache */
   const uint8_t * end;
-  int bit_cache;
-  uint32_t c;
+  int bit_cache;       /* Valid bits in c */
+  uint64_t c;          /* Bit cache, MSB aligned */
   } bgav_bitstream_t;
 
-void bgav_bitstream_init(bgav_bitstream_t * b, const uint8_t * pos, 
-                         int len);
+/* Maximum number of bits, which can be read at once */
+#define BGAV_BITSTREAM_MAX_BITS 57
+
+#if __GNUC__ >= 4
+#define BGAV_BITSTREAM_CLZ64(x) __builtin_clzll(x)
+#else
+static inline int bgav_bitstream_clz64(uint64_t x)
+  {
+  int ret = 0;
+  while(!(x & 0x8000000000000000ULL))
+    {
+    x <<= 1;
+    ret++;
+    }
+  return ret;
+  }
+#define BGAV_BITSTREAM_CLZ64(x) bgav_bitstream_clz64(x)
+#endif
+
+static inline void bgav_bitstream_refill(bgav_bitstream_t * b)
+  {
+  if(b->bit_cache > 56)
+    return;
+  
+  if(b->end - b->pos >= 8)
+    {
+    uint64_t w;
+    int bytes = (64 - b->bit_cache) >> 3;
+    
+    memcpy(&w, b->pos, 8);
+    w = be2me_64(w);
+    
+    b->c |= w >> b->bit_cache;
+    b->pos += bytes;
+    b->bit_cache += bytes << 3;
+    }
+  else
+    {
+    while((b->bit_cache <= 56) && (b->pos < b->end))
+      {
+      b->c |= ((uint64_t)(*b->pos)) << (56 - b->bit_cache);
+      b->pos++;
+      b->bit_cache += 8;
+      }
+    }
+  }
+
+static inline void bgav_bitstream_init(bgav_bitstream_t * b,
+                                       const uint8_t * pos, int len)
+  {
+  b->pos = pos;
+  b->end = pos + len;
+  b->c = 0;
+  b->bit_cache = 0;
+  bgav_bitstream_refill(b);
+  }
+
+static inline int bgav_bitstream_get_bits(bgav_bitstream_t * b)
+  {
+  return b->bit_cache + 8 * (b->end - b->pos);
+  }
+
+/* Read 0..BGAV_BITSTREAM_MAX_BITS bits. Past the end, zeros are returned */
+
+static inline uint64_t
+bgav_bitstream_get_unchecked(bgav_bitstream_t * b, int bits)
+  {
+  uint64_t ret;
+  
+  if(!bits)
+    return 0;
+  
+  if(b->bit_cache < bits)
+    bgav_bitstream_refill(b);
+
+  ret = b->c >> (64 - bits);
+  b->c <<= bits;
+  b->bit_cache -= bits;
+  
+  if(b->bit_cache < 0)
+    b->bit_cache = 0;
+  return ret;
+  }
+
+static inline int bgav_bitstream_get_long(bgav_bitstream_t * b,
+                                          int64_t * ret, int bits)
+  {
+  if(bits > BGAV_BITSTREAM_MAX_BITS)
+    {
+    int64_t hi;
+    if(!bgav_bitstream_get_long(b, &hi, bits - 32) ||
+       (bgav_bitstream_get_bits(b) < 32))
+      return 0;
+    *ret = (hi << 32) | bgav_bitstream_get_unchecked(b, 32);
+    return 1;
+    }
+  
+  if(b->bit_cache < bits)
+    {
+    bgav_bitstream_refill(b);
+    if(b->bit_cache < bits)
+      return 0;
+    }
+  *ret = bgav_bitstream_get_unchecked(b, bits);
+  return 1;
+  }
+
+static inline int bgav_bitstream_get(bgav_bitstream_t * b, int * ret,
+                                     int bits)
+  {
+  int64_t tmp;
+  if(!bgav_bitstream_get_long(b, &tmp, bits))
+    return 0;
+  *ret = tmp;
+  return 1;
+  }
+
+/* Peek at most BGAV_BITSTREAM_MAX_BITS bits. Refilling doesn't change the
+   read position so no state needs to be saved */
+
+static inline int bgav_bitstream_peek(bgav_bitstream_t * b, int * ret,
+                                      int bits)
+  {
+  if(b->bit_cache < bits)
+    {
+    bgav_bitstream_refill(b);
+    if(b->bit_cache < bits)
+      return 0;
+    }
+  *ret = bits ? (b->c >> (64 - bits)) : 0;
+  return 1;
+  }
 
-int bgav_bitstream_get(bgav_bitstream_t * b, int * ret,  int bits);
-int bgav_bitstream_get_long(bgav_bitstream_t * b, int64_t * ret,  int bits);
-int bgav_bitstream_get_bits(bgav_bitstream_t * b);
+static inline int bgav_bitstream_skip(bgav_bitstream_t * b, int bits)
+  {
+  int skip_bytes;
+  
+  if(bgav_bitstream_get_bits(b) < bits)
+    return 0;
 
-int bgav_bitstream_peek(bgav_bitstream_t * b, int * ret, int bits);
-int bgav_bitstream_skip(bgav_bitstream_t * b, int bits);
+  if(bits <= b->bit_cache)
+    {
+    /* The cache can hold more bits than we can read at once */
+    if(bits > BGAV_BITSTREAM_MAX_BITS)
+      {
+      bgav_bitstream_get_unchecked(b, 32);
+      bits -= 32;
+      }
+    bgav_bitstream_get_unchecked(b, bits);
+    return 1;
+    }
 
+  /* Drop the cache and skip whole bytes directly */
+  bits -= b->bit_cache;
+  skip_bytes = bits >> 3;
+  b->pos += skip_bytes;
+  b->c = 0;
+  b->bit_cache = 0;
+  bgav_bitstream_get_unchecked(b, bits & 7);
+  return 1;
+  }
 
 /* Special parsing functions */
 
-int bgav_bitstream_get_golomb_ue(bgav_bitstream_t * b, int * ret);
-int bgav_bitstream_get_golomb_se(bgav_bitstream_t * b, int * ret);
-int bgav_bitstream_decode012(bgav_bitstream_t * b, int * ret);
-int bgav_bitstream_get_unary(bgav_bitstream_t * b, int stop,
-                             int len, int * ret);
+/* Exp-Golomb codes with up to 31 leading zeros */
+
+static inline int bgav_bitstream_get_golomb_ue(bgav_bitstream_t * b,
+                                               int * ret)
+  {
+  int num;
+  int bits;
+  
+  if(b->bit_cache < 63)
+    bgav_bitstream_refill(b);
+  
+  /* Fast path: The whole code is in the cache */
+  if(b->c)
+    {
+    num = BGAV_BITSTREAM_CLZ64(b->c);
+    if((num < 31) && (2 * num + 1 <= b->bit_cache))
+      {
+      *ret = bgav_bitstream_get_unchecked(b, 2 * num + 1) - 1;
+      return 1;
+      }
+    }
+
+  /* Slow path: Near the end of the buffer or broken data */
+  num = 0;
+  while(num < 31)
+    {
+    if(!bgav_bitstream_get(b, &bits, 1))
+      return 0;
+    if(bits)
+      break;
+    else
+      num++;
+    }
+    
+  /* The variable codeNum is then assigned as follows:
+     codeNum = 2^leadingZeroBits - 1 + read_bits( leadingZeroBits ) */
+  
+  if(!bgav_bitstream_get(b, &bits, num))
+    return 0;
+  
+  *ret = (((uint32_t)1 << num) | (uint32_t)bits) - 1;
+  return 1;
+  }
+
+static inline int bgav_bitstream_get_golomb_se(bgav_bitstream_t * b,
+                                               int * ret)
+  {
+  int ret1;
+  if(!bgav_bitstream_get_golomb_ue(b, &ret1))
+    return 0;
+
+  if(ret1 & 1)
+    *ret = (ret1+1)>>1;
+  else
+    *ret = -(ret1>>1);
+  return 1;
+  }
+
+static inline int
+bgav_bitstream_get_golomb_ue_unchecked(bgav_bitstream_t * b)
+  {
+  int ret = 0;
+  bgav_bitstream_get_golomb_ue(b, &ret);
+  return ret;
+  }
+
+static inline int
+bgav_bitstream_get_golomb_se_unchecked(bgav_bitstream_t * b)
+  {
+  int ret = 0;
+  bgav_bitstream_get_golomb_se(b, &ret);
+  return ret;
+  }
+
+static inline int bgav_bitstream_decode012(bgav_bitstream_t * b, int * ret)
+  {
+  int n;
+
+  if(!bgav_bitstream_get(b, &n, 1))
+    return 0;
+
+  if(!n)
+    {
+    *ret = 0;
+    return 1;
+    }
+
+  if(!bgav_bitstream_get(b, &n, 1))
+    return 0;
+  *ret = n + 1;
+  return 1;
+  }
+
+static inline int bgav_bitstream_get_unary(bgav_bitstream_t * b, int stop,
+                                           int len, int * ret)
+  {
+  int i = 0;
+  int tmp;
+  
+  while(i < len)
+    {
+    if(!bgav_bitstream_get(b, &tmp, 1))
+      return 0;
+    if(tmp == stop)
+      break;
+    i++;
+    }
+  *ret = i;
+  return 1;
+  }
 
 #endif // BGAV_BITSTREAM_H_INCLUDED
@@ -252,6 +252,11 @@ typedef struct
   // }
   } bgav_h264_slice_header_t;
 
+/* bgav_h264_slice_header_parse() never reads more than this from the
+   escaped NAL payload, so callers don't need to unescape the whole slice */
+
+#define H264_SLICE_HEADER_MAX_BYTES 48
+
 void bgav_h264_slice_header_parse(const uint8_t * data, int len,
                                   const bgav_h264_sps_t * sps,
                                   bgav_h264_slice_header_t * ret);
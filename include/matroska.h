@@ -549,12 +549,24 @@ typedef struct
   int data_size;
   uint8_t * data;
   int data_alloc;
+
+  int skipped; /* Payload was not read */
   } bgav_mkv_block_t;
 
 int bgav_mkv_block_read(bgav_input_context_t * ctx,
                         bgav_mkv_block_t * ret,
                         bgav_mkv_element_t * parent);
 
+/* Read header and payload separately. This allows to skip the
+   payload or to read it directly into the destination */
+
+int bgav_mkv_block_read_header(bgav_input_context_t * ctx,
+                               bgav_mkv_block_t * ret,
+                               bgav_mkv_element_t * parent);
+
+int bgav_mkv_block_read_payload(bgav_input_context_t * ctx,
+                                bgav_mkv_block_t * ret);
+
 void bgav_mkv_block_dump(int indent, bgav_mkv_block_t * b);
 void bgav_mkv_block_free(bgav_mkv_block_t * b);
 
@@ -570,6 +582,10 @@ typedef struct
   int64_t * reference_blocks;
   int reference_blocks_alloc;
   int num_reference_blocks;
+
+  /* If set, the block payload is only read if this returns 1 */
+  int (*read_payload)(void * priv, int64_t track);
+  void * read_payload_priv;
   } bgav_mkv_block_group_t;
 
 int bgav_mkv_block_group_read(bgav_input_context_t * ctx,
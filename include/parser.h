@@ -42,11 +42,20 @@ struct bgav_packet_parser_s
   gavl_dictionary_t * info;
   gavl_dictionary_t * m;
   int packet_timescale;
+
+  /* Data of the current frame and everything after it. This is a view
+     into store starting at store_start, so flushing a frame doesn't
+     move the remaining bytes */
   gavl_buffer_t buf;
 
-  int fourcc;
+  gavl_buffer_t store;
+  int store_start;
   
+  int fourcc;
+
+  /* Active packets start at packets_start */
   packet_info_t * packets;
+  int packets_start;
   int num_packets;
   int packets_alloc;
 
@@ -64,12 +64,25 @@ int bgav_set_audio_stream(bgav_t * b, int stream, bgav_stream_action_t action)
   return 1;
   }
 
+static gavl_source_status_t decode_frame(bgav_stream_t * s)
+  {
+  gavl_source_status_t ret;
+  gavl_time_t t = bgav_stats_time();
+  
+  ret = s->data.audio.decoder->decode_frame(s);
+
+  s->counters.decode_time += bgav_stats_time() - t;
+  if(ret == GAVL_SOURCE_OK)
+    s->counters.frames++;
+  return ret;
+  }
+
 static gavl_source_status_t get_frame(void * sp, gavl_audio_frame_t ** frame)
   {
   bgav_stream_t * s = sp;
   
   if(!(s->flags & STREAM_HAVE_FRAME) &&
-     !s->data.audio.decoder->decode_frame(s))
+     !decode_frame(s))
     {
     s->flags |= STREAM_EOF_C;
     return GAVL_SOURCE_EOF;
@@ -33,6 +33,28 @@
 
 // #define DUMP_PACKETS
 
+/*
+ *  Sample conversion kernels. They are selected once per stream
+ *  depending on the CPU features, the decode functions call them
+ *  through the function pointers.
+ *
+ *  num is the number of samples for the plain conversions and the
+ *  number of 4-sample groups for the DVD LPCM functions.
+ */
+
+typedef struct
+  {
+  void (*swap_16)(void * dst, const uint8_t * src, int num);
+  void (*swap_32)(void * dst, const uint8_t * src, int num);
+  void (*swap_64)(void * dst, const uint8_t * src, int num);
+
+  void (*s_24_le)(uint32_t * dst, const uint8_t * src, int num);
+  void (*s_24_be)(uint32_t * dst, const uint8_t * src, int num);
+  
+  void (*s_24_lpcm)(uint32_t * dst, const uint8_t * src, int num);
+  void (*s_20_lpcm)(uint32_t * dst, const uint8_t * src, int num);
+  } pcm_kernels_t;
+
 typedef struct
   {
   void (*decode_func)(bgav_stream_t * s);
@@ -43,106 +65,61 @@ typedef struct
   uint8_t *       packet_ptr;
 
   int block_align;
+
+  const pcm_kernels_t * k;
+
+  /* Zero copy: The frame points into the packet, which is
+     released not before the next call of the decoder */
+  int zerocopy;
+  gavl_audio_frame_t * zc_frame;
+  gavl_audio_frame_t * out_frame;
+  bgav_packet_t * done_p;
   } pcm_t;
 
-/* Decode functions */
+/* Scalar kernels */
 
-static void decode_8(bgav_stream_t * s)
+static void swap_16_c(void * dst1, const uint8_t * src1, int num)
   {
-  pcm_t * priv;
-  int num_samples, num_bytes;
-  priv = s->decoder_priv;
-
-  num_samples = priv->bytes_in_packet / (s->data.audio.format->num_channels);
+  uint16_t * dst = dst1;
+  const uint16_t * src = (const uint16_t *)src1;
   
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
-
-  num_bytes   = num_samples * s->data.audio.format->num_channels;
-
-  memcpy(priv->frame->samples.u_8, priv->packet_ptr, num_bytes);
-
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
+  while(num--)
+    {
+    *dst = bswap_16(*src);
+    src++;
+    dst++;
+    }
   }
 
-static void decode_s_16(bgav_stream_t * s)
+static void swap_32_c(void * dst1, const uint8_t * src1, int num)
   {
-  pcm_t * priv;
-  int num_samples, num_bytes;
-  priv = s->decoder_priv;
-
-  num_samples = priv->bytes_in_packet / (2 * s->data.audio.format->num_channels);
+  uint32_t * dst = dst1;
+  const uint32_t * src = (const uint32_t *)src1;
   
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
-
-//  fprintf(stderr, "Bytes: %d, Samples: %d\n", priv->bytes_in_packet, num_samples);
-
-  num_bytes   = num_samples * 2 * s->data.audio.format->num_channels;
-
-  memcpy(priv->frame->samples.s_16, priv->packet_ptr, num_bytes);
-
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
+  while(num--)
+    {
+    *dst = bswap_32(*src);
+    src++;
+    dst++;
+    }
   }
 
-static void decode_s_16_swap(bgav_stream_t * s)
+static void swap_64_c(void * dst1, const uint8_t * src1, int num)
   {
-  pcm_t * priv;
-  int num_samples, num_bytes, i;
-  int16_t * src, *dst;
+  uint64_t * dst = dst1;
+  const uint64_t * src = (const uint64_t *)src1;
   
-  priv = s->decoder_priv;
-
-  num_samples = priv->bytes_in_packet / (2 * s->data.audio.format->num_channels);
-
-  
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
-
-  num_bytes   = num_samples * 2 * s->data.audio.format->num_channels;
-
-  src = (int16_t*)priv->packet_ptr;
-  dst = priv->frame->samples.s_16;
-
-  i = num_samples * s->data.audio.format->num_channels;
-
-  while(i--)
+  while(num--)
     {
-    *dst = bswap_16(*src);
+    *dst = bswap_64(*src);
     src++;
     dst++;
     }
-  
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
   }
 
-static void decode_s_24_le(bgav_stream_t * s)
+static void s_24_le_c(uint32_t * dst, const uint8_t * src, int num)
   {
-  pcm_t * priv;
-  int num_samples, num_bytes, i;
-  uint8_t * src;
-  uint32_t * dst;
-  priv = s->decoder_priv;
-
-  num_samples = priv->bytes_in_packet / (3 * s->data.audio.format->num_channels);
-
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
-
-  num_bytes   = num_samples * 3 * s->data.audio.format->num_channels;
-
-  src = priv->packet_ptr;
-  dst = (uint32_t*)(priv->frame->samples.s_32);
-
-  i = num_samples * s->data.audio.format->num_channels;
-  
-  while(i--)
+  while(num--)
     {
     *dst =
       ((uint32_t)(src[0]) << 8)  |
@@ -151,33 +128,11 @@ static void decode_s_24_le(bgav_stream_t * s)
     src+=3;
     dst++;
     }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
-  
   }
 
-static void decode_s_24_be(bgav_stream_t * s)
+static void s_24_be_c(uint32_t * dst, const uint8_t * src, int num)
   {
-  pcm_t * priv;
-  int num_samples, num_bytes, i;
-  uint8_t * src;
-  uint32_t * dst;
-  priv = s->decoder_priv;
-
-  num_samples = priv->bytes_in_packet / (3 * s->data.audio.format->num_channels);
-
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
-
-  num_bytes   = num_samples * 3 * s->data.audio.format->num_channels;
-
-  src = priv->packet_ptr;
-  dst = (uint32_t*)(priv->frame->samples.s_32);
-
-  i = num_samples * s->data.audio.format->num_channels;
-  
-  while(i--)
+  while(num--)
     {
     *dst =
       ((uint32_t)(src[2]) << 8)  |
@@ -186,32 +141,11 @@ static void decode_s_24_be(bgav_stream_t * s)
     src+=3;
     dst++;
     }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
   }
 
-static void decode_s_24_lpcm(bgav_stream_t * s)
+static void s_24_lpcm_c(uint32_t * dst, const uint8_t * src, int num)
   {
-  pcm_t * priv;
-  int num_samples, num_bytes, i;
-  uint8_t * src;
-  uint32_t * dst;
-  priv = s->decoder_priv;
-
-  num_samples = priv->bytes_in_packet / (3 * s->data.audio.format->num_channels);
-
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
-
-  num_bytes   = num_samples * 3 * s->data.audio.format->num_channels;
-
-  src = priv->packet_ptr;
-  dst = (uint32_t *)priv->frame->samples.s_32;
-
-  i = (num_samples * s->data.audio.format->num_channels)/4;
-  
-  while(i--)
+  while(num--)
     {
     dst[0] = ((uint32_t)(src[0])<<24)|((uint32_t)(src[1])<<16)|((uint32_t)(src[8])<< 8);
     dst[1] = ((uint32_t)(src[2])<<24)|((uint32_t)(src[3])<<16)|((uint32_t)(src[9])<< 8);
@@ -220,430 +154,459 @@ static void decode_s_24_lpcm(bgav_stream_t * s)
     src+=12;
     dst+=4;
     }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
   }
 
-static void decode_s_24_lpcm_mono(bgav_stream_t * s)
+static void s_20_lpcm_c(uint32_t * dst, const uint8_t * src, int num)
   {
-  pcm_t * priv;
-  int num_samples, num_bytes, i;
-  uint8_t * src;
-  uint32_t * dst;
-  priv = s->decoder_priv;
+  while(num--)
+    {
+    dst[0] = ((uint32_t)(src[0])<<24)|((uint32_t)(src[1])<<16)|((uint32_t)(src[8] & 0xf0)<< 8);
+    dst[1] = ((uint32_t)(src[2])<<24)|((uint32_t)(src[3])<<16)|((uint32_t)(src[8] & 0x0f)<< 12);
+    dst[2] = ((uint32_t)(src[4])<<24)|((uint32_t)(src[5])<<16)|((uint32_t)(src[9] & 0xf0)<< 8);
+    dst[3] = ((uint32_t)(src[6])<<24)|((uint32_t)(src[7])<<16)|((uint32_t)(src[9] & 0x0f)<< 12);
+    src+=10;
+    dst+=4;
+    }
+  }
 
-  num_samples = priv->bytes_in_packet / 3;
+static const pcm_kernels_t kernels_c =
+  {
+    .swap_16   = swap_16_c,
+    .swap_32   = swap_32_c,
+    .swap_64   = swap_64_c,
+    .s_24_le   = s_24_le_c,
+    .s_24_be   = s_24_be_c,
+    .s_24_lpcm = s_24_lpcm_c,
+    .s_20_lpcm = s_20_lpcm_c,
+  };
 
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
+/* SSSE3 kernels: All conversions are single byte shuffles (plus some
+   masking for 20 bit LPCM). The 16 byte loads may read past the
+   consumed bytes, so the loops stop early enough to stay inside the
+   source buffer and let the scalar versions do the rest. */
 
-  num_bytes   = num_samples * 3;
+#ifdef BGAV_HAVE_SSSE3
 
-  src = priv->packet_ptr;
-  dst = (uint32_t *)priv->frame->samples.s_32;
+#include <tmmintrin.h>
 
-  i = num_samples/2;
-  
-  while(i--)
+BGAV_SSSE3_FUNC
+static void shuffle_ssse3(uint8_t * dst, const uint8_t * src, int num_bytes,
+                          __m128i mask)
+  {
+  while(num_bytes >= 16)
     {
-    dst[0] = ((uint32_t)(src[0])<<24)|((uint32_t)(src[1])<<16)|((uint32_t)(src[4])<< 8);
-    dst[1] = ((uint32_t)(src[2])<<24)|((uint32_t)(src[3])<<16)|((uint32_t)(src[5])<< 8);
-    src+=6;
-    dst+=2;
+    _mm_storeu_si128((__m128i*)dst,
+                     _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), mask));
+    src += 16;
+    dst += 16;
+    num_bytes -= 16;
     }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
   }
 
-static void decode_s_20_lpcm(bgav_stream_t * s)
+BGAV_SSSE3_FUNC
+static void swap_16_ssse3(void * dst, const uint8_t * src, int num)
   {
-  pcm_t * priv;
-  int num_samples, num_bytes, i;
-  uint8_t * src;
-  uint32_t * dst;
-  priv = s->decoder_priv;
+  int num_simd = num & ~7;
+  shuffle_ssse3(dst, src, num_simd * 2,
+                _mm_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14));
+  swap_16_c((uint16_t*)dst + num_simd, src + num_simd * 2, num - num_simd);
+  }
 
-  /* 5 bytes -> 2 samples */
-  num_samples = (2*priv->bytes_in_packet) / (5 * s->data.audio.format->num_channels);
+BGAV_SSSE3_FUNC
+static void swap_32_ssse3(void * dst, const uint8_t * src, int num)
+  {
+  int num_simd = num & ~3;
+  shuffle_ssse3(dst, src, num_simd * 4,
+                _mm_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12));
+  swap_32_c((uint32_t*)dst + num_simd, src + num_simd * 4, num - num_simd);
+  }
 
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
+BGAV_SSSE3_FUNC
+static void swap_64_ssse3(void * dst, const uint8_t * src, int num)
+  {
+  int num_simd = num & ~1;
+  shuffle_ssse3(dst, src, num_simd * 8,
+                _mm_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8));
+  swap_64_c((uint64_t*)dst + num_simd, src + num_simd * 8, num - num_simd);
+  }
 
-  num_bytes   = (num_samples * 5 * s->data.audio.format->num_channels)/2;
-  
-  src = priv->packet_ptr;
-  dst = (uint32_t*)(priv->frame->samples.s_32);
+/* 12 bytes -> 4 samples, reads 16 bytes */
 
-  i = (num_samples * s->data.audio.format->num_channels)/4;
-  
-  while(i--)
+BGAV_SSSE3_FUNC
+static int s_24_ssse3(uint32_t * dst, const uint8_t * src, int num,
+                      __m128i mask)
+  {
+  int ret = 0;
+  while(num - ret >= 6)
     {
-    dst[0] = ((uint32_t)(src[0])<<24)|((uint32_t)(src[1])<<16)|((uint32_t)(src[8] & 0xf0)<< 8);
-    dst[1] = ((uint32_t)(src[2])<<24)|((uint32_t)(src[3])<<16)|((uint32_t)(src[8] & 0x0f)<< 12);
-    dst[2] = ((uint32_t)(src[4])<<24)|((uint32_t)(src[5])<<16)|((uint32_t)(src[9] & 0xf0)<< 8);
-    dst[3] = ((uint32_t)(src[6])<<24)|((uint32_t)(src[7])<<16)|((uint32_t)(src[9] & 0x0f)<< 12);
-    src+=10;
-    dst+=4;
+    _mm_storeu_si128((__m128i*)dst,
+                     _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), mask));
+    src += 12;
+    dst += 4;
+    ret += 4;
     }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
+  return ret;
   }
 
-static void decode_s_20_lpcm_mono(bgav_stream_t * s)
+BGAV_SSSE3_FUNC
+static void s_24_le_ssse3(uint32_t * dst, const uint8_t * src, int num)
   {
-  pcm_t * priv;
-  int num_samples, num_bytes, i;
-  uint8_t * src;
-  uint32_t * dst;
-  priv = s->decoder_priv;
+  int num_simd = s_24_ssse3(dst, src, num,
+                            _mm_setr_epi8(-1,0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11));
+  s_24_le_c(dst + num_simd, src + 3 * num_simd, num - num_simd);
+  }
 
-  num_samples = (2*priv->bytes_in_packet) / (5 * s->data.audio.format->num_channels);
-  
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
+BGAV_SSSE3_FUNC
+static void s_24_be_ssse3(uint32_t * dst, const uint8_t * src, int num)
+  {
+  int num_simd = s_24_ssse3(dst, src, num,
+                            _mm_setr_epi8(-1,2,1,0,-1,5,4,3,-1,8,7,6,-1,11,10,9));
+  s_24_be_c(dst + num_simd, src + 3 * num_simd, num - num_simd);
+  }
 
-  num_bytes   = (num_samples * 5 * s->data.audio.format->num_channels)/2;
+BGAV_SSSE3_FUNC
+static void s_24_lpcm_ssse3(uint32_t * dst, const uint8_t * src, int num)
+  {
+  const __m128i mask =
+    _mm_setr_epi8(-1,8,1,0,-1,9,3,2,-1,10,5,4,-1,11,7,6);
   
-  src = priv->packet_ptr;
-  dst = (uint32_t*)(priv->frame->samples.s_32);
+  /* Keep the last group for the scalar version */
+  while(num >= 2)
+    {
+    _mm_storeu_si128((__m128i*)dst,
+                     _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), mask));
+    src += 12;
+    dst += 4;
+    num--;
+    }
+  s_24_lpcm_c(dst, src, num);
+  }
 
-  i = num_samples/2;
+BGAV_SSSE3_FUNC
+static void s_20_lpcm_ssse3(uint32_t * dst, const uint8_t * src, int num)
+  {
+  /* Upper 16 bits */
+  const __m128i mask_hi =
+    _mm_setr_epi8(-1,-1,1,0,-1,-1,3,2,-1,-1,5,4,-1,-1,7,6);
+  /* Byte with the lower nibbles */
+  const __m128i mask_lo =
+    _mm_setr_epi8(-1,8,-1,-1,-1,8,-1,-1,-1,9,-1,-1,-1,9,-1,-1);
+  /* Upper nibble for even samples, lower nibble (shifted by 4) for odd ones */
+  const __m128i nibble_even = _mm_setr_epi32(0xf000, 0, 0xf000, 0);
+  const __m128i nibble_odd  = _mm_setr_epi32(0, 0xf000, 0, 0xf000);
   
-  while(i--)
+  while(num >= 2)
     {
-    dst[0] = ((uint32_t)(src[0])<<24)|((uint32_t)(src[1])<<16)|((uint32_t)(src[4] & 0xf0)<< 8);
-    dst[1] = ((uint32_t)(src[2])<<24)|((uint32_t)(src[3])<<16)|((uint32_t)(src[4] & 0x0f)<< 12);
-    src+=5;
-    dst+=2;
+    __m128i in = _mm_loadu_si128((const __m128i*)src);
+    __m128i lo = _mm_shuffle_epi8(in, mask_lo);
+    __m128i out = _mm_shuffle_epi8(in, mask_hi);
+    
+    out = _mm_or_si128(out, _mm_and_si128(lo, nibble_even));
+    out = _mm_or_si128(out, _mm_and_si128(_mm_slli_epi32(lo, 4), nibble_odd));
+    _mm_storeu_si128((__m128i*)dst, out);
+    src += 10;
+    dst += 4;
+    num--;
     }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
+  s_20_lpcm_c(dst, src, num);
   }
 
+static const pcm_kernels_t kernels_ssse3 =
+  {
+    .swap_16   = swap_16_ssse3,
+    .swap_32   = swap_32_ssse3,
+    .swap_64   = swap_64_ssse3,
+    .s_24_le   = s_24_le_ssse3,
+    .s_24_be   = s_24_be_ssse3,
+    .s_24_lpcm = s_24_lpcm_ssse3,
+    .s_20_lpcm = s_20_lpcm_ssse3,
+  };
 
-static void decode_s_32(bgav_stream_t * s)
+#endif
+
+static const pcm_kernels_t * get_kernels()
+  {
+#ifdef BGAV_HAVE_SSSE3
+  if(gavl_accel_supported() & GAVL_ACCEL_SSSE3)
+    return &kernels_ssse3;
+#endif
+  return &kernels_c;
+  }
+
+/* Decode functions */
+
+static int get_num_samples(bgav_stream_t * s, int bytes_per_sample)
   {
   pcm_t * priv;
-  int num_samples, num_bytes;
+  int num_samples;
   priv = s->decoder_priv;
 
-  num_samples = priv->bytes_in_packet / (4 * s->data.audio.format->num_channels);
+  num_samples = priv->bytes_in_packet /
+    (bytes_per_sample * s->data.audio.format->num_channels);
 
   if(num_samples > FRAME_SAMPLES)
     num_samples = FRAME_SAMPLES;
+  return num_samples;
+  }
 
-  num_bytes   = num_samples * 4 * s->data.audio.format->num_channels;
-  memcpy(priv->frame->samples.s_32, priv->packet_ptr, num_bytes);
+static void advance(bgav_stream_t * s, int num_bytes, int num_samples)
+  {
+  pcm_t * priv;
+  priv = s->decoder_priv;
   
   priv->packet_ptr += num_bytes;
   priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
-  
+  priv->out_frame->valid_samples = num_samples;
   }
 
-/* Integer 32 bit */
+/* Native formats: Copy or just point to the packet memory */
 
-static void decode_s_32_swap(bgav_stream_t * s)
+static void decode_native(bgav_stream_t * s, int bytes_per_sample)
   {
-
   pcm_t * priv;
   int num_samples, num_bytes, i;
-  int32_t * src, *dst;
-  
   priv = s->decoder_priv;
 
-  num_samples = priv->bytes_in_packet / (4 * s->data.audio.format->num_channels);
-  
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
-
-  num_bytes   = num_samples * 4 * s->data.audio.format->num_channels;
-
-  src = (int32_t*)priv->packet_ptr;
-  dst = priv->frame->samples.s_32;
+  num_samples = get_num_samples(s, bytes_per_sample);
+  num_bytes   = num_samples * bytes_per_sample * s->data.audio.format->num_channels;
 
-  i = num_samples * s->data.audio.format->num_channels;
-
-  while(i--)
+  if(priv->zerocopy &&
+     !(((uintptr_t)priv->packet_ptr) & (bytes_per_sample - 1)))
     {
-    *dst = bswap_32(*src);
-    src++;
-    dst++;
+    priv->zc_frame->samples.u_8 = priv->packet_ptr;
+    for(i = 0; i < s->data.audio.format->num_channels; i++)
+      priv->zc_frame->channels.u_8[i] = priv->packet_ptr + i * bytes_per_sample;
+    priv->out_frame = priv->zc_frame;
     }
-  
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
-  
+  else
+    {
+    memcpy(priv->frame->samples.u_8, priv->packet_ptr, num_bytes);
+    priv->out_frame = priv->frame;
+    }
+  advance(s, num_bytes, num_samples);
   }
 
-#ifndef WORDS_BIGENDIAN
-#define decode_s_16_le decode_s_16
-#define decode_s_16_be decode_s_16_swap
-#define decode_s_32_le decode_s_32
-#define decode_s_32_be decode_s_32_swap
-#else
-#define decode_s_16_le decode_s_16_swap
-#define decode_s_16_be decode_s_16
-#define decode_s_32_le decode_s_32_swap
-#define decode_s_32_be decode_s_32
-#endif
-
-/* Big/Little endian floating point routines taken from libsndfile */
-
-static float
-float32_be_read (unsigned char *cptr)
-  {       int             exponent, mantissa, negative ;
-  float   fvalue ;
-
-  negative = cptr [0] & 0x80 ;
-  exponent = ((cptr [0] & 0x7F) << 1) | ((cptr [1] & 0x80) ? 1 : 0) ;
-  mantissa = ((cptr [1] & 0x7F) << 16) | (cptr [2] << 8) | (cptr [3]) ;
-
-  if (! (exponent || mantissa))
-    return 0.0 ;
-
-  mantissa |= 0x800000 ;
-  exponent = exponent ? exponent - 127 : 0 ;
-
-  fvalue = mantissa ? ((float) mantissa) / ((float) 0x800000) : 0.0 ;
-
-  if (negative)
-    fvalue *= -1 ;
-
-  if (exponent > 0)
-    fvalue *= (1 << exponent) ;
-  else if (exponent < 0)
-    fvalue /= (1 << abs (exponent)) ;
-
-  return fvalue ;
-  } /* float32_be_read */
-
-static float
-float32_le_read (unsigned char *cptr)
+static void decode_8(bgav_stream_t * s)
   {
-  int             exponent, mantissa, negative ;
-  float   fvalue ;
-
-  negative = cptr [3] & 0x80 ;
-  exponent = ((cptr [3] & 0x7F) << 1) | ((cptr [2] & 0x80) ? 1 : 0) ;
-  mantissa = ((cptr [2] & 0x7F) << 16) | (cptr [1] << 8) | (cptr [0]) ;
-
-  if (! (exponent || mantissa))
-    return 0.0 ;
-
-  mantissa |= 0x800000 ;
-  exponent = exponent ? exponent - 127 : 0 ;
-
-  fvalue = mantissa ? ((float) mantissa) / ((float) 0x800000) : 0.0 ;
-
-  if (negative)
-    fvalue *= -1 ;
-
-  if (exponent > 0)
-    fvalue *= (1 << exponent) ;
-  else if (exponent < 0)
-    fvalue /= (1 << abs (exponent)) ;
-
-  return fvalue ;
-  } /* float32_le_read */
+  decode_native(s, 1);
+  }
 
-static double
-double64_be_read (unsigned char *cptr)
+static void decode_s_16(bgav_stream_t * s)
   {
-  int             exponent, negative ;
-  double  dvalue ;
-
-  negative = (cptr [0] & 0x80) ? 1 : 0 ;
-  exponent = ((cptr [0] & 0x7F) << 4) | ((cptr [1] >> 4) & 0xF) ;
-
-  /* Might not have a 64 bit long, so load the mantissa into a double. */
-  dvalue = (((cptr [1] & 0xF) << 24) | (cptr [2] << 16) | (cptr [3] << 8) | cptr [4]) ;
-  dvalue += ((cptr [5] << 16) | (cptr [6] << 8) | cptr [7]) / ((double) 0x1000000) ;
-
-  if (exponent == 0 && dvalue == 0.0)
-    return 0.0 ;
-
-  dvalue += 0x10000000 ;
-
-  exponent = exponent - 0x3FF ;
-
-  dvalue = dvalue / ((double) 0x10000000) ;
-
-  if (negative)
-    dvalue *= -1 ;
+  decode_native(s, 2);
+  }
 
-  if (exponent > 0)
-    dvalue *= (1 << exponent) ;
-  else if (exponent < 0)
-    dvalue /= (1 << abs (exponent)) ;
+static void decode_s_32(bgav_stream_t * s)
+  {
+  decode_native(s, 4);
+  }
 
-  return dvalue ;
-  } /* double64_be_read */
+static void decode_64(bgav_stream_t * s)
+  {
+  decode_native(s, 8);
+  }
 
-static double
-double64_le_read (unsigned char *cptr)
+static void decode_s_16_swap(bgav_stream_t * s)
   {
-  int             exponent, negative ;
-  double  dvalue ;
+  pcm_t * priv;
+  int num_samples;
+  priv = s->decoder_priv;
 
-  negative = (cptr [7] & 0x80) ? 1 : 0 ;
-  exponent = ((cptr [7] & 0x7F) << 4) | ((cptr [6] >> 4) & 0xF) ;
+  num_samples = get_num_samples(s, 2);
+  
+  priv->k->swap_16(priv->frame->samples.s_16, priv->packet_ptr,
+                   num_samples * s->data.audio.format->num_channels);
+  
+  priv->out_frame = priv->frame;
+  advance(s, num_samples * 2 * s->data.audio.format->num_channels, num_samples);
+  }
 
-  /* Might not have a 64 bit long, so load the mantissa into a double. */
-  dvalue = (((cptr [6] & 0xF) << 24) | (cptr [5] << 16) | (cptr [4] << 8) | cptr [3]) ;
-  dvalue += ((cptr [2] << 16) | (cptr [1] << 8) | cptr [0]) / ((double) 0x1000000) ;
+/* Integer 32 bit and float */
 
-  if (exponent == 0 && dvalue == 0.0)
-    return 0.0 ;
+static void decode_s_32_swap(bgav_stream_t * s)
+  {
+  pcm_t * priv;
+  int num_samples;
+  priv = s->decoder_priv;
 
-  dvalue += 0x10000000 ;
+  num_samples = get_num_samples(s, 4);
+  
+  priv->k->swap_32(priv->frame->samples.s_32, priv->packet_ptr,
+                   num_samples * s->data.audio.format->num_channels);
+  
+  priv->out_frame = priv->frame;
+  advance(s, num_samples * 4 * s->data.audio.format->num_channels, num_samples);
+  }
 
-  exponent = exponent - 0x3FF ;
+/* Double */
 
-  dvalue = dvalue / ((double) 0x10000000) ;
+static void decode_64_swap(bgav_stream_t * s)
+  {
+  pcm_t * priv;
+  int num_samples;
+  priv = s->decoder_priv;
 
-  if (negative)
-    dvalue *= -1 ;
+  num_samples = get_num_samples(s, 8);
+  
+  priv->k->swap_64(priv->frame->samples.d, priv->packet_ptr,
+                   num_samples * s->data.audio.format->num_channels);
+  
+  priv->out_frame = priv->frame;
+  advance(s, num_samples * 8 * s->data.audio.format->num_channels, num_samples);
+  }
 
-  if (exponent > 0)
-    dvalue *= (1 << exponent) ;
-  else if (exponent < 0)
-    dvalue /= (1 << abs (exponent)) ;
+static void decode_s_24_le(bgav_stream_t * s)
+  {
+  pcm_t * priv;
+  int num_samples;
+  priv = s->decoder_priv;
 
-  return dvalue ;
-  } /* double64_le_read */
+  num_samples = get_num_samples(s, 3);
 
-/* Corrsponding decoding functions */
+  priv->k->s_24_le((uint32_t*)priv->frame->samples.s_32, priv->packet_ptr,
+                   num_samples * s->data.audio.format->num_channels);
+  
+  priv->out_frame = priv->frame;
+  advance(s, num_samples * 3 * s->data.audio.format->num_channels, num_samples);
+  }
 
-static void decode_float_32_be(bgav_stream_t * s)
+static void decode_s_24_be(bgav_stream_t * s)
   {
   pcm_t * priv;
-  int num_samples, num_bytes, i;
-  uint8_t * src;
-  float * dst;
+  int num_samples;
   priv = s->decoder_priv;
 
-  num_samples = priv->bytes_in_packet / (4 * s->data.audio.format->num_channels);
+  num_samples = get_num_samples(s, 3);
 
-  if(num_samples > FRAME_SAMPLES)
-    num_samples = FRAME_SAMPLES;
+  priv->k->s_24_be((uint32_t*)priv->frame->samples.s_32, priv->packet_ptr,
+                   num_samples * s->data.audio.format->num_channels);
+  
+  priv->out_frame = priv->frame;
+  advance(s, num_samples * 3 * s->data.audio.format->num_channels, num_samples);
+  }
 
-  num_bytes   = num_samples * 4 * s->data.audio.format->num_channels;
+static void decode_s_24_lpcm(bgav_stream_t * s)
+  {
+  pcm_t * priv;
+  int num_samples;
+  priv = s->decoder_priv;
 
-  src = priv->packet_ptr;
-  dst = (float*)(priv->frame->samples.f);
+  num_samples = get_num_samples(s, 3);
 
-  i = num_samples * s->data.audio.format->num_channels;
+  priv->k->s_24_lpcm((uint32_t*)priv->frame->samples.s_32, priv->packet_ptr,
+                     (num_samples * s->data.audio.format->num_channels)/4);
   
-  while(i--)
-    {
-    *dst = float32_be_read(src);
-    src+=4;
-    dst++;
-    }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
+  priv->out_frame = priv->frame;
+  advance(s, num_samples * 3 * s->data.audio.format->num_channels, num_samples);
   }
 
-static void decode_float_32_le(bgav_stream_t * s)
+static void decode_s_24_lpcm_mono(bgav_stream_t * s)
   {
   pcm_t * priv;
   int num_samples, num_bytes, i;
   uint8_t * src;
-  float * dst;
+  uint32_t * dst;
   priv = s->decoder_priv;
 
-  num_samples = priv->bytes_in_packet / (4 * s->data.audio.format->num_channels);
+  num_samples = priv->bytes_in_packet / 3;
 
   if(num_samples > FRAME_SAMPLES)
     num_samples = FRAME_SAMPLES;
 
-  num_bytes   = num_samples * 4 * s->data.audio.format->num_channels;
+  num_bytes   = num_samples * 3;
 
   src = priv->packet_ptr;
-  dst = (float*)(priv->frame->samples.f);
+  dst = (uint32_t *)priv->frame->samples.s_32;
 
-  i = num_samples * s->data.audio.format->num_channels;
+  i = num_samples/2;
   
   while(i--)
     {
-    *dst = float32_le_read(src);
-    src+=4;
-    dst++;
+    dst[0] = ((uint32_t)(src[0])<<24)|((uint32_t)(src[1])<<16)|((uint32_t)(src[4])<< 8);
+    dst[1] = ((uint32_t)(src[2])<<24)|((uint32_t)(src[3])<<16)|((uint32_t)(src[5])<< 8);
+    src+=6;
+    dst+=2;
     }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
+  priv->out_frame = priv->frame;
+  advance(s, num_bytes, num_samples);
   }
 
-static void decode_float_64_be(bgav_stream_t * s)
+static void decode_s_20_lpcm(bgav_stream_t * s)
   {
   pcm_t * priv;
-  int num_samples, num_bytes, i;
-  uint8_t * src;
-  double * dst;
+  int num_samples, num_bytes;
   priv = s->decoder_priv;
 
-  num_samples = priv->bytes_in_packet / (8 * s->data.audio.format->num_channels);
+  /* 5 bytes -> 2 samples */
+  num_samples = (2*priv->bytes_in_packet) / (5 * s->data.audio.format->num_channels);
 
   if(num_samples > FRAME_SAMPLES)
     num_samples = FRAME_SAMPLES;
 
-  num_bytes   = num_samples * 8 * s->data.audio.format->num_channels;
-
-  src = priv->packet_ptr;
-  dst = (double*)(priv->frame->samples.f);
+  num_bytes   = (num_samples * 5 * s->data.audio.format->num_channels)/2;
 
-  i = num_samples * s->data.audio.format->num_channels;
+  priv->k->s_20_lpcm((uint32_t*)priv->frame->samples.s_32, priv->packet_ptr,
+                     (num_samples * s->data.audio.format->num_channels)/4);
   
-  while(i--)
-    {
-    *dst = double64_be_read(src);
-    src+=8;
-    dst++;
-    }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
+  priv->out_frame = priv->frame;
+  advance(s, num_bytes, num_samples);
   }
 
-static void decode_float_64_le(bgav_stream_t * s)
+static void decode_s_20_lpcm_mono(bgav_stream_t * s)
   {
   pcm_t * priv;
   int num_samples, num_bytes, i;
   uint8_t * src;
-  double * dst;
+  uint32_t * dst;
   priv = s->decoder_priv;
 
-  num_samples = priv->bytes_in_packet / (8 * s->data.audio.format->num_channels);
-
+  num_samples = (2*priv->bytes_in_packet) / (5 * s->data.audio.format->num_channels);
+  
   if(num_samples > FRAME_SAMPLES)
     num_samples = FRAME_SAMPLES;
 
-  num_bytes   = num_samples * 8 * s->data.audio.format->num_channels;
-
+  num_bytes   = (num_samples * 5 * s->data.audio.format->num_channels)/2;
+  
   src = priv->packet_ptr;
-  dst = (double*)(priv->frame->samples.f);
+  dst = (uint32_t*)(priv->frame->samples.s_32);
 
-  i = num_samples * s->data.audio.format->num_channels;
+  i = num_samples/2;
   
   while(i--)
     {
-    *dst = double64_le_read(src);
-    src+=8;
-    dst++;
+    dst[0] = ((uint32_t)(src[0])<<24)|((uint32_t)(src[1])<<16)|((uint32_t)(src[4] & 0xf0)<< 8);
+    dst[1] = ((uint32_t)(src[2])<<24)|((uint32_t)(src[3])<<16)|((uint32_t)(src[4] & 0x0f)<< 12);
+    src+=5;
+    dst+=2;
     }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
+  priv->out_frame = priv->frame;
+  advance(s, num_bytes, num_samples);
   }
 
+/* Floating point samples are assumed to be IEEE 754 in the
+   machine byte order (like everywhere else in gavl), so the
+   conversion is either a copy or a byte swap */
+
+#ifndef WORDS_BIGENDIAN
+#define decode_s_16_le decode_s_16
+#define decode_s_16_be decode_s_16_swap
+#define decode_s_32_le decode_s_32
+#define decode_s_32_be decode_s_32_swap
+#define decode_float_32_le decode_s_32
+#define decode_float_32_be decode_s_32_swap
+#define decode_float_64_le decode_64
+#define decode_float_64_be decode_64_swap
+#else
+#define decode_s_16_le decode_s_16_swap
+#define decode_s_16_be decode_s_16
+#define decode_s_32_le decode_s_32_swap
+#define decode_s_32_be decode_s_32
+#define decode_float_32_le decode_s_32_swap
+#define decode_float_32_be decode_s_32
+#define decode_float_64_le decode_64_swap
+#define decode_float_64_be decode_64
+#endif
+
 /* U-Law */
 
 static const short ulaw_decode [256] =
@@ -708,9 +671,8 @@ static void decode_ulaw(bgav_stream_t * s)
     src++;
     dst++;
     }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
+  priv->out_frame = priv->frame;
+  advance(s, num_bytes, num_samples);
   }
 
 
@@ -778,9 +740,8 @@ static void decode_alaw(bgav_stream_t * s)
     src++;
     dst++;
     }
-  priv->packet_ptr += num_bytes;
-  priv->bytes_in_packet -= num_bytes;
-  priv->frame->valid_samples = num_samples;
+  priv->out_frame = priv->frame;
+  advance(s, num_bytes, num_samples);
   }
 
 static gavl_source_status_t get_packet(bgav_stream_t * s)
@@ -816,6 +777,9 @@ static int init_pcm(bgav_stream_t * s)
   priv = calloc(1, sizeof(*priv));
   s->decoder_priv = priv;
 
+  priv->k = get_kernels();
+  priv->zerocopy = s->opt->pcm_zerocopy;
+
   switch(s->fourcc)
     {
     /* Big endian */
@@ -1227,6 +1191,10 @@ static int init_pcm(bgav_stream_t * s)
   gavl_set_channel_setup(s->data.audio.format);
   
   priv->frame = gavl_audio_frame_create(s->data.audio.format);
+  priv->out_frame = priv->frame;
+
+  if(priv->zerocopy)
+    priv->zc_frame = gavl_audio_frame_create(NULL);
   if(!priv->block_align)
     priv->block_align = s->data.audio.format->num_channels *
       ((s->data.audio.bits_per_sample+7)/8);
@@ -1241,6 +1209,13 @@ static gavl_source_status_t decode_frame_pcm(bgav_stream_t * s)
   
   priv = s->decoder_priv;
 
+  /* The last frame is no longer used */
+  if(priv->done_p)
+    {
+    bgav_stream_done_packet_read(s, priv->done_p);
+    priv->done_p = NULL;
+    }
+  
   if(!priv->p && ((st = get_packet(s)) != GAVL_SOURCE_OK))
     return st;
 
@@ -1249,11 +1224,14 @@ static gavl_source_status_t decode_frame_pcm(bgav_stream_t * s)
   priv->decode_func(s);
 
   gavl_audio_frame_copy_ptrs(s->data.audio.format,
-                             s->data.audio.frame, priv->frame);
+                             s->data.audio.frame, priv->out_frame);
   
   if(!priv->bytes_in_packet)
     {
-    bgav_stream_done_packet_read(s, priv->p);
+    if(priv->out_frame == priv->zc_frame)
+      priv->done_p = priv->p;
+    else
+      bgav_stream_done_packet_read(s, priv->p);
     priv->p = NULL;
     }
   return GAVL_SOURCE_OK;
@@ -1266,6 +1244,11 @@ static void close_pcm(bgav_stream_t * s)
 
   if(priv->frame)
     gavl_audio_frame_destroy(priv->frame);
+  if(priv->zc_frame)
+    {
+    gavl_audio_frame_null(priv->zc_frame);
+    gavl_audio_frame_destroy(priv->zc_frame);
+    }
   free(priv);
   }
 
@@ -1275,6 +1258,12 @@ static void resync_pcm(bgav_stream_t * s)
   priv = s->decoder_priv;
   priv->frame->valid_samples = 0;
 
+  if(priv->done_p)
+    {
+    bgav_stream_done_packet_read(s, priv->done_p);
+    priv->done_p = NULL;
+    }
+  
   if(priv->p)
     {
     bgav_stream_done_packet_read(s, priv->p);
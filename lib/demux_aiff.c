@@ -127,19 +127,6 @@ static int64_t pos_2_time(bgav_demuxer_context_t * ctx, int64_t pos)
     priv->samples_per_block;
   }
 
-static int64_t time_2_pos(bgav_demuxer_context_t * ctx, int64_t time)
-  {
-  aiff_priv_t * priv;
-
-  bgav_stream_t * s;
-  priv = ctx->priv;
-  s = bgav_track_get_audio_stream(ctx->tt->cur, 0);
-  
-  return ctx->tt->cur->data_start + (time/priv->samples_per_block)
-    * s->data.audio.block_align;
-  }
-
-
 static int probe_aiff(bgav_input_context_t * input)
   {
   uint8_t test_data[12];
@@ -433,19 +420,13 @@ static gavl_source_status_t next_packet_aiff(bgav_demuxer_context_t * ctx)
 
 static void seek_aiff(bgav_demuxer_context_t * ctx, int64_t time, int scale)
   {
-  int64_t pos;
-  int64_t time_scaled;
+  aiff_priv_t * priv = ctx->priv;
   bgav_stream_t * s = bgav_track_get_audio_stream(ctx->tt->cur, 0);
-  time_scaled =
-    gavl_time_rescale(scale,
-                      s->data.audio.format->samplerate,
-                      time);
-  
-  pos = time_2_pos(ctx, time_scaled);
-  bgav_input_seek(ctx->input, pos, SEEK_SET);
 
-  STREAM_SET_SYNC(s, pos_2_time(ctx, pos));
-  
+  STREAM_SET_SYNC(s, bgav_demuxer_seek_const(ctx, time, scale,
+                                             s->data.audio.format->samplerate,
+                                             priv->samples_per_block,
+                                             s->data.audio.block_align));
   }
 
 static void close_aiff(bgav_demuxer_context_t * ctx)
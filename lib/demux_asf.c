@@ -45,11 +45,14 @@ static const bgav_GUID_t guid_data =
   { 0x75b22636, 0x668e, 0x11cf,
     { 0xa6, 0xd9, 0x00, 0xaa, 0x00, 0x62, 0xce, 0x6c } };
 
-#if 0
 static const bgav_GUID_t guid_simple_index = 
   { 0x33000890, 0xe5b1, 0x11cf,
     { 0x89, 0xf4, 0x00, 0xa0, 0xc9, 0x03, 0x49, 0xcb } };
-#endif
+
+/* ASF 2.0 index object */
+static const bgav_GUID_t guid_index = 
+  { 0xd6e229d3, 0x35da, 0x11d1,
+    { 0x90, 0x34, 0x00, 0xa0, 0xc9, 0x03, 0x49, 0xbe } };
 
 /* header ASF objects */
 static const bgav_GUID_t guid_file_properties = 
@@ -324,6 +327,14 @@ typedef struct
     uint32_t bitrate;
     } * stream_bitrates;
   int num_stream_bitrates;
+
+  /* End of the data object */
+  int64_t data_end;
+  
+  /* Packet numbers of the last keyframes before i * index_interval milliseconds */
+  uint32_t index_interval;
+  uint32_t * index_packets;
+  int num_index_entries;
   } asf_t;
 
 static int probe_asf(bgav_input_context_t * input)
@@ -479,6 +490,194 @@ static int read_metadata(bgav_demuxer_context_t * ctx)
   }
 
 
+/* Simple index object (one entry per time interval) */
+
+static int read_simple_index(bgav_demuxer_context_t * ctx, uint64_t size)
+  {
+  int i;
+  uint64_t interval;
+  uint32_t max_packet_count;
+  uint32_t num_entries;
+  uint8_t * buf;
+  asf_t * asf = ctx->priv;
+
+  bgav_input_skip(ctx->input, 16); /* File ID */
+  
+  if(!bgav_input_read_64_le(ctx->input, &interval) ||
+     !bgav_input_read_32_le(ctx->input, &max_packet_count) ||
+     !bgav_input_read_32_le(ctx->input, &num_entries))
+    return 0;
+
+  /* Interval is in 100 ns units */
+  interval /= 10000;
+  
+  if(!num_entries || !interval ||
+     (num_entries > (size - 56) / 6))
+    return 0;
+
+  buf = malloc(num_entries * 6);
+
+  if(bgav_input_read_data(ctx->input, buf, num_entries * 6) < num_entries * 6)
+    {
+    free(buf);
+    return 0;
+    }
+  
+  asf->index_packets = malloc(num_entries * sizeof(*asf->index_packets));
+  asf->num_index_entries = num_entries;
+  asf->index_interval = interval;
+  
+  for(i = 0; i < asf->num_index_entries; i++)
+    asf->index_packets[i] = GAVL_PTR_2_32LE(buf + i * 6);
+  
+  free(buf);
+  return 1;
+  }
+
+/* Index object (ASF 2.0): Byte offsets for several streams, organized in blocks */
+
+static int read_index(bgav_demuxer_context_t * ctx)
+  {
+  int i, j;
+  uint32_t interval;
+  uint16_t num_specifiers;
+  uint32_t num_blocks;
+  uint32_t num_entries;
+  uint16_t stream_number;
+  uint16_t index_type;
+  uint64_t block_pos = 0;
+  uint64_t tmp_64;
+  uint32_t offset;
+  int spec = 0;
+  bgav_stream_t * s;
+  asf_t * asf = ctx->priv;
+
+  if(!bgav_input_read_32_le(ctx->input, &interval) ||
+     !bgav_input_read_16_le(ctx->input, &num_specifiers) ||
+     !bgav_input_read_32_le(ctx->input, &num_blocks) ||
+     !interval || !num_specifiers)
+    return 0;
+
+  /* Use the first video stream if there is one */
+  for(i = 0; i < num_specifiers; i++)
+    {
+    if(!bgav_input_read_16_le(ctx->input, &stream_number) ||
+       !bgav_input_read_16_le(ctx->input, &index_type))
+      return 0;
+    
+    if(!spec && (s = bgav_track_find_stream_all(ctx->tt->cur, stream_number)) &&
+       (s->type == GAVL_STREAM_VIDEO))
+      spec = i;
+    }
+
+  for(i = 0; i < (int)num_blocks; i++)
+    {
+    if(!bgav_input_read_32_le(ctx->input, &num_entries) ||
+       ((int64_t)num_entries * num_specifiers * 4 > ctx->input->total_bytes))
+      goto fail;
+
+    for(j = 0; j < num_specifiers; j++)
+      {
+      if(!bgav_input_read_64_le(ctx->input, &tmp_64))
+        goto fail;
+      if(j == spec)
+        block_pos = tmp_64;
+      }
+    
+    asf->index_packets = realloc(asf->index_packets,
+                                 (asf->num_index_entries + num_entries) *
+                                 sizeof(*asf->index_packets));
+    
+    for(j = 0; j < (int)num_entries; j++)
+      {
+      /* Skip the offsets of the other streams */
+      bgav_input_skip(ctx->input, spec * 4);
+      
+      if(!bgav_input_read_32_le(ctx->input, &offset))
+        goto fail;
+
+      bgav_input_skip(ctx->input, (num_specifiers - spec - 1) * 4);
+
+      /* Invalid entries repeat the last valid one */
+      if(offset == 0xffffffff)
+        {
+        asf->index_packets[asf->num_index_entries] =
+          asf->num_index_entries ? asf->index_packets[asf->num_index_entries-1] : 0;
+        }
+      else
+        asf->index_packets[asf->num_index_entries] =
+          (block_pos + offset) / ctx->packet_size;
+      asf->num_index_entries++;
+      }
+    }
+  
+  asf->index_interval = interval;
+  return 1;
+
+  fail:
+  
+  if(asf->index_packets)
+    {
+    free(asf->index_packets);
+    asf->index_packets = NULL;
+    }
+  asf->num_index_entries = 0;
+  return 0;
+  }
+
+/* Read the index objects after the data object. The simple index is preferred. */
+
+static void read_indices(bgav_demuxer_context_t * ctx)
+  {
+  bgav_GUID_t guid;
+  uint64_t size;
+  int64_t pos;
+  int64_t simple_index_pos = -1;
+  int64_t simple_index_size = 0;
+  int64_t index_pos = -1;
+  asf_t * asf = ctx->priv;
+
+  pos = asf->data_end;
+  
+  while(pos + 24 <= ctx->input->total_bytes)
+    {
+    bgav_input_seek(ctx->input, pos, SEEK_SET);
+    
+    if(!bgav_GUID_read(&guid, ctx->input) ||
+       !bgav_input_read_64_le(ctx->input, &size) ||
+       (size < 24))
+      break;
+
+    if((simple_index_pos < 0) && bgav_GUID_equal(&guid, &guid_simple_index))
+      {
+      simple_index_pos = ctx->input->position;
+      simple_index_size = size;
+      }
+    else if((index_pos < 0) && bgav_GUID_equal(&guid, &guid_index))
+      index_pos = ctx->input->position;
+    
+    pos += size;
+    }
+
+  if(simple_index_pos > 0)
+    {
+    bgav_input_seek(ctx->input, simple_index_pos, SEEK_SET);
+    read_simple_index(ctx, simple_index_size);
+    }
+  
+  if(!asf->num_index_entries && (index_pos > 0))
+    {
+    bgav_input_seek(ctx->input, index_pos, SEEK_SET);
+    read_index(ctx);
+    }
+
+  if(asf->num_index_entries)
+    gavl_log(GAVL_LOG_DEBUG, LOG_DOMAIN, "Got index: %d entries, interval: %d ms",
+             asf->num_index_entries, asf->index_interval);
+  
+  bgav_input_seek(ctx->input, ctx->tt->cur->data_start, SEEK_SET);
+  }
+
 static int open_asf(bgav_demuxer_context_t * ctx)
   {
   int64_t chunk_start_pos;
@@ -706,6 +905,7 @@ static int open_asf(bgav_demuxer_context_t * ctx)
     else if(bgav_GUID_equal(&guid_data, &guid))
       {
       asf->data_size = size;
+      asf->data_end = chunk_start_pos + size;
       break;
       }
 
@@ -748,7 +948,14 @@ static int open_asf(bgav_demuxer_context_t * ctx)
     free(buf);
   
   if((ctx->input->flags & BGAV_INPUT_CAN_SEEK_BYTE) && asf->hdr.packets_count)
+    {
     ctx->flags |= BGAV_DEMUXER_CAN_SEEK;
+
+    if(ctx->packet_size &&
+       (asf->data_end > ctx->tt->cur->data_start) &&
+       (asf->data_end < ctx->input->total_bytes))
+      read_indices(ctx);
+    }
   
   bgav_track_set_format(ctx->tt->cur, "ASF", "application/x-mplayer2");
   
@@ -1128,25 +1335,74 @@ static gavl_source_status_t next_packet_asf(bgav_demuxer_context_t * ctx)
   return GAVL_SOURCE_OK;
   }
 
-#if 0
-static void seek_asf(bgav_demuxer_context_t * ctx, int64_t time, int scale)
+/* Send time of a data packet (in milliseconds) */
+
+static int get_packet_time(bgav_demuxer_context_t * ctx, int64_t packet,
+                           int64_t * ret)
   {
-  int64_t filepos;
+  asf_packet_header_t pkt_hdr;
   asf_t * asf = ctx->priv;
-  /* Reset all the streams */
   
-  asf->packets_read =
-    (int64_t)((double)asf->hdr.packets_count *
-              (gavl_time_to_seconds(gavl_time_unscale(scale, time))/
-               gavl_time_to_seconds(gavl_track_get_duration(ctx->tt->cur->info))));
+  bgav_input_seek(ctx->input, ctx->tt->cur->data_start +
+                  packet * ctx->packet_size, SEEK_SET);
+
+  if(bgav_input_read_data(ctx->input, asf->packet_buffer,
+                          ctx->packet_size) < ctx->packet_size)
+    return 0;
+  
+  read_packet_header(ctx, asf, &pkt_hdr, asf->packet_buffer);
+  *ret = pkt_hdr.time;
+  return 1;
+  }
+
+static void seek_asf(bgav_demuxer_context_t * ctx, int64_t time, int scale)
+  {
+  int64_t index;
+  int64_t lo, hi, mid;
+  int64_t packet_time;
+  asf_t * asf = ctx->priv;
   
-  filepos = ctx->tt->cur->data_start +
-    ctx->packet_size * asf->packets_read;
+  /* Timestamps are in milliseconds including the preroll */
+  time = gavl_time_rescale(scale, ASF_TIME_SCALE, time);
   
-  bgav_input_seek(ctx->input, filepos, SEEK_SET);
+  if(asf->num_index_entries)
+    {
+    /* The index points directly to the packet with the last keyframe */
+    index = time / asf->index_interval;
+    
+    if(index < 0)
+      index = 0;
+    if(index >= asf->num_index_entries)
+      index = asf->num_index_entries - 1;
+    
+    asf->packets_read = asf->index_packets[index];
+    }
+  else
+    {
+    /* Bisect on the packet send times */
+    lo = 0;
+    hi = asf->hdr.packets_count;
+    
+    while(hi - lo > 1)
+      {
+      mid = (lo + hi) / 2;
+
+      if(!get_packet_time(ctx, mid, &packet_time) ||
+         (packet_time > time))
+        hi = mid;
+      else
+        lo = mid;
+      }
+    asf->packets_read = lo;
+    }
+
+  /* Index entries past the end: Start at the last packet */
+  if(asf->hdr.packets_count && (asf->packets_read >= asf->hdr.packets_count))
+    asf->packets_read = asf->hdr.packets_count - 1;
   
+  bgav_input_seek(ctx->input, ctx->tt->cur->data_start +
+                  asf->packets_read * ctx->packet_size, SEEK_SET);
   }
-#endif
 
 static int post_seek_resync_asf(bgav_demuxer_context_t * ctx)
   {
@@ -1176,6 +1432,9 @@ static void close_asf(bgav_demuxer_context_t * ctx)
 
   if(asf->stream_bitrates)
     free(asf->stream_bitrates);
+
+  if(asf->index_packets)
+    free(asf->index_packets);
   
   free(ctx->priv);
   }
@@ -1194,7 +1453,7 @@ const bgav_demuxer_t bgav_demuxer_asf =
     .open             =  open_asf,
     .select_track     =  select_track_asf,
     .next_packet      =  next_packet_asf,
-    //    .seek             =  seek_asf,
+    .seek             =  seek_asf,
     .post_seek_resync =  post_seek_resync_asf,
     .close            =  close_asf
   };
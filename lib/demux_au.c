@@ -83,19 +83,6 @@ static int64_t pos_2_time(bgav_demuxer_context_t * ctx, int64_t pos)
   return ((pos - ctx->tt->cur->data_start) * priv->samples_per_block) / (s->data.audio.block_align);
   }
 
-static int64_t time_2_pos(bgav_demuxer_context_t * ctx, int64_t time)
-  {
-  au_priv_t * priv;
-  bgav_stream_t * s = bgav_track_get_audio_stream(ctx->tt->cur, 0);
-
-  priv = ctx->priv;
-  return ctx->tt->cur->data_start +
-    (time *
-     s->data.audio.block_align)/(priv->samples_per_block);
-  
-  }
-
-
 static int open_au(bgav_demuxer_context_t * ctx)
   {
   Audio_filehdr hdr;
@@ -231,16 +218,12 @@ static gavl_source_status_t next_packet_au(bgav_demuxer_context_t * ctx)
 static void seek_au(bgav_demuxer_context_t * ctx, gavl_time_t time, int scale)
   {
   bgav_stream_t * s;
-  int64_t position;
+  au_priv_t * priv = ctx->priv;
   s = bgav_track_get_audio_stream(ctx->tt->cur, 0);
-  
-  position = time_2_pos(ctx, gavl_time_rescale(scale, s->timescale, time));
-  position -= ctx->tt->cur->data_start;
-  position /= s->data.audio.block_align;
-  position *= s->data.audio.block_align;
-  position += ctx->tt->cur->data_start;
-  bgav_input_seek(ctx->input, position, SEEK_SET);
-  STREAM_SET_SYNC(s, pos_2_time(ctx, position));
+
+  STREAM_SET_SYNC(s, bgav_demuxer_seek_const(ctx, time, scale, s->timescale,
+                                             priv->samples_per_block,
+                                             s->data.audio.block_align));
   }
 
 static void close_au(bgav_demuxer_context_t * ctx)
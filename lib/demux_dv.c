@@ -153,31 +153,26 @@ static gavl_source_status_t next_packet_dv(bgav_demuxer_context_t * ctx)
 static void seek_dv(bgav_demuxer_context_t * ctx, int64_t time,
                     int scale)
   {
-  int64_t file_position;
   dv_priv_t * priv;
   bgav_stream_t * as, * vs;
-  int64_t frame_pos;
   int64_t t;
   priv = ctx->priv;
   vs = bgav_track_get_video_stream(ctx->tt->cur, 0);
   as = bgav_track_get_audio_stream(ctx->tt->cur, 0);
-  
-  t = gavl_time_rescale(scale, vs->data.video.format->timescale,
-                        time);
-  
-  frame_pos = t / vs->data.video.format->frame_duration;
-  
-  file_position = frame_pos * priv->frame_size;
 
-  t = frame_pos * vs->data.video.format->frame_duration;
-  STREAM_SET_SYNC(vs, t);
+  /* Each DIF sequence set holds exactly one video frame */
+  t = bgav_demuxer_seek_const(ctx, time, scale,
+                              vs->data.video.format->timescale,
+                              vs->data.video.format->frame_duration,
+                              priv->frame_size);
   
-  STREAM_SET_SYNC(as, 
-                  gavl_time_rescale(vs->data.video.format->timescale,
-                                    as->data.audio.format->samplerate,
-                                    t));
-  
-  bgav_input_seek(ctx->input, file_position, SEEK_SET);
+  STREAM_SET_SYNC(vs, t);
+
+  if(as)
+    STREAM_SET_SYNC(as, 
+                    gavl_time_rescale(vs->data.video.format->timescale,
+                                      as->data.audio.format->samplerate,
+                                      t));
   }
 
 
@@ -79,6 +79,19 @@ struct meta_object_s
   
   };
 
+/* Compact seek index entry. The position points to the
+   previous tag size field, which is where next_packet_flv()
+   starts reading */
+
+typedef struct
+  {
+  int64_t position;
+  int64_t time; /* Milliseconds */
+  } flv_index_entry_t;
+
+/* Minimum distance between index entries of audio only files */
+#define AUDIO_INDEX_INTERVAL 1000
+
 typedef struct
   {
   int init;
@@ -87,6 +100,13 @@ typedef struct
 
   int need_audio_extradata;
   int need_video_extradata;
+
+  /* Keyframe index, either from the metadata or built by
+     scanning the tag headers */
+  int num_index;
+  int index_alloc;
+  flv_index_entry_t * index;
+  int index_scanned;
   } flv_priv_t;
 
 static int probe_flv(bgav_input_context_t * input)
@@ -749,6 +769,159 @@ static gavl_source_status_t next_packet_flv(bgav_demuxer_context_t * ctx)
   return GAVL_SOURCE_OK;
   }
 
+static void index_append(flv_priv_t * priv, int64_t position, int64_t time)
+  {
+  if(priv->num_index >= priv->index_alloc)
+    {
+    priv->index_alloc += 1024;
+    priv->index = realloc(priv->index, priv->index_alloc * sizeof(*priv->index));
+    }
+  priv->index[priv->num_index].position = position;
+  priv->index[priv->num_index].time     = time;
+  priv->num_index++;
+  }
+
+static void index_from_metadata(flv_priv_t * priv, meta_object_t * keyframes)
+  {
+  uint32_t i, num;
+  meta_object_t * times;
+  meta_object_t * filepositions;
+  
+  times = meta_object_find(keyframes->data.object.children,
+                           keyframes->data.object.num_children, "times");
+  filepositions = meta_object_find(keyframes->data.object.children,
+                                   keyframes->data.object.num_children, "filepositions");
+
+  if(!times || !filepositions ||
+     (times->type != TYPE_ARRAY) || (filepositions->type != TYPE_ARRAY))
+    return;
+
+  num = times->data.array.num_elements;
+  if(num > filepositions->data.array.num_elements)
+    num = filepositions->data.array.num_elements;
+  
+  for(i = 0; i < num; i++)
+    {
+    if((times->data.array.elements[i].type != TYPE_NUMBER) ||
+       (filepositions->data.array.elements[i].type != TYPE_NUMBER))
+      continue;
+
+    /* Some muxers write garbage, keep the index sorted */
+    if(priv->num_index &&
+       (times->data.array.elements[i].data.number * 1000.0 <
+        priv->index[priv->num_index-1].time))
+      continue;
+    
+    index_append(priv,
+                 (int64_t)(filepositions->data.array.elements[i].data.number)-4,
+                 (int64_t)(times->data.array.elements[i].data.number * 1000.0 + 0.5));
+    }
+  }
+
+/*
+ *  Build the keyframe index from the tag headers. This is needed for
+ *  files without keyframes in the metadata (e.g. recorded RTMP streams).
+ *  Only the tag headers and the first byte of the video tags are read,
+ *  the payloads are skipped.
+ */
+
+static void scan_index(bgav_demuxer_context_t * ctx)
+  {
+  flv_tag t;
+  uint8_t flags;
+  int64_t pos;
+  int64_t time;
+  int64_t last_time = -1;
+  int have_video;
+  flv_priv_t * priv = ctx->priv;
+
+  priv->index_scanned = 1;
+  have_video = !!ctx->tt->cur->num_video_streams;
+  
+  pos = ctx->input->position;
+  bgav_input_seek(ctx->input, ctx->tt->cur->data_start, SEEK_SET);
+
+  while(1)
+    {
+    int64_t tag_pos = ctx->input->position;
+    
+    bgav_input_skip(ctx->input, 4);
+    
+    if(!flv_tag_read(ctx->input, &t))
+      break;
+
+    if(ctx->input->total_bytes &&
+       (ctx->input->position + t.data_size > ctx->input->total_bytes))
+      break;
+    
+    /* Upper 8 bits of the timestamp */
+    time = t.timestamp | ((int64_t)(t.reserved >> 24) << 24);
+    
+    if((t.type == VIDEO_ID) && have_video && t.data_size)
+      {
+      if(!bgav_input_read_data(ctx->input, &flags, 1))
+        break;
+      t.data_size--;
+      
+      if(((flags >> 4) == 1) && (time > last_time))
+        {
+        index_append(priv, tag_pos, time);
+        last_time = time;
+        }
+      }
+    else if((t.type == AUDIO_ID) && !have_video)
+      {
+      if((last_time < 0) || (time >= last_time + AUDIO_INDEX_INTERVAL))
+        {
+        index_append(priv, tag_pos, time);
+        last_time = time;
+        }
+      }
+    bgav_input_skip(ctx->input, t.data_size);
+    }
+
+  gavl_log(GAVL_LOG_DEBUG, LOG_DOMAIN, "Built index with %d entries from tag headers",
+           priv->num_index);
+  
+  bgav_input_seek(ctx->input, pos, SEEK_SET);
+  }
+
+static void seek_flv(bgav_demuxer_context_t * ctx, int64_t time, int scale)
+  {
+  int64_t time_ms;
+  int lo, hi, mid;
+  flv_priv_t * priv;
+  priv = ctx->priv;
+
+  /* Build the index from the tag headers at the first seek if the
+     metadata has none */
+  if(!priv->num_index && !priv->index_scanned)
+    scan_index(ctx);
+  
+  if(!priv->num_index)
+    {
+    bgav_input_seek(ctx->input, ctx->tt->cur->data_start, SEEK_SET);
+    return;
+    }
+  
+  time_ms = gavl_time_rescale(scale, 1000, time);
+  
+  /* Last entry before or at the seek time */
+  lo = 0;
+  hi = priv->num_index - 1;
+
+  while(lo < hi)
+    {
+    mid = (lo + hi + 1) / 2;
+    if(priv->index[mid].time <= time_ms)
+      lo = mid;
+    else
+      hi = mid - 1;
+    }
+  
+  bgav_input_seek(ctx->input, priv->index[lo].position, SEEK_SET);
+  }
+
 static void handle_metadata(bgav_demuxer_context_t * ctx)
   {
   bgav_stream_t * s;
@@ -783,63 +956,10 @@ static void handle_metadata(bgav_demuxer_context_t * ctx)
     {
     obj1 = meta_object_find(obj, num_obj, "keyframes");
     
-    if(obj1 && (obj1->type == TYPE_OBJECT) &&
-       meta_object_find(obj1->data.object.children, obj1->data.object.num_children,
-                        "filepositions") &&
-       meta_object_find(obj1->data.object.children, obj1->data.object.num_children,
-                        "times"))
-      ctx->flags |= BGAV_DEMUXER_CAN_SEEK;
-    }
-  }
-
-static void seek_flv(bgav_demuxer_context_t * ctx, int64_t time, int scale)
-  {
-  double time_float;
-  meta_object_t * obj;
-  int num_obj;
-  
-  meta_object_t * times;
-  meta_object_t * filepositions;
-  meta_object_t * keyframes;
-  int64_t file_pos;
-  uint32_t i;
-  flv_priv_t * priv;
-  priv = ctx->priv;
-  
-  /* Get index objects */
-
-  obj = priv->metadata.data.object.children;
-  num_obj = priv->metadata.data.object.num_children;
-
-  keyframes = meta_object_find(obj, num_obj, "keyframes");
-
-  if(!keyframes)
-    return;
-  
-  obj = keyframes->data.object.children;
-  num_obj = keyframes->data.object.num_children;
-  
-  times = meta_object_find(obj, num_obj, "times");
-  if(!times)
-    return;
-  filepositions = meta_object_find(obj, num_obj, "filepositions");
-  if(!filepositions)
-    return;
-  
-  /* Search index position */
-  time_float = gavl_time_to_seconds(gavl_time_unscale(scale, time));
-  for(i = times->data.array.num_elements-1; i >= 0; i--)
-    {
-    if(times->data.array.elements[i].data.number < time_float)
-      break;
+    if(obj1 && (obj1->type == TYPE_OBJECT))
+      index_from_metadata(priv, obj1);
     }
-  
-  /* Seek to position */
-  file_pos = (int64_t)(filepositions->data.array.elements[i].data.number)-4;
-  bgav_input_seek(ctx->input, file_pos, SEEK_SET);
-
   }
-     
 
 static int open_flv(bgav_demuxer_context_t * ctx)
   {
@@ -967,6 +1087,14 @@ static int open_flv(bgav_demuxer_context_t * ctx)
     bgav_input_seek(ctx->input, pos, SEEK_SET);
     }
   
+  /* Without an index from the metadata, it is built from the tag headers
+     at the first seek */
+  
+  if(priv->num_index ||
+     ((ctx->input->flags & (BGAV_INPUT_CAN_SEEK_BYTE|BGAV_INPUT_SEEK_SLOW)) ==
+      BGAV_INPUT_CAN_SEEK_BYTE))
+    ctx->flags |= BGAV_DEMUXER_CAN_SEEK;
+  
   bgav_track_set_format(ctx->tt->cur, "FLV", "video/x-flv");
   
   return 1;
@@ -995,6 +1123,9 @@ static void close_flv(bgav_demuxer_context_t * ctx)
 
   free_meta_object(&priv->metadata);
 
+  if(priv->index)
+    free(priv->index);
+  
   free(priv);
   }
 
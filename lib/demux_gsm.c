@@ -61,7 +61,10 @@ static int open_gsm(bgav_demuxer_context_t * ctx)
     {
     as->stats.pts_end = bytes_2_samples(ctx->input->total_bytes);
     if(ctx->input->flags & BGAV_INPUT_CAN_SEEK_BYTE)
+      {
       ctx->flags |= BGAV_DEMUXER_CAN_SEEK;
+      ctx->index_mode = INDEX_MODE_CONST;
+      }
     }
 
   bgav_track_set_format(ctx->tt->cur, "GSM", NULL);
@@ -98,19 +101,12 @@ static gavl_source_status_t next_packet_gsm(bgav_demuxer_context_t * ctx)
 static void seek_gsm(bgav_demuxer_context_t * ctx, int64_t time, int scale)
   {
   bgav_stream_t * s;
-  int64_t position;
-  int64_t sample;
   
   s = bgav_track_get_audio_stream(ctx->tt->cur, 0);
   
-  sample = gavl_time_rescale(scale, s->data.audio.format->samplerate, time); 
-  sample /= GSM_FRAME_SIZE;
-  position = sample * GSM_BLOCK_SIZE;
-  sample *= GSM_FRAME_SIZE;
-  
-  bgav_input_seek(ctx->input, position, SEEK_SET);
-
-  STREAM_SET_SYNC(s, sample);
+  STREAM_SET_SYNC(s, bgav_demuxer_seek_const(ctx, time, scale,
+                                             s->data.audio.format->samplerate,
+                                             GSM_FRAME_SIZE, GSM_BLOCK_SIZE));
   }
 
 static void close_gsm(bgav_demuxer_context_t * ctx)
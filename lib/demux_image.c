@@ -26,6 +26,8 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
 
 // #include <yuv4mpeg.h>
 
@@ -33,8 +35,51 @@
 
 #define PROBE_LEN 12
 
+extern const bgav_input_t bgav_input_file;
+
+/*
+ *  Numbered files (e.g. frame_000001.png, frame_000002.png, ...) are
+ *  exported as a video track. Files are loaded by a few threads ahead
+ *  of the reader.
+ */
+
+#define PREFETCH_FRAMES 8
+#define LOAD_THREADS    4
+
+#define SLOT_EMPTY   0
+#define SLOT_LOADING 1
+#define SLOT_DONE    2
+#define SLOT_ERROR   3
+
 typedef struct
   {
+  int64_t frame;
+  int state;
+  gavl_buffer_t buf;
+  } slot_t;
+
+typedef struct
+  {
+  /* Filename is prefix + number (at least digits wide) + suffix */
+  char * prefix;
+  char * suffix;
+  int digits;
+  int64_t first;
+  
+  int64_t num_frames; /* 0 for single images */
+  
+  slot_t slots[PREFETCH_FRAMES];
+  pthread_t threads[LOAD_THREADS];
+  int num_threads;
+  
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  
+  int64_t next_load;
+  int64_t next_read;
+  int num_loading;
+  int paused;
+  int quit;
   } image_t;
 
 static const uint8_t png_sig[] = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
@@ -83,6 +128,15 @@ static int is_jpeg(const uint8_t * data)
   return 0;
   }
 
+/* TGA has no signature */
+
+static int is_tga(const char * location)
+  {
+  return location &&
+    (gavl_string_ends_with(location, ".tga") ||
+     gavl_string_ends_with(location, ".TGA"));
+  }
+
 static int probe_image(bgav_input_context_t * input)
   {
   uint8_t probe_data[PROBE_LEN];
@@ -97,16 +151,187 @@ static int probe_image(bgav_input_context_t * input)
 
   if(is_png(probe_data) ||
      is_tiff(probe_data) ||
-     is_jpeg(probe_data)) 
+     is_jpeg(probe_data) ||
+     is_tga(input->location)) 
     return 1;
 
   return 0;
   }
 
+static char * get_filename(image_t * priv, int64_t frame)
+  {
+  return bgav_sprintf("%s%0*"PRId64"%s", priv->prefix, priv->digits,
+                      priv->first + frame, priv->suffix);
+  }
+
+/* Check if location is part of a numbered sequence of local files */
+
+static int detect_sequence(image_t * priv, const char * location)
+  {
+  const char * start;
+  const char * end;
+  const char * pos;
+  char * filename;
+  
+  if(!location)
+    return 0;
+  
+  if(!strncmp(location, "file://", 7))
+    location += 7;
+  else if(strstr(location, "://"))
+    return 0;
+
+  if(!(start = strrchr(location, '/')))
+    start = location;
+  
+  if(!(end = strrchr(start, '.')))
+    end = location + strlen(location);
+
+  pos = end;
+  while((pos > start) && isdigit(*(pos-1)))
+    pos--;
+
+  if(pos == end)
+    return 0;
+
+  priv->prefix = gavl_strndup(location, pos);
+  priv->suffix = gavl_strdup(end);
+  priv->digits = end - pos;
+  priv->first  = strtoll(pos, NULL, 10);
+
+  /* Count files */
+  while(1)
+    {
+    filename = get_filename(priv, priv->num_frames);
+    if(access(filename, R_OK))
+      {
+      free(filename);
+      break;
+      }
+    free(filename);
+    priv->num_frames++;
+    }
+
+  /* A single file is no sequence */
+  if(priv->num_frames < 2)
+    {
+    priv->num_frames = 0;
+    return 0;
+    }
+  return 1;
+  }
+
+static int load_file(const char * filename, gavl_buffer_t * buf)
+  {
+  FILE * f;
+  long len;
+  int ret = 0;
+  
+  if(!(f = fopen(filename, "rb")))
+    return 0;
+
+  fseek(f, 0, SEEK_END);
+  len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  if(len > 0)
+    {
+    gavl_buffer_alloc(buf, len);
+    if(fread(buf->buf, 1, len, f) == (size_t)len)
+      {
+      buf->len = len;
+      ret = 1;
+      }
+    }
+  fclose(f);
+  return ret;
+  }
+
+static void * load_thread(void * data)
+  {
+  int64_t frame;
+  slot_t * slot;
+  char * filename;
+  int result;
+  image_t * priv = data;
+  
+  pthread_mutex_lock(&priv->mutex);
+  
+  while(1)
+    {
+    while(!priv->quit &&
+          (priv->paused ||
+           (priv->next_load >= priv->num_frames) ||
+           (priv->next_load >= priv->next_read + PREFETCH_FRAMES)))
+      pthread_cond_wait(&priv->cond, &priv->mutex);
+    
+    if(priv->quit)
+      break;
+
+    frame = priv->next_load++;
+    
+    slot = &priv->slots[frame % PREFETCH_FRAMES];
+    slot->frame = frame;
+    slot->state = SLOT_LOADING;
+    priv->num_loading++;
+    
+    pthread_mutex_unlock(&priv->mutex);
+
+    /* The slot is ours until the state changes */
+    filename = get_filename(priv, frame);
+    result = load_file(filename, &slot->buf);
+
+    if(!result)
+      gavl_log(GAVL_LOG_ERROR, LOG_DOMAIN, "Cannot load %s", filename);
+    
+    free(filename);
+    
+    pthread_mutex_lock(&priv->mutex);
+    slot->state = result ? SLOT_DONE : SLOT_ERROR;
+    priv->num_loading--;
+    pthread_cond_broadcast(&priv->cond);
+    }
+  
+  pthread_mutex_unlock(&priv->mutex);
+  return NULL;
+  }
+
+/* Restart loading at frame */
+
+static void restart_sequence(image_t * priv, int64_t frame)
+  {
+  int i;
+  
+  pthread_mutex_lock(&priv->mutex);
+
+  /* Wait until no thread writes into the slots anymore */
+  priv->paused = 1;
+  while(priv->num_loading)
+    pthread_cond_wait(&priv->cond, &priv->mutex);
+
+  for(i = 0; i < PREFETCH_FRAMES; i++)
+    {
+    priv->slots[i].frame = -1;
+    priv->slots[i].state = SLOT_EMPTY;
+    }
+
+  priv->next_load = frame;
+  priv->next_read = frame;
+  priv->paused = 0;
+  
+  pthread_cond_broadcast(&priv->cond);
+  pthread_mutex_unlock(&priv->mutex);
+  }
+
 static int open_image(bgav_demuxer_context_t * ctx)
   {
   uint8_t probe_data[PROBE_LEN];
   bgav_stream_t * s;
+  image_t * priv;
+  int i;
+  
+  priv = calloc(1, sizeof(*priv));
+  ctx->priv = priv;
   
   /* Create track table */
 
@@ -136,16 +361,65 @@ static int open_image(bgav_demuxer_context_t * ctx)
     bgav_track_set_format(ctx->tt->cur, "JPEG image", "image/jpeg");
     s->ci->id = GAVL_CODEC_ID_JPEG;
     }
+  else if(is_tga(ctx->input->location))
+    {
+    s->fourcc = BGAV_MK_FOURCC('t', 'g', 'a', ' ');    
+    bgav_track_set_format(ctx->tt->cur, "TGA image", "image/x-tga");
+    }
+
+  s->data.video.format->pixel_width  = 1;
+  s->data.video.format->pixel_height = 1;  
+  
+  s->ci->flags &= ~(GAVL_COMPRESSION_HAS_B_FRAMES | GAVL_COMPRESSION_HAS_P_FRAMES);
+
+  /* Image sequences are opt-in and only for local files */
+  if(ctx->opt->image_sequence &&
+     (ctx->input->input == &bgav_input_file) &&
+     detect_sequence(priv, ctx->input->location))
+    {
+    gavl_log(GAVL_LOG_INFO, LOG_DOMAIN, "Detected image sequence: %"PRId64" frames",
+             priv->num_frames);
+    
+    pthread_mutex_init(&priv->mutex, NULL);
+    pthread_cond_init(&priv->cond, NULL);
+    
+    restart_sequence(priv, 0);
+    
+    for(i = 0; i < LOAD_THREADS; i++)
+      {
+      if(pthread_create(&priv->threads[i], NULL, load_thread, priv))
+        break;
+      priv->num_threads++;
+      }
+    
+    if(priv->num_threads)
+      {
+      s->data.video.format->timescale      = ctx->opt->image_sequence_timescale;
+      s->data.video.format->frame_duration = ctx->opt->image_sequence_frame_duration;
+      s->data.video.format->framerate_mode = GAVL_FRAMERATE_CONSTANT;
+      s->timescale = s->data.video.format->timescale;
+    
+      s->stats.pts_end = priv->num_frames * s->data.video.format->frame_duration;
+      
+      ctx->flags |= BGAV_DEMUXER_CAN_SEEK;
+      ctx->index_mode = INDEX_MODE_CONST;
+      return 1;
+      }
+    
+    /* Fall back to the single image */
+    gavl_log(GAVL_LOG_WARNING, LOG_DOMAIN,
+             "Cannot create loader threads, opening single image");
+    
+    pthread_mutex_destroy(&priv->mutex);
+    pthread_cond_destroy(&priv->cond);
+    priv->num_frames = 0;
+    }
   
   s->data.video.format->timescale = 1000; // Actually arbitrary since we only have pts = 0
   s->data.video.format->frame_duration = 0;
   s->data.video.format->framerate_mode = GAVL_FRAMERATE_STILL;
   
   s->timescale = s->data.video.format->timescale;
-  s->data.video.format->pixel_width  = 1;
-  s->data.video.format->pixel_height = 1;  
-  
-  s->ci->flags &= ~(GAVL_COMPRESSION_HAS_B_FRAMES | GAVL_COMPRESSION_HAS_P_FRAMES);
 
   s->stats.size_max = ctx->input->total_bytes;
   s->stats.size_min = ctx->input->total_bytes;
@@ -154,11 +428,70 @@ static int open_image(bgav_demuxer_context_t * ctx)
   return 1;
   }
 
+static gavl_source_status_t next_packet_sequence(bgav_demuxer_context_t * ctx)
+  {
+  bgav_packet_t * p;
+  bgav_stream_t * s;
+  slot_t * slot;
+  gavl_buffer_t buf;
+  int64_t frame;
+  image_t * priv = ctx->priv;
+  
+  pthread_mutex_lock(&priv->mutex);
+
+  frame = priv->next_read;
+  
+  if(frame >= priv->num_frames)
+    {
+    pthread_mutex_unlock(&priv->mutex);
+    return GAVL_SOURCE_EOF;
+    }
+  
+  slot = &priv->slots[frame % PREFETCH_FRAMES];
+
+  while((slot->frame != frame) ||
+        ((slot->state != SLOT_DONE) && (slot->state != SLOT_ERROR)))
+    pthread_cond_wait(&priv->cond, &priv->mutex);
+  
+  pthread_mutex_unlock(&priv->mutex);
+
+  if(slot->state == SLOT_ERROR)
+    return GAVL_SOURCE_EOF;
+  
+  s = bgav_track_get_video_stream(ctx->tt->cur, 0);
+  p = bgav_stream_get_packet_write(s);
+
+  /* Hand the file data over to the packet */
+  buf = p->buf;
+  p->buf = slot->buf;
+  slot->buf = buf;
+  gavl_buffer_reset(&slot->buf);
+  
+  p->position = frame;
+  p->pts = frame * s->data.video.format->frame_duration;
+  p->duration = s->data.video.format->frame_duration;
+  PACKET_SET_KEYFRAME(p);
+  
+  bgav_stream_done_packet_write(s, p);
+
+  pthread_mutex_lock(&priv->mutex);
+  slot->state = SLOT_EMPTY;
+  priv->next_read++;
+  pthread_cond_broadcast(&priv->cond);
+  pthread_mutex_unlock(&priv->mutex);
+  
+  return GAVL_SOURCE_OK;
+  }
+
 
 static gavl_source_status_t next_packet_image(bgav_demuxer_context_t * ctx)
   {
   bgav_packet_t * p;
   bgav_stream_t * s;
+  image_t * priv = ctx->priv;
+
+  if(priv->num_frames)
+    return next_packet_sequence(ctx);
   
   s = bgav_track_get_video_stream(ctx->tt->cur, 0);
   
@@ -180,8 +513,61 @@ static gavl_source_status_t next_packet_image(bgav_demuxer_context_t * ctx)
   return GAVL_SOURCE_OK;
   }
 
+static void seek_image(bgav_demuxer_context_t * ctx, int64_t time, int scale)
+  {
+  int64_t frame;
+  image_t * priv = ctx->priv;
+  bgav_stream_t * s = bgav_track_get_video_stream(ctx->tt->cur, 0);
+
+  if(!priv->num_frames)
+    {
+    bgav_input_seek(ctx->input, 0, SEEK_SET);
+    STREAM_SET_SYNC(s, 0);
+    return;
+    }
+  
+  frame = gavl_time_rescale(scale, s->data.video.format->timescale, time) /
+    s->data.video.format->frame_duration;
+
+  if(frame < 0)
+    frame = 0;
+  else if(frame >= priv->num_frames)
+    frame = priv->num_frames - 1;
+  
+  restart_sequence(priv, frame);
+  STREAM_SET_SYNC(s, frame * s->data.video.format->frame_duration);
+  }
+
 static void close_image(bgav_demuxer_context_t * ctx)
   {
+  int i;
+  image_t * priv = ctx->priv;
+
+  if(!priv)
+    return;
+  
+  if(priv->num_frames)
+    {
+    pthread_mutex_lock(&priv->mutex);
+    priv->quit = 1;
+    pthread_cond_broadcast(&priv->cond);
+    pthread_mutex_unlock(&priv->mutex);
+
+    for(i = 0; i < priv->num_threads; i++)
+      pthread_join(priv->threads[i], NULL);
+    
+    pthread_mutex_destroy(&priv->mutex);
+    pthread_cond_destroy(&priv->cond);
+    }
+
+  for(i = 0; i < PREFETCH_FRAMES; i++)
+    gavl_buffer_free(&priv->slots[i].buf);
+  
+  if(priv->prefix)
+    free(priv->prefix);
+  if(priv->suffix)
+    free(priv->suffix);
+  free(priv);
   }
 
 const bgav_demuxer_t bgav_demuxer_image =
@@ -189,5 +575,6 @@ const bgav_demuxer_t bgav_demuxer_image =
     .probe        = probe_image,
     .open         = open_image,
     .next_packet = next_packet_image,
+    .seek =        seek_image,
     .close =       close_image
   };
@@ -697,6 +697,13 @@ static void init_metadata(bgav_mkv_tag_t * tags, int num_tags,
 
 #define MAX_HEADER_LEN 16
 
+/* Callback for the block group reader */
+
+static int read_block_payload(void * priv, int64_t track)
+  {
+  return !!bgav_track_find_stream(priv, track);
+  }
+
 static int open_matroska(bgav_demuxer_context_t * ctx)
   {
   bgav_mkv_element_t e;
@@ -716,6 +723,9 @@ static int open_matroska(bgav_demuxer_context_t * ctx)
   ctx->priv = p;
   p->pts_offset = GAVL_TIME_UNDEFINED;
 
+  p->bg.read_payload = read_block_payload;
+  p->bg.read_payload_priv = ctx;
+
   ctx->index_mode = INDEX_MODE_MIXED;
   
   if(!bgav_mkv_ebml_header_read(ctx->input, &p->ebml_header))
@@ -971,13 +981,87 @@ static int get_ebml_frame_size_int(uint8_t * ptr1, int size, int64_t * ret)
   return bytes;
   }
 
-static void set_packet_data(bgav_stream_t * s,
-                            bgav_packet_t * p,
-                            const uint8_t * data,
-                            int len)
+/*
+ *  Block payload. For SimpleBlocks, the payload is read directly from
+ *  the input into the packets. Block groups have other elements after the
+ *  block, so their payload was read into b->data before.
+ */
+
+typedef struct
   {
-  bgav_mkv_track_t * t = s->priv;
+  bgav_input_context_t * input; /* NULL: Read from ptr */
+  const uint8_t * ptr;
+  int bytes_left;
+  } payload_t;
+
+static int payload_read(payload_t * pl, uint8_t * dst, int len)
+  {
+  if(len > pl->bytes_left)
+    return 0;
+
+  if(pl->input)
+    {
+    if(bgav_input_read_data(pl->input, dst, len) < len)
+      {
+      pl->bytes_left = 0;
+      return 0;
+      }
+    }
+  else
+    {
+    memcpy(dst, pl->ptr, len);
+    pl->ptr += len;
+    }
+  pl->bytes_left -= len;
+  return 1;
+  }
+
+static void payload_skip(payload_t * pl, int len)
+  {
+  if(len > pl->bytes_left)
+    len = pl->bytes_left;
+  
+  if(pl->input)
+    bgav_input_skip(pl->input, len);
+  else
+    pl->ptr += len;
+  pl->bytes_left -= len;
+  }
+
+/* Get len bytes as a contiguous buffer, use b->data as scratch buffer if necessary */
+
+static const uint8_t * payload_get(payload_t * pl, bgav_mkv_block_t * b, int len)
+  {
+  const uint8_t * ret;
+  
+  if(pl->input)
+    {
+    if(b->data_alloc < len)
+      {
+      b->data_alloc = len + 1024;
+      b->data = realloc(b->data, b->data_alloc);
+      }
+    if(!payload_read(pl, b->data, len))
+      return NULL;
+    return b->data;
+    }
+  
+  if(len > pl->bytes_left)
+    return NULL;
+  ret = pl->ptr;
+  payload_skip(pl, len);
+  return ret;
+  }
 
+static int set_packet_data(bgav_stream_t * s,
+                           bgav_packet_t * p,
+                           bgav_mkv_block_t * b,
+                           payload_t * pl,
+                           int len)
+  {
+  bgav_mkv_track_t * t = s->priv;
+  const uint8_t * data;
+  
   if(t->num_encodings == 1)
     {
     if((t->encodings[0].ContentEncodingType == MKV_CONTENT_ENCODING_COMPRESSION) &&
@@ -988,6 +1072,9 @@ static void set_packet_data(bgav_stream_t * s,
       /* zlib decompression (probably the dumbest possible routine,
          but it seems that this is used just for subtitles) */
 
+      if(!(data = payload_get(pl, b, len)))
+        return 0;
+      
       bgav_packet_alloc(p, len * 5); // Optimistically assume 1:5 ratio
     
       while(1)
@@ -1019,17 +1106,24 @@ static void set_packet_data(bgav_stream_t * s,
       memcpy(p->buf.buf,
              t->encodings[0].ContentCompression.ContentCompSettings,
              t->encodings[0].ContentCompression.ContentCompSettingsLen);
-      memcpy(p->buf.buf + t->encodings[0].ContentCompression.ContentCompSettingsLen, data, len);
+      if(!payload_read(pl, p->buf.buf + t->encodings[0].ContentCompression.ContentCompSettingsLen, len))
+        return 0;
       p->buf.len = t->encodings[0].ContentCompression.ContentCompSettingsLen + len;
       }
+    else
+      payload_skip(pl, len);
     }
   else if(t->num_encodings == 0)
     {
     /* Plain packet */
     bgav_packet_alloc(p, len);
-    memcpy(p->buf.buf, data, len);
+    if(!payload_read(pl, p->buf.buf, len))
+      return 0;
     p->buf.len = len;
     }
+  else
+    payload_skip(pl, len);
+  return 1;
   }
 
 static void setup_packet(mkv_t * m, bgav_stream_t * s,
@@ -1076,26 +1170,49 @@ static void setup_packet(mkv_t * m, bgav_stream_t * s,
   }
 
 
+/* Read an EBML coded lace size from the payload */
+
+static int read_lace_size(payload_t * pl, int is_signed, int64_t * ret)
+  {
+  uint8_t buf[8];
+  uint8_t mask = 0x80;
+  int len = 1;
+
+  if(!payload_read(pl, buf, 1))
+    return 0;
+
+  while(!(mask & buf[0]) && mask)
+    {
+    mask >>= 1;
+    len++;
+    }
+  if(!mask || ((len > 1) && !payload_read(pl, buf + 1, len - 1)))
+    return 0;
+
+  if(is_signed)
+    get_ebml_frame_size_int(buf, len, ret);
+  else
+    get_ebml_frame_size_uint(buf, len, ret);
+  return 1;
+  }
+
 static int process_block(bgav_demuxer_context_t * ctx,
+                         bgav_stream_t * s,
                          bgav_mkv_block_t * b,
-                         bgav_mkv_block_group_t * bg)
+                         bgav_mkv_block_group_t * bg,
+                         payload_t * pl)
   {
+  int i;
   int keyframe = 0;
-  bgav_stream_t * s;
   bgav_packet_t * p;
   mkv_t * m = ctx->priv;
   int64_t pts = b->timecode + m->cluster.Timecode - m->pts_offset;
-
-  
+  int result;
   
   //  if(pts > (1<<30))
   //  fprintf(stderr, "b->timecode: %d, m->cluster.Timecode: %"PRId64", m->pts_offset: %"PRId64"\n",
   //          b->timecode, m->cluster.Timecode, m->pts_offset);
   
-  s = bgav_track_find_stream(ctx, b->track);
-  if(!s)
-    return 1;
-  
   if(bg)
     {
     if(!bg->num_reference_blocks)
@@ -1108,6 +1225,17 @@ static int process_block(bgav_demuxer_context_t * ctx,
   
   //  if(s->type == GAVF_STREAM_AUDIO)
   //    fprintf(stderr, "Audio stream\n");
+
+  if(((b->flags & MKV_LACING_MASK) != MKV_LACING_NONE) &&
+     (m->lace_sizes_alloc < b->num_laces))
+    {
+    m->lace_sizes_alloc = b->num_laces + 16;
+    m->lace_sizes = realloc(m->lace_sizes,
+                            m->lace_sizes_alloc *
+                            sizeof(*m->lace_sizes));
+    }
+  
+  /* Get the lace sizes */
   
   switch(b->flags & MKV_LACING_MASK)
     {
@@ -1115,7 +1243,7 @@ static int process_block(bgav_demuxer_context_t * ctx,
       
       p = bgav_stream_get_packet_write(s);
       p->buf.len = 0;
-      set_packet_data(s, p, b->data, b->data_size);
+      result = set_packet_data(s, p, b, pl, pl->bytes_left);
       setup_packet(m, s, p, pts, keyframe, 0);
 
       if(s->type == GAVL_STREAM_TEXT)
@@ -1125,130 +1253,47 @@ static int process_block(bgav_demuxer_context_t * ctx,
         }
       
       bgav_stream_done_packet_write(s, p);
-      
+      return result;
       break;
     case MKV_LACING_EBML:
       {
-      int i;
-      uint8_t * ptr;
-      int bytes;
       int64_t frame_size;
       int64_t frame_size_diff = 0;
       
-      //      fprintf(stderr, "MKV_LACING_EBML\n");
-      //      gavl_hexdump(ptr, 32, 16);
-
-      if(m->lace_sizes_alloc < b->num_laces)
-        {
-        m->lace_sizes_alloc = b->num_laces + 16;
-        m->lace_sizes = realloc(m->lace_sizes,
-                                m->lace_sizes_alloc *
-                                sizeof(*m->lace_sizes));
-        }
       /* First lace */
-      ptr = b->data;
-      
-      bytes = get_ebml_frame_size_uint(ptr,
-                                       b->data_size - (ptr - b->data),
-                                       &frame_size);
-      if(!bytes)
+      if(!read_lace_size(pl, 0, &frame_size))
         return 0;
       
       m->lace_sizes[0] = frame_size;
-      ptr += bytes;
       
       /* Intermediate laces */
       for(i = 1; i < b->num_laces-1; i++)
         {
-        bytes = get_ebml_frame_size_int(ptr,
-                                        b->data_size - (ptr - b->data),
-                                        &frame_size_diff);
-        ptr += bytes;
+        if(!read_lace_size(pl, 1, &frame_size_diff))
+          return 0;
         frame_size += frame_size_diff;
         m->lace_sizes[i] = frame_size;
         }
-      /* Last lace */
-      m->lace_sizes[b->num_laces-1] =
-        b->data_size - (ptr - b->data);
-      for(i = 0; i < b->num_laces-1; i++)
-        m->lace_sizes[b->num_laces-1] -= m->lace_sizes[i];
-
-      /* Send all laces as different packets */
-      for(i = 0; i < b->num_laces; i++)
-        {
-        p = bgav_stream_get_packet_write(s);
-        p->buf.len = 0;
-        set_packet_data(s, p, ptr, m->lace_sizes[i]);
-        ptr += m->lace_sizes[i];
-        setup_packet(m, s, p, pts, keyframe, i);
-        bgav_stream_done_packet_write(s, p);
-        }
-      
       }
       break;
     case MKV_LACING_XIPH:
       {
-      uint8_t * ptr;
-      int i;
-      if(m->lace_sizes_alloc < b->num_laces)
-        {
-        m->lace_sizes_alloc = b->num_laces + 16;
-        m->lace_sizes = realloc(m->lace_sizes,
-                                m->lace_sizes_alloc *
-                                sizeof(*m->lace_sizes));
-        }
+      uint8_t c;
       
-      ptr = b->data;
       for(i = 0; i < b->num_laces-1; i++)
         {
         m->lace_sizes[i] = 0;
-        while(*ptr == 255)
-          {
-          m->lace_sizes[i] += *ptr;
-          ptr++;
-          }
-        m->lace_sizes[i] += *ptr;
-        ptr++;
+        do{
+          if(!payload_read(pl, &c, 1))
+            return 0;
+          m->lace_sizes[i] += c;
+          } while(c == 255);
         }
-      /* Last lace */
-      m->lace_sizes[b->num_laces-1] =
-        b->data_size - (ptr - b->data);
-      for(i = 0; i < b->num_laces-1; i++)
-        m->lace_sizes[b->num_laces-1] -= m->lace_sizes[i];
-
-      /* Send all laces as different packets */
-      for(i = 0; i < b->num_laces; i++)
-        {
-        p = bgav_stream_get_packet_write(s);
-        p->buf.len = 0;
-        set_packet_data(s, p, ptr, m->lace_sizes[i]);
-        ptr += m->lace_sizes[i];
-        setup_packet(m, s, p, pts, keyframe, i);
-        bgav_stream_done_packet_write(s, p);
-        }
-      
-      // bgav_input_skip_dump(ctx->input, b->data_size);
-      //      return 0;
       }
       break;
     case MKV_LACING_FIXED:
-      {
-      int i;
-      uint8_t * ptr;
-      int frame_size = b->data_size / b->num_laces;
-
-      ptr = b->data;
-      
-      for(i = 0; i < b->num_laces; i++)
-        {
-        p = bgav_stream_get_packet_write(s);
-        p->buf.len = 0;
-        set_packet_data(s, p, ptr, frame_size);
-        ptr += frame_size;
-        setup_packet(m, s, p, pts, keyframe, i);
-        bgav_stream_done_packet_write(s, p);
-        }
-      }
+      for(i = 0; i < b->num_laces-1; i++)
+        m->lace_sizes[i] = pl->bytes_left / b->num_laces;
       break;
     default:
       fprintf(stderr, "Unknown lacing type\n");
@@ -1257,6 +1302,30 @@ static int process_block(bgav_demuxer_context_t * ctx,
       return 0;
       break;
     }
+
+  /* Last lace */
+  m->lace_sizes[b->num_laces-1] = pl->bytes_left;
+  for(i = 0; i < b->num_laces-1; i++)
+    m->lace_sizes[b->num_laces-1] -= m->lace_sizes[i];
+
+  if((int64_t)m->lace_sizes[b->num_laces-1] < 0)
+    {
+    gavl_log(GAVL_LOG_ERROR, LOG_DOMAIN, "Invalid lace sizes");
+    return 0;
+    }
+  
+  /* Send all laces as different packets, each one is read
+     directly into its packet */
+  for(i = 0; i < b->num_laces; i++)
+    {
+    p = bgav_stream_get_packet_write(s);
+    p->buf.len = 0;
+    result = set_packet_data(s, p, b, pl, m->lace_sizes[i]);
+    setup_packet(m, s, p, pts, keyframe, i);
+    bgav_stream_done_packet_write(s, p);
+    if(!result)
+      return 0;
+    }
   return 1;
   }
 
@@ -1267,6 +1336,8 @@ static gavl_source_status_t next_packet_matroska(bgav_demuxer_context_t * ctx)
   int num_blocks = 0;
   bgav_mkv_element_t e;
   int64_t pos;
+  bgav_stream_t * s;
+  payload_t pl;
   mkv_t * priv = ctx->priv;
   //  fprintf(stderr, "next_packet_matroska\n");
   while(1)
@@ -1296,6 +1367,7 @@ static gavl_source_status_t next_packet_matroska(bgav_demuxer_context_t * ctx)
         priv->cluster_pos = pos;
         break;
       case MKV_ID_BlockGroup:
+        /* Payloads of unused tracks are skipped by the reader */
         if(!bgav_mkv_block_group_read(ctx->input, &priv->bg, &e))
           {
           //          fprintf(stderr, "bgav_mkv_block_group_read\n");
@@ -1304,8 +1376,16 @@ static gavl_source_status_t next_packet_matroska(bgav_demuxer_context_t * ctx)
         
         //        fprintf(stderr, "Got Block group\n");
         //        bgav_mkv_block_group_dump(&priv->bg);
+
+        if(priv->bg.block.skipped ||
+           !(s = bgav_track_find_stream(ctx, priv->bg.block.track)))
+          break;
+
+        pl.input = NULL;
+        pl.ptr = priv->bg.block.data;
+        pl.bytes_left = priv->bg.block.data_size;
         
-        if(!process_block(ctx, &priv->bg.block, &priv->bg))
+        if(!process_block(ctx, s, &priv->bg.block, &priv->bg, &pl))
           {
           //          fprintf(stderr, "process_block failed\n");
           return GAVL_SOURCE_EOF;
@@ -1314,19 +1394,35 @@ static gavl_source_status_t next_packet_matroska(bgav_demuxer_context_t * ctx)
         break;
       case MKV_ID_Block:
       case MKV_ID_SimpleBlock:
-        if(!bgav_mkv_block_read(ctx->input, &priv->bg.block, &e))
+        if(!bgav_mkv_block_read_header(ctx->input, &priv->bg.block, &e))
           {
           //          fprintf(stderr, "bgav_mkv_block_read failed\n");
           return GAVL_SOURCE_EOF;
           }
         //        fprintf(stderr, "Got Block\n");
         //        bgav_mkv_block_dump(0, &priv->bg.block);
+
+        /* Skip blocks of unused tracks without reading them */
+        if(!(s = bgav_track_find_stream(ctx, priv->bg.block.track)))
+          {
+          bgav_input_skip(ctx->input, priv->bg.block.data_size);
+          break;
+          }
+
+        pl.input = ctx->input;
+        pl.ptr = NULL;
+        pl.bytes_left = priv->bg.block.data_size;
         
-        if(!process_block(ctx, &priv->bg.block, NULL))
+        if(!process_block(ctx, s, &priv->bg.block, NULL, &pl))
           {
           //          fprintf(stderr, "process_block failed\n");
           return GAVL_SOURCE_EOF;
           }
+
+        /* Skip unused bytes */
+        if(pl.bytes_left > 0)
+          bgav_input_skip(ctx->input, pl.bytes_left);
+        
         num_blocks++;
         break;
       default:
@@ -44,6 +44,22 @@
 
 #define LOG_DOMAIN "mpegps"
 
+/* Seeking */
+
+/* Probes for finding SCR discontinuities in open() */
+#define SEGMENT_PROBES 16
+
+/* Stop bisecting if the range is smaller than this */
+#define BISECT_LINEAR_BYTES (64*1024)
+
+/* Maximum number of cached SCR probes */
+#define MAX_PROBES 1024
+
+/* Start this much (in 90 kHz ticks) before the target to catch a keyframe */
+#define SEEK_PREROLL 90000
+
+#define MAX_SEEK_TRIES 3
+
 /* Synchronization routines */
 
 #define IS_START_CODE(h)  ((h&0xffffff00)==0x00000100)
@@ -149,6 +165,27 @@ static void system_header_dump(system_header_t * h)
 #endif
 /* Demuxer structure */
 
+/* SCR of the first pack header at or after a file position */
+
+typedef struct
+  {
+  int64_t position;
+  int64_t pack_pos; /* -1 if no pack header was found */
+  int64_t scr;
+  } scr_probe_t;
+
+/* File range with continuous SCRs */
+
+typedef struct
+  {
+  int64_t start;
+  int64_t end;
+  int64_t scr_start;
+  int64_t scr_end;
+  /* Added to the PTS to make the timestamps continuous */
+  int64_t pts_offset;
+  } scr_segment_t;
+
 typedef struct
   {
   /* For sector based access */
@@ -173,7 +210,22 @@ typedef struct
 
   bgav_pack_header_t     pack_header;
   bgav_pes_header_t pes_header;
-    
+
+  /* Seeking */
+  scr_probe_t * probes;
+  int num_probes;
+  int probes_alloc;
+
+  scr_segment_t * segments;
+  int num_segments;
+  int segments_alloc;
+  bgav_track_t * segments_track;
+
+  /* On slow inputs, the segments are found only when seeking.
+     PTS offsets are not applied there to keep the timestamps
+     consistent with the ones from the start of playback */
+  int no_pts_offsets;
+  
   } mpegps_priv_t;
 
 static const int lpcm_freq_tab[4] = { 48000, 96000, 44100, 32000 };
@@ -368,6 +420,25 @@ static void init_stream(bgav_stream_t * s, uint32_t fourcc,
   s->stream_id = stream_id;
   }
 
+/* Offset for the PTS of a PES packet starting at position */
+
+static int64_t get_pts_offset(bgav_demuxer_context_t * ctx, int64_t position)
+  {
+  int i;
+  mpegps_priv_t * priv = ctx->priv;
+
+  if(priv->no_pts_offsets ||
+     (priv->segments_track != ctx->tt->cur) || (priv->num_segments < 2))
+    return 0;
+
+  for(i = priv->num_segments - 1; i > 0; i--)
+    {
+    if(priv->segments[i].start <= position)
+      break;
+    }
+  return priv->segments[i].pts_offset;
+  }
+
 /* Get one packet */
 
 static int next_packet(bgav_demuxer_context_t * ctx,
@@ -417,7 +488,10 @@ static int next_packet(bgav_demuxer_context_t * ctx,
 #endif
 
       if(priv->pes_header.pts != GAVL_TIME_UNDEFINED)
+        {
         priv->have_pts = 1;
+        priv->pes_header.pts += get_pts_offset(ctx, priv->position);
+        }
       
       /* Private stream 1 (non MPEG audio, subpictures) */
       if(priv->pes_header.stream_id == 0xbd)
@@ -797,55 +871,242 @@ static void find_streams(bgav_demuxer_context_t * ctx)
   return;
   }
 
-static void get_duration(bgav_demuxer_context_t * ctx)
+static int post_seek_resync_mpegps(bgav_demuxer_context_t * ctx)
   {
-  int64_t scr_start, scr_end;
+  uint32_t start_code;
+
+  if(ctx->input->block_size > 1)
+    {
+    int rest = ctx->input->position % ctx->input->block_size;
+    if(rest)
+      bgav_input_seek(ctx->input, ctx->input->position - rest, SEEK_SET);
+    }
+
+  while(1)
+    {
+    if(!(start_code = next_start_code(ctx->input)))
+      return 0;
+    if(start_code == START_CODE_PACK_HEADER)
+      break;
+    bgav_input_skip(ctx->input, 4);
+    }
+  return 1;
+  }
+
+static int64_t get_data_end(bgav_demuxer_context_t * ctx)
+  {
+  if(ctx->tt->cur->data_end > 0)
+    return ctx->tt->cur->data_end;
+  return ctx->input->total_bytes;
+  }
+
+/* Get the SCR of the first pack header after position. Results are cached
+   since we probe the same positions over and over again */
+
+static void probe_scr(bgav_demuxer_context_t * ctx, int64_t position,
+                      scr_probe_t * ret)
+  {
+  int i;
+  bgav_pack_header_t h;
+  mpegps_priv_t * priv = ctx->priv;
+
+  for(i = 0; i < priv->num_probes; i++)
+    {
+    if(priv->probes[i].position == position)
+      {
+      *ret = priv->probes[i];
+      return;
+      }
+    }
+
+  ret->position = position;
+  ret->pack_pos = -1;
+  ret->scr = GAVL_TIME_UNDEFINED;
+
+  bgav_input_seek(ctx->input, position, SEEK_SET);
+
+  if(post_seek_resync_mpegps(ctx))
+    {
+    position = ctx->input->position;
+    
+    if(bgav_pack_header_read(ctx->input, &h))
+      {
+      ret->pack_pos = position;
+      ret->scr = h.scr;
+      }
+    }
+
+  if(priv->num_probes == MAX_PROBES)
+    priv->num_probes = 0;
+  
+  if(priv->num_probes == priv->probes_alloc)
+    {
+    priv->probes_alloc += 64;
+    priv->probes = realloc(priv->probes, priv->probes_alloc * sizeof(*priv->probes));
+    }
+  priv->probes[priv->num_probes++] = *ret;
+  }
+
+/* Find the last pack header within the last megabyte */
+
+static int find_last_pack(bgav_demuxer_context_t * ctx, int64_t * position,
+                          bgav_pack_header_t * h)
+  {
+  int64_t end;
   uint32_t start_code = 0;
   
-  mpegps_priv_t * priv;
-  priv = ctx->priv;
+  end = get_data_end(ctx);
+  bgav_input_seek(ctx->input, end - 3, SEEK_SET);
+
+  while(start_code != START_CODE_PACK_HEADER)
+    {
+    /* Some files only have one pack header at the beginning */
+    if(ctx->input->position < end - 1024*1024)
+      return 0;
+    if(!(start_code = previous_start_code(ctx->input)))
+      return 0;
+    }
+  
+  *position = ctx->input->position;
+  return bgav_pack_header_read(ctx->input, h);
+  }
+
+static scr_segment_t * add_segment(mpegps_priv_t * priv, int64_t start, int64_t scr_start)
+  {
+  scr_segment_t * ret;
   
-  if(!ctx->input->total_bytes)
-    return; 
- 
-  if(ctx->input->flags & BGAV_INPUT_CAN_SEEK_BYTE)
+  if(priv->num_segments == priv->segments_alloc)
     {
-    /* We already have the first pack header */
-    scr_start = priv->pack_header.scr;
+    priv->segments_alloc += 16;
+    priv->segments = realloc(priv->segments, priv->segments_alloc * sizeof(*priv->segments));
+    }
+  ret = priv->segments + priv->num_segments;
+  priv->num_segments++;
+  
+  ret->start = start;
+  ret->scr_start = scr_start;
+  ret->end = -1;
+  ret->scr_end = scr_start;
+  return ret;
+  }
 
-    /* Get the last scr */
-    bgav_input_seek(ctx->input, -3, SEEK_END);
+/*
+ *  Split the data of the current track into ranges with continuous SCRs.
+ *  We probe the SCR at a few positions and bisect the intervals where it
+ *  goes backwards. Only one discontinuity per interval is found.
+ */
 
-    while(start_code != START_CODE_PACK_HEADER)
+static void find_segments(bgav_demuxer_context_t * ctx)
+  {
+  int i;
+  int64_t duration;
+  int64_t last_pos;
+  bgav_pack_header_t last_header;
+  scr_probe_t lo, hi, mid, p;
+  scr_segment_t * seg;
+  bgav_track_t * t = ctx->tt->cur;
+  mpegps_priv_t * priv = ctx->priv;
+
+  priv->num_segments = 0;
+  priv->segments_track = t;
+  
+  probe_scr(ctx, t->data_start, &lo);
+  
+  if((lo.pack_pos < 0) || !find_last_pack(ctx, &last_pos, &last_header))
+    {
+    bgav_input_seek(ctx->input, t->data_start, SEEK_SET);
+    return;
+    }
+  
+  seg = add_segment(priv, lo.pack_pos, lo.scr);
+  
+  for(i = 1; i <= SEGMENT_PROBES; i++)
+    {
+    if(i == SEGMENT_PROBES)
       {
-      /* Some files only have one pack header at the beginning */
-      if(ctx->input->position < ctx->input->total_bytes - 1024*1024)
-        break;
-      start_code = previous_start_code(ctx->input);
+      p.position = last_pos;
+      p.pack_pos = last_pos;
+      p.scr = last_header.scr;
       }
-        
-    if(!bgav_pack_header_read(ctx->input, &priv->pack_header))
+    else
       {
-      return;
+      probe_scr(ctx, lo.pack_pos + (last_pos - lo.pack_pos) / (SEGMENT_PROBES - i + 1), &p);
+      if((p.pack_pos <= lo.pack_pos) || (p.pack_pos >= last_pos))
+        continue;
       }
-    scr_end = priv->pack_header.scr;
-
-    gavl_track_set_duration(ctx->tt->cur->info, 
-                            ((int64_t)(scr_end - scr_start) * GAVL_TIME_SCALE) / 90000);
     
-    bgav_input_seek(ctx->input, ctx->tt->cur->data_start, SEEK_SET);
+    if(p.scr < lo.scr)
+      {
+      /* Discontinuity between lo and p */
+      hi = p;
+      
+      while(hi.pack_pos - lo.pack_pos > BISECT_LINEAR_BYTES)
+        {
+        probe_scr(ctx, lo.pack_pos + (hi.pack_pos - lo.pack_pos) / 2, &mid);
+        
+        if((mid.pack_pos <= lo.pack_pos) || (mid.pack_pos >= hi.pack_pos))
+          break;
+        
+        if(mid.scr >= lo.scr)
+          lo = mid;
+        else
+          hi = mid;
+        }
+
+      seg->end = hi.pack_pos;
+      seg->scr_end = lo.scr;
+      seg = add_segment(priv, hi.pack_pos, hi.scr);
+      }
+    lo = p;
     }
-#if 0
-  else if(ctx->input->total_bytes && priv->pack_header.mux_rate)
+
+  seg->end = get_data_end(ctx);
+  seg->scr_end = last_header.scr;
+
+  /* Each segment continues where the previous one ended */
+  duration = priv->segments[0].scr_start;
+  
+  for(i = 0; i < priv->num_segments; i++)
     {
-    gavl_track_set_duration(ctx->tt->cur->info, 
-                            (ctx->input->total_bytes * GAVL_TIME_SCALE)/
-                            (priv->pack_header.mux_rate*50));
+    priv->segments[i].pts_offset = duration - priv->segments[i].scr_start;
+    duration += priv->segments[i].scr_end - priv->segments[i].scr_start;
     }
-#endif
+  
+  if(priv->num_segments > 1)
+    gavl_log(GAVL_LOG_INFO, LOG_DOMAIN, "Found %d SCR discontinuities",
+             priv->num_segments - 1);
+  
+  bgav_input_seek(ctx->input, t->data_start, SEEK_SET);
   }
 
+static void get_duration(bgav_demuxer_context_t * ctx)
+  {
+  int i;
+  int64_t duration = 0;
+  int64_t last_pos;
+  bgav_pack_header_t last_header;
+  mpegps_priv_t * priv = ctx->priv;
 
+  if(priv->num_segments)
+    {
+    for(i = 0; i < priv->num_segments; i++)
+      duration += priv->segments[i].scr_end - priv->segments[i].scr_start;
+    }
+  else
+    {
+    /* Segments not known yet: Assume continuous SCRs */
+    if(!find_last_pack(ctx, &last_pos, &last_header))
+      {
+      bgav_input_seek(ctx->input, ctx->tt->cur->data_start, SEEK_SET);
+      return;
+      }
+    duration = last_header.scr - priv->pack_header.scr;
+    bgav_input_seek(ctx->input, ctx->tt->cur->data_start, SEEK_SET);
+    }
+  
+  gavl_track_set_duration(ctx->tt->cur->info, 
+                          gavl_time_unscale(90000, duration));
+  }
 
 /* Check for cdxa file, return 0 if there isn't one */
 #if 0
@@ -980,8 +1241,19 @@ static int open_mpegps(bgav_demuxer_context_t * ctx)
   if(!bgav_pack_header_read(ctx->input, &priv->pack_header))
     return 0;
   
-  if(gavl_track_get_duration(ctx->tt->cur->info) == GAVL_TIME_UNDEFINED)
-    get_duration(ctx);
+  if(ctx->input->total_bytes &&
+     (ctx->input->flags & BGAV_INPUT_CAN_SEEK_BYTE))
+    {
+    /* Finding the segments takes many seeks: On slow inputs, we
+       do this at the first seek */
+    if(!(ctx->input->flags & BGAV_INPUT_SEEK_SLOW))
+      find_segments(ctx);
+    else
+      priv->no_pts_offsets = 1;
+    
+    if(gavl_track_get_duration(ctx->tt->cur->info) == GAVL_TIME_UNDEFINED)
+      get_duration(ctx);
+    }
   
   if(need_streams)
     find_streams(ctx);
@@ -1030,71 +1302,151 @@ static int open_mpegps(bgav_demuxer_context_t * ctx)
   return 1;
   }
 
-#if 0
-static void seek_normal(bgav_demuxer_context_t * ctx, int64_t time,
-                        int scale)
-  {
-  mpegps_priv_t * priv;
-  int64_t file_position;
-  uint32_t header = 0;
+/* Find the last pack header in a segment whose SCR is at or before target */
 
-  gavl_time_t dur = gavl_track_get_duration(ctx->tt->cur->info);
-  
-  priv = ctx->priv;
+static int64_t bisect_scr(bgav_demuxer_context_t * ctx, const scr_segment_t * seg,
+                          int64_t target)
+  {
+  int i;
+  int64_t lo_pos, hi_pos, lo_scr, hi_scr;
+  int64_t position, margin;
+  scr_probe_t p;
+  mpegps_priv_t * priv = ctx->priv;
   
-  //  file_position = (priv->pack_header.mux_rate*50*time)/GAVL_TIME_SCALE;
-  /* Using double is ugly, but in integer, this can overflow for large file (even in 64 bit).
-     We do iterative seeking at this point anyway. */
-  file_position = ctx->tt->cur->data_start +
-    (int64_t)(priv->data_size * (double)gavl_time_unscale(scale, time)/(double)dur + 0.5);
+  if(target <= seg->scr_start)
+    return seg->start;
 
-  if(file_position <= ctx->tt->cur->data_start)
-    file_position = ctx->tt->cur->data_start+1;
-  if(file_position >= ctx->input->total_bytes)
-    file_position = ctx->input->total_bytes - 4;
+  lo_pos = seg->start;
+  lo_scr = seg->scr_start;
+  hi_pos = seg->end;
+  hi_scr = seg->scr_end;
 
-  while(1)
+  /* Narrow the range with the results of earlier seeks */
+  for(i = 0; i < priv->num_probes; i++)
+    {
+    if((priv->probes[i].pack_pos <= lo_pos) ||
+       (priv->probes[i].pack_pos >= hi_pos))
+      continue;
+
+    if(priv->probes[i].scr <= target)
+      {
+      lo_pos = priv->probes[i].pack_pos;
+      lo_scr = priv->probes[i].scr;
+      }
+    else
+      {
+      hi_pos = priv->probes[i].pack_pos;
+      hi_scr = priv->probes[i].scr;
+      }
+    }
+  
+  while(hi_pos - lo_pos > BISECT_LINEAR_BYTES)
     {
-    bgav_input_seek(ctx->input, file_position, SEEK_SET);
+    /* Interpolate, but make sure the range shrinks */
+    if(hi_scr > lo_scr)
+      position = lo_pos +
+        (int64_t)((double)(target - lo_scr) / (double)(hi_scr - lo_scr) *
+                  (double)(hi_pos - lo_pos));
+    else
+      position = lo_pos + (hi_pos - lo_pos) / 2;
+
+    margin = (hi_pos - lo_pos) / 8;
+    
+    if(position < lo_pos + margin)
+      position = lo_pos + margin;
+    if(position > hi_pos - margin)
+      position = hi_pos - margin;
+
+    probe_scr(ctx, position, &p);
     
-    while(header != START_CODE_PACK_HEADER)
+    if((p.pack_pos < 0) || (p.pack_pos >= hi_pos))
+      hi_pos = position;
+    else if(p.scr <= target)
       {
-      header = previous_start_code(ctx->input);
+      lo_pos = p.pack_pos;
+      lo_scr = p.scr;
       }
-    if(do_sync(ctx))
-      break;
     else
       {
-      file_position -= 2000; /* Go a bit back */
-      if(file_position <= ctx->tt->cur->data_start)
-        {
-        break; /* Escape from inifinite loop */
-        }
+      hi_pos = p.pack_pos;
+      hi_scr = p.scr;
       }
     }
+  return lo_pos;
   }
-#endif
 
-static int post_seek_resync_mpegps(bgav_demuxer_context_t * ctx)
+static void seek_mpegps(bgav_demuxer_context_t * ctx, int64_t time, int scale)
   {
-  uint32_t start_code;
+  int i;
+  int64_t time_90k, goal, target, sync_time, position, duration;
+  scr_segment_t * seg;
+  mpegps_priv_t * priv = ctx->priv;
+  bgav_track_t * t = ctx->tt->cur;
 
-  if(ctx->input->block_size > 1)
+  if(priv->segments_track != t)
+    find_segments(ctx);
+  
+  if(!priv->num_segments)
     {
-    int rest = ctx->input->position % ctx->input->block_size;
-    if(rest)
-      bgav_input_seek(ctx->input, ctx->input->position - rest, SEEK_SET);
+    /* Nothing to bisect on */
+    bgav_input_seek(ctx->input, t->data_start, SEEK_SET);
+    return;
     }
 
-  while(1)
+  /* Get the segment and the goal in its timestamps */
+
+  time_90k = gavl_time_rescale(scale, 90000, time);
+
+  if(priv->no_pts_offsets)
     {
-    if(!(start_code = next_start_code(ctx->input)))
-      return 0;
-    if(start_code == START_CODE_PACK_HEADER)
+    /* Timestamps are the raw ones: Take the first segment containing them */
+    for(i = 0; i < priv->num_segments - 1; i++)
+      {
+      if((time_90k >= priv->segments[i].scr_start) &&
+         (time_90k < priv->segments[i].scr_end))
+        break;
+      }
+    seg = priv->segments + i;
+    goal = time_90k;
+    }
+  else
+    {
+    goal = time_90k - priv->segments[0].scr_start;
+  
+    for(i = 0; i < priv->num_segments - 1; i++)
+      {
+      duration = priv->segments[i].scr_end - priv->segments[i].scr_start;
+      if(goal < duration)
+        break;
+      goal -= duration;
+      }
+    seg = priv->segments + i;
+    goal += seg->scr_start;
+    }
+  
+  target = goal - SEEK_PREROLL;
+
+  for(i = 0; i < MAX_SEEK_TRIES; i++)
+    {
+    position = bisect_scr(ctx, seg, target);
+
+    bgav_track_clear(t);
+    bgav_input_seek(ctx->input, position, SEEK_SET);
+    
+    if(!post_seek_resync_mpegps(ctx) || (position <= seg->start))
       break;
-    bgav_input_skip(ctx->input, 4);
+
+    /* Check if we are before the goal. The packet timestamps
+       include the segment offset unless no_pts_offsets is set */
+    
+    sync_time = bgav_track_sync_time(t, 90000);
+    
+    if((sync_time == GAVL_TIME_UNDEFINED) || (sync_time <= time_90k))
+      break;
+
+    /* Keyframes are farther apart than we thought */
+    target -= sync_time - time_90k + SEEK_PREROLL;
     }
-  return 1;
   }
 
 static void close_mpegps(bgav_demuxer_context_t * ctx)
@@ -1108,6 +1460,10 @@ static void close_mpegps(bgav_demuxer_context_t * ctx)
     bgav_input_close(priv->input_mem);
     bgav_input_destroy(priv->input_mem);
     }
+  if(priv->probes)
+    free(priv->probes);
+  if(priv->segments)
+    free(priv->segments);
   free(priv);
   }
 
@@ -1119,6 +1475,6 @@ const bgav_demuxer_t bgav_demuxer_mpegps =
     .select_track =   select_track_mpegps,
     .next_packet  =   next_packet_mpegps,
     .post_seek_resync =   post_seek_resync_mpegps,
-    //    .seek =           seek_mpegps,
+    .seek =           seek_mpegps,
     .close =          close_mpegps
   };
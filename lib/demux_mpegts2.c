@@ -30,6 +30,8 @@
 
 #define LOG_DOMAIN "mpegts2"
 
+#define NUM_PIDS 0x2000
+
 typedef struct
   {
   uint16_t pmt_pid;
@@ -50,6 +52,12 @@ typedef struct
   gavl_buffer_t buf;
 
   bgav_input_context_t * pes_parser;
+
+  /* PID -> stream table for the track pid_track. It is rebuilt
+     if the track changes or streams were removed */
+  bgav_stream_t ** pid_streams;
+  bgav_track_t * pid_track;
+  int pid_num_streams;
   
   } mpegts_priv_t;
 
@@ -106,6 +114,9 @@ static int init_psi(bgav_demuxer_context_t * ctx)
   int skip;
   int ret = 0;
   int done = 0;
+  int all_programs;
+  int num_streams;
+  bgav_track_t * track;
   mpegts_priv_t * priv = ctx->priv;
 
   if(!(ctx->input->flags & BGAV_INPUT_CAN_SEEK_BYTE))
@@ -184,19 +195,27 @@ static int init_psi(bgav_demuxer_context_t * ctx)
   for(i = 0; i < pats.num_programs; i++)
     {
     if(!pats.programs[i].program_number)
-      {
-      i++;
       continue;
-      }
     priv->programs[j].pmt_pid = pats.programs[i].program_map_pid;
     j++;
     }
 
-  ctx->tt = bgav_track_table_create(priv->num_programs);
+  /* In all programs mode, all streams go into one track */
+  all_programs = ctx->opt->mpegts_all_programs && (priv->num_programs > 1);
   
-  for(i = 0; i < priv->num_programs; i++)
+  if(all_programs)
     {
-    ctx->tt->tracks[i]->priv = &priv->programs[i];
+    ctx->tt = bgav_track_table_create(1);
+    ctx->tt->tracks[0]->priv = &priv->programs[0];
+    }
+  else
+    {
+    ctx->tt = bgav_track_table_create(priv->num_programs);
+  
+    for(i = 0; i < priv->num_programs; i++)
+      {
+      ctx->tt->tracks[i]->priv = &priv->programs[i];
+      }
     }
   
   /* Scan for PMTs */
@@ -238,14 +257,32 @@ static int init_psi(bgav_demuxer_context_t * ctx)
           }
 
         priv->programs[i].pcr_pid = pmts.pcr_pid;
+
+        track = all_programs ? ctx->tt->tracks[0] : ctx->tt->tracks[i];
+        num_streams = track->num_streams;
         
         if(bgav_pmt_section_setup_track(&pmts,
-                                        ctx->tt->tracks[i],
+                                        track,
                                         ctx->opt, -1, -1, -1, NULL, NULL))
           {
-          bgav_track_set_format(ctx->tt->tracks[i], "MPEGTS", "video/MP2T");
+          bgav_track_set_format(track, "MPEGTS", "video/MP2T");
+          priv->programs[i].has_pmt = 1;
+
+          if(all_programs)
+            {
+            for(j = num_streams; j < track->num_streams; j++)
+              gavl_dictionary_set_int(track->streams[j]->m, BGAV_META_PROGRAM,
+                                      pmts.program_number);
+            }
+          else
+            track->priv = &priv->programs[i];
+          }
+        else if(all_programs)
+          {
+          /* Programs without usable streams are ok if we have others */
           priv->programs[i].has_pmt = 1;
-          ctx->tt->tracks[i]->priv = &priv->programs[i];
+          gavl_log(GAVL_LOG_WARNING, LOG_DOMAIN, "No usable streams in program %d",
+                   pmts.program_number);
           }
         else
           {
@@ -257,9 +294,9 @@ static int init_psi(bgav_demuxer_context_t * ctx)
 
         done = 1;
 
-        for(j = 0; j < ctx->tt->num_tracks; j++)
+        for(j = 0; j < priv->num_programs; j++)
           {
-          if(!priv->programs[i].has_pmt)
+          if(!priv->programs[j].has_pmt)
             {
             done = 0;
             break;
@@ -325,6 +362,7 @@ static int open_mpegts(bgav_demuxer_context_t * ctx)
   
   gavl_buffer_alloc(&priv->buf, priv->packet_size);
   priv->pes_parser = bgav_input_open_memory(NULL, 0);
+  priv->pid_streams = calloc(NUM_PIDS, sizeof(*priv->pid_streams));
   
   if(ctx->input->flags & (BGAV_INPUT_CAN_SEEK_BYTE | BGAV_INPUT_CAN_SEEK_TIME))
     ctx->flags |= BGAV_DEMUXER_CAN_SEEK;
@@ -333,6 +371,46 @@ static int open_mpegts(bgav_demuxer_context_t * ctx)
   return 1;
   }
 
+/* Find the stream for a PID. This is called for each transport packet,
+   so we use a table instead of bgav_track_find_stream() */
+
+static bgav_stream_t * get_stream(bgav_demuxer_context_t * ctx, int pid)
+  {
+  int i;
+  bgav_stream_t * s;
+  mpegts_priv_t * priv = ctx->priv;
+
+  if((priv->pid_track != ctx->tt->cur) ||
+     (priv->pid_num_streams != ctx->tt->cur->num_streams))
+    {
+    memset(priv->pid_streams, 0, NUM_PIDS * sizeof(*priv->pid_streams));
+
+    for(i = 0; i < ctx->tt->cur->num_streams; i++)
+      {
+      s = ctx->tt->cur->streams[i];
+      if((s->stream_id < 0) || (s->stream_id >= NUM_PIDS))
+        continue;
+
+      /* Like bgav_track_find_stream(), the first stream with a PID wins */
+      if(priv->pid_streams[s->stream_id])
+        gavl_log(GAVL_LOG_WARNING, LOG_DOMAIN,
+                 "PID %d is used by more than one stream, decoding only the first one",
+                 s->stream_id);
+      else
+        priv->pid_streams[s->stream_id] = s;
+      }
+    priv->pid_track = ctx->tt->cur;
+    priv->pid_num_streams = ctx->tt->cur->num_streams;
+    }
+
+  s = priv->pid_streams[pid];
+
+  if(s && (s->action != BGAV_STREAM_MUTE) &&
+     !(s->flags & STREAM_EOF_D))
+    return s;
+  return NULL;
+  }
+
 static gavl_source_status_t next_packet_mpegts(bgav_demuxer_context_t * ctx)
   {
   mpegts_priv_t * priv;
@@ -378,7 +456,7 @@ static gavl_source_status_t next_packet_mpegts(bgav_demuxer_context_t * ctx)
     //      fprintf(stderr, "Got PID %04x\n", pkt.pid);      
     
     /* Check if this belongs to a stream */
-    s = bgav_track_find_stream(ctx, pkt.pid);
+    s = get_stream(ctx, pkt.pid);
 
     if(!s)
       {
@@ -485,6 +563,8 @@ static void close_mpegts(bgav_demuxer_context_t * ctx)
   
   if(priv->programs)
     free(priv->programs);
+  if(priv->pid_streams)
+    free(priv->pid_streams);
   
   free(priv);
   }
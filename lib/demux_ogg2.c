@@ -27,6 +27,18 @@
 #define MAX_PAGE_BYTES 65307
 #define MIN_HEADER_BYTES 27
 
+/* Bytes read at once when scanning for the capture pattern */
+#define SCAN_BYTES 4096
+
+/* Below this range, bisection falls back to a linear page scan */
+#define BISECT_LINEAR_BYTES 65536
+
+/* Maximum number of cached bisection probes */
+#define MAX_PROBES 1024
+
+/* Recommended decoder preroll for Opus (80 ms) */
+#define OPUS_PREROLL 3840
+
 #include <avdec_private.h>
 #include <ogg_header.h>
 #include <vorbis_comment.h>
@@ -66,9 +78,31 @@ typedef struct
   gavl_dictionary_t m;
 
   int flags;
+
+  /* Theora only */
+  int keyframe_granule_shift;
   
   }  ogg_stream_t;
 
+/* Result of a bisection probe: The first page of a stream with a valid
+   granulepos at or after a file position */
+
+typedef struct
+  {
+  int64_t position;
+  uint32_t serialno;
+  
+  int64_t page_pos; /* -1 if no page was found */
+  int64_t granulepos;
+  } probe_t;
+
+typedef struct
+  {
+  probe_t * probes;
+  int num_probes;
+  int probes_alloc;
+  } ogg_t;
+
 
 static int
 stream_append_header_packet(bgav_stream_t * s, const gavl_buffer_t * buf);
@@ -329,6 +363,7 @@ static void init_chained(bgav_demuxer_context_t * ctx, int last_page_serialno)
 
 static int open_ogg(bgav_demuxer_context_t * ctx)
   {
+  ctx->priv = calloc(1, sizeof(ogg_t));
   ctx->tt = bgav_track_table_create(1);
 
   if(!init_track(ctx, ctx->tt->cur))
@@ -606,6 +641,8 @@ static void sync_streams(bgav_demuxer_context_t * ctx, int64_t t)
     
     sp = ctx->tt->cur->streams[i]->priv;
     sp->prev_granulepos = t;
+    sp->flags &= ~FLAG_DO_RESYNC;
+    
     if(t == GAVL_TIME_UNDEFINED)
       sp->flags |= FLAG_UNSYNC;
     else if(!t)
@@ -614,59 +651,333 @@ static void sync_streams(bgav_demuxer_context_t * ctx, int64_t t)
   
   }
 
-static int post_seek_resync_ogg(bgav_demuxer_context_t * ctx)
+/* We don't bother calculating CRC. Instead we check for the "OggS" pattern where we expect
+   it */
+
+static int check_page(bgav_demuxer_context_t * ctx, int64_t position, int64_t end)
   {
-  int i;
-  int64_t position;
   bgav_ogg_page_t ph;
 
-  sync_streams(ctx, GAVL_TIME_UNDEFINED);
+  bgav_input_seek(ctx->input, position, SEEK_SET);
   
-  /* We don't bother calculating CRC. Instead we check for the "OggS" pattern where we expect
-     it */
+  if(!bgav_ogg_page_read_header(ctx->input, &ph) ||
+     ph.stream_structure_version)
+    return 0;
+
+  bgav_ogg_page_skip(ctx->input, &ph);
+  
+  /* Check for next page */
+  if(ctx->input->position >= end)
+    return 1;
+  
+  return bgav_ogg_probe(ctx->input);
+  }
+
+/*
+ *  Find the first valid page starting at position. Returns the page position or
+ *  -1. The input position is undefined afterwards.
+ */
+
+static int64_t find_page(bgav_demuxer_context_t * ctx, int64_t position, int64_t end)
+  {
+  uint8_t buf[SCAN_BYTES];
+  uint8_t * ptr;
+  int len;
+  int64_t limit = position + MAX_PAGE_BYTES;
+  
+  if((ctx->input->total_bytes > 0) && (end > ctx->input->total_bytes))
+    end = ctx->input->total_bytes;
   
-  for(i = 0; i < MAX_PAGE_BYTES; i++)
+  while((position < limit) && (position < end - MIN_HEADER_BYTES))
     {
-    if(ctx->input->position >= ctx->input->total_bytes - MIN_HEADER_BYTES)
-      return 0;
+    bgav_input_seek(ctx->input, position, SEEK_SET);
     
-    if(!bgav_ogg_probe(ctx->input))
+    if((len = bgav_input_read_data(ctx->input, buf, SCAN_BYTES)) < 4)
+      return -1;
+    
+    ptr = buf;
+    
+    while((ptr = memchr(ptr, 'O', len - 3 - (ptr - buf))))
       {
-      bgav_input_skip(ctx->input, 1);
-      continue;
+      if(!memcmp(ptr, "OggS", 4) &&
+         check_page(ctx, position + (ptr - buf), end))
+        return position + (ptr - buf);
+      ptr++;
       }
-    position = ctx->input->position;
     
-    /* Check for next page */
-    if(!bgav_ogg_page_read_header(ctx->input, &ph))
-      return 0;
+    /* Patterns can span chunk boundaries */
+    position += len - 3;
+    }
+  return -1;
+  }
 
-    bgav_ogg_page_skip(ctx->input, &ph);
-    
-    if(ctx->input->position == ctx->input->total_bytes)
+static int post_seek_resync_ogg(bgav_demuxer_context_t * ctx)
+  {
+  int64_t position;
+
+  sync_streams(ctx, GAVL_TIME_UNDEFINED);
+
+  if((position = find_page(ctx, ctx->input->position, ctx->input->total_bytes)) < 0)
+    return 0;
+  
+  bgav_input_seek(ctx->input, position, SEEK_SET);
+  return 1;
+  }
+
+static int64_t get_data_end(bgav_demuxer_context_t * ctx)
+  {
+  if(ctx->tt->cur->data_end > 0)
+    return ctx->tt->cur->data_end;
+  return ctx->input->total_bytes;
+  }
+
+/* Comparable position of a granulepos: Samples for audio, frames for theora */
+
+static int64_t granule_key(const ogg_stream_t * sp, int64_t granulepos)
+  {
+  int64_t keyframe;
+  
+  if((sp->fourcc != FOURCC_THEORA) || !sp->keyframe_granule_shift)
+    return granulepos;
+
+  keyframe = granulepos >> sp->keyframe_granule_shift;
+  return keyframe + (granulepos - (keyframe << sp->keyframe_granule_shift));
+  }
+
+/* Probe a file position. Results are cached since bisections tend to
+   probe the same positions over and over again */
+
+static void probe_position(bgav_demuxer_context_t * ctx, bgav_stream_t * s,
+                           int64_t position, probe_t * ret)
+  {
+  int i;
+  int64_t end;
+  bgav_ogg_page_t ph;
+  ogg_t * priv = ctx->priv;
+  
+  for(i = 0; i < priv->num_probes; i++)
+    {
+    if((priv->probes[i].position == position) &&
+       (priv->probes[i].serialno == s->stream_id))
       {
-      bgav_input_seek(ctx->input, position, SEEK_SET);
-      return 1;
+      *ret = priv->probes[i];
+      return;
       }
-       
-    if(bgav_ogg_probe(ctx->input))
+    }
+  
+  ret->position = position;
+  ret->serialno = s->stream_id;
+  ret->page_pos = -1;
+  ret->granulepos = -1;
+
+  end = get_data_end(ctx);
+  
+  if((position = find_page(ctx, position, end)) >= 0)
+    {
+    bgav_input_seek(ctx->input, position, SEEK_SET);
+
+    while(ctx->input->position < end)
+      {
+      if(!bgav_ogg_probe(ctx->input) ||
+         !bgav_ogg_page_read_header(ctx->input, &ph) ||
+         (ph.header_type_flags & BGAV_OGG_HEADER_TYPE_BOS))
+        break;
+
+      if((ph.serialno == s->stream_id) && (ph.granulepos != -1))
+        {
+        ret->page_pos = ph.position;
+        ret->granulepos = ph.granulepos;
+        break;
+        }
+      bgav_ogg_page_skip(ctx->input, &ph);
+      }
+    }
+  
+  if(priv->num_probes == MAX_PROBES)
+    priv->num_probes = 0;
+  
+  if(priv->num_probes == priv->probes_alloc)
+    {
+    priv->probes_alloc += 64;
+    priv->probes = realloc(priv->probes, priv->probes_alloc * sizeof(*priv->probes));
+    }
+  priv->probes[priv->num_probes++] = *ret;
+  }
+
+/*
+ *  Find the last page of a stream, whose granulepos is at or before target.
+ *  Returns the page position or -1 if there is no such page.
+ *  granulepos is set to the granulepos of the page found,
+ *  next_granulepos to the one of the following page of the stream (or -1).
+ */
+
+static int64_t bisect_stream(bgav_demuxer_context_t * ctx, bgav_stream_t * s,
+                             int64_t target, int64_t * granulepos,
+                             int64_t * next_granulepos)
+  {
+  int64_t lo, hi, mid, end;
+  int64_t ret = -1;
+  probe_t p;
+  bgav_ogg_page_t ph;
+  ogg_stream_t * sp = s->priv;
+
+  end = get_data_end(ctx);
+  lo = ctx->tt->cur->data_start;
+  hi = end;
+  
+  *granulepos = -1;
+  *next_granulepos = -1;
+  
+  while(hi - lo > BISECT_LINEAR_BYTES)
+    {
+    mid = lo + (hi - lo) / 2;
+    probe_position(ctx, s, mid, &p);
+    
+    if((p.page_pos >= 0) && (granule_key(sp, p.granulepos) <= target))
       {
-      bgav_input_seek(ctx->input, position, SEEK_SET);
-      return 1;
+      ret = p.page_pos;
+      *granulepos = p.granulepos;
+      lo = p.page_pos;
       }
     else
-      bgav_input_seek(ctx->input, position+1, SEEK_SET);
+      hi = mid;
     }
-  return 0;
+
+  /* Linear scan over the remaining pages */
+  bgav_input_seek(ctx->input, lo, SEEK_SET);
+
+  while(ctx->input->position < end)
+    {
+    if(!bgav_ogg_probe(ctx->input) ||
+       !bgav_ogg_page_read_header(ctx->input, &ph) ||
+       (ph.header_type_flags & BGAV_OGG_HEADER_TYPE_BOS))
+      break;
+    
+    if((ph.serialno == s->stream_id) && (ph.granulepos != -1))
+      {
+      if(granule_key(sp, ph.granulepos) > target)
+        {
+        *next_granulepos = ph.granulepos;
+        break;
+        }
+      ret = ph.position;
+      *granulepos = ph.granulepos;
+      }
+    bgav_ogg_page_skip(ctx->input, &ph);
+    }
+  return ret;
+  }
+
+/*
+ *  Get the file position from where a stream must be decoded to reach time.
+ *  Returns -1 if the stream can't be used for seeking.
+ */
+
+static int64_t stream_seek_position(bgav_demuxer_context_t * ctx, bgav_stream_t * s,
+                                    int64_t time, int scale)
+  {
+  int64_t target;
+  int64_t position;
+  int64_t granulepos;
+  int64_t next_granulepos;
+  int64_t keyframe;
+  ogg_stream_t * sp = s->priv;
+  
+  switch(sp->fourcc)
+    {
+    case FOURCC_VORBIS:
+    case FOURCC_FLAC:
+    case FOURCC_FLAC_NEW:
+    case FOURCC_SPEEX:
+      target = gavl_time_rescale(scale, s->data.audio.format->samplerate, time);
+      break;
+    case FOURCC_OPUS:
+      /* The granulepos includes the pre-skip samples */
+      target = gavl_time_rescale(scale, s->data.audio.format->samplerate, time) +
+        s->ci->pre_skip - OPUS_PREROLL;
+
+      /* Samples within the pre-skip range need decoding from the start */
+      if(target < s->ci->pre_skip)
+        return ctx->tt->cur->data_start;
+      break;
+    case FOURCC_THEORA:
+      if(!s->data.video.format->frame_duration)
+        return -1;
+      
+      target = gavl_time_rescale(scale, s->data.video.format->timescale, time) /
+        s->data.video.format->frame_duration;
+
+      if(bisect_stream(ctx, s, target, &granulepos, &next_granulepos) < 0)
+        return ctx->tt->cur->data_start;
+
+      /* Go back to the page before the last keyframe. The next page
+         might tell us about a keyframe, which is closer to the target */
+      
+      keyframe = granulepos >> sp->keyframe_granule_shift;
+      
+      if((next_granulepos != -1) &&
+         ((next_granulepos >> sp->keyframe_granule_shift) <= target) &&
+         ((next_granulepos >> sp->keyframe_granule_shift) > keyframe))
+        keyframe = next_granulepos >> sp->keyframe_granule_shift;
+      
+      target = keyframe - 1;
+      break;
+    default:
+      return -1;
+    }
+  
+  if((position = bisect_stream(ctx, s, target, &granulepos, &next_granulepos)) < 0)
+    return ctx->tt->cur->data_start;
+  return position;
+  }
+
+static void seek_ogg(bgav_demuxer_context_t * ctx, int64_t time, int scale)
+  {
+  int i;
+  int64_t position;
+  int64_t min_position = -1;
+  bgav_stream_t * s;
+  bgav_track_t * t = ctx->tt->cur;
+  
+  /* Start from the earliest position needed by any of the streams */
+  for(i = 0; i < t->num_streams; i++)
+    {
+    s = t->streams[i];
+    
+    if((s->type == GAVL_STREAM_MSG) ||
+       (s->action == BGAV_STREAM_MUTE))
+      continue;
+    
+    if((position = stream_seek_position(ctx, s, time, scale)) < 0)
+      continue;
+    
+    if((min_position < 0) || (position < min_position))
+      min_position = position;
+    }
+
+  if(min_position <= t->data_start)
+    {
+    bgav_input_seek(ctx->input, t->data_start, SEEK_SET);
+    sync_streams(ctx, 0);
+    return;
+    }
+
+  /* next_packet_ogg() picks up the timestamps from the granulepos */
+  bgav_input_seek(ctx->input, min_position, SEEK_SET);
+  sync_streams(ctx, GAVL_TIME_UNDEFINED);
   }
 
-#if 0
 static void close_ogg(bgav_demuxer_context_t * ctx)
   {
   ogg_t * priv = ctx->priv;
+
+  if(!priv)
+    return;
+  
+  if(priv->probes)
+    free(priv->probes);
   free(priv);
   }
-#endif
 
 static int select_track_ogg(bgav_demuxer_context_t * ctx, int track)
   {
@@ -685,8 +996,9 @@ const bgav_demuxer_t bgav_demuxer_ogg2 =
     .open =         open_ogg,
     .next_packet =  next_packet_ogg,
     .post_seek_resync =  post_seek_resync_ogg,
-    // .seek =         seek_ogg,
-    .select_track = select_track_ogg
+    .seek =         seek_ogg,
+    .select_track = select_track_ogg,
+    .close =        close_ogg
   };
 
 /* Codec specific struff goes here */
@@ -786,6 +1098,11 @@ static int stream_append_header_packet(bgav_stream_t * s, const gavl_buffer_t *
     {
     case FOURCC_VORBIS: 
     case FOURCC_THEORA:
+      /* Theora identification header: KFGSHIFT follows the 6 bit quality */
+      if((p->fourcc == FOURCC_THEORA) && (p->header_packets_read == 1) &&
+         (buf->len >= 42))
+        p->keyframe_granule_shift = ((buf->buf[40] & 0x03) << 3) | (buf->buf[41] >> 5);
+      
       if(p->header_packets_read == 2)
         parse_vorbis_comment(s, buf->buf + 7, buf->len - 7);
       gavl_append_xiph_header(&s->ci->codec_header, buf->buf, buf->len);
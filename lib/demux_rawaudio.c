@@ -191,16 +191,17 @@ static void seek_rawaudio(bgav_demuxer_context_t * ctx, int64_t time, int scale)
 
   if(s->data.audio.bits_per_sample)
     {
-    file_position = s->data.audio.block_align * gavl_time_rescale(scale,
-                                                                  s->data.audio.format->samplerate,
-                                                                  time);
-    }
-  else
-    {
-    file_position = (gavl_time_unscale(scale, time) * (s->codec_bitrate / 8)) / scale;
-    file_position /= s->data.audio.block_align;
-    file_position *= s->data.audio.block_align;
+    /* One sample per block */
+    STREAM_SET_SYNC(s, bgav_demuxer_seek_const(ctx, time, scale,
+                                               s->data.audio.format->samplerate,
+                                               1, s->data.audio.block_align));
+    return;
     }
+  
+  file_position = (gavl_time_unscale(scale, time) * (s->codec_bitrate / 8)) / scale;
+  file_position /= s->data.audio.block_align;
+  file_position *= s->data.audio.block_align;
+  
   /* Calculate the time before we add the start offset */
   STREAM_SET_SYNC(s, (int64_t)file_position / s->data.audio.block_align);
   
@@ -56,27 +56,35 @@ typedef struct
   int pict_type;
   } frame_info_t;
 
+/* Index records are sorted by timestamp: Binary search for the
+   last record before millisecs */
+
 static uint32_t seek_indx(bgav_rmff_indx_t * indx, uint32_t millisecs,
                           uint32_t * position, uint32_t * start_packet,
                           uint32_t * end_packet)
   {
-  uint32_t ret;
-  ret = indx->num_indices - 1;
-  while(ret)
+  uint32_t lo, hi, mid;
+
+  lo = 0;
+  hi = indx->num_indices - 1;
+  
+  while(lo < hi)
     {
-    if(indx->records[ret].timestamp < millisecs)
-      break;
-    ret--;
+    mid = lo + (hi - lo + 1) / 2;
+    if(indx->records[mid].timestamp < millisecs)
+      lo = mid;
+    else
+      hi = mid - 1;
     }
-  if(*position > indx->records[ret].offset)
-    *position = indx->records[ret].offset;
-  if(*start_packet > indx->records[ret].packet_count_for_this_packet)
-    *start_packet = indx->records[ret].packet_count_for_this_packet;
-  if(*end_packet < indx->records[ret].packet_count_for_this_packet)
-    *end_packet = indx->records[ret].packet_count_for_this_packet;
-    
   
-  return ret;
+  if(*position > indx->records[lo].offset)
+    *position = indx->records[lo].offset;
+  if(*start_packet > indx->records[lo].packet_count_for_this_packet)
+    *start_packet = indx->records[lo].packet_count_for_this_packet;
+  if(*end_packet < indx->records[lo].packet_count_for_this_packet)
+    *end_packet = indx->records[lo].packet_count_for_this_packet;
+  
+  return lo;
   }
 
 static void cleanup_stream_rm(bgav_stream_t * s)
@@ -1446,6 +1454,8 @@ static gavl_source_status_t next_packet_rmff(bgav_demuxer_context_t * ctx)
     if(!stream) /* Skip unknown stuff */
       {
       bgav_input_skip(ctx->input, PAYLOAD_LENGTH(&h));
+      /* Packet numbers in the index count all packets */
+      rm->next_packet++;
       return GAVL_SOURCE_OK;
       }
     }
@@ -1600,10 +1610,18 @@ static void seek_rmff(bgav_demuxer_context_t * ctx, int64_t time, int scale)
   /* Seek the pointers for the index records for each stream */
   /* We also calculate the file position where we will start again */
   
+  /* Only the selected streams are considered. For multirate (SureStream)
+     files, this means that we use only the index of the selected
+     rendition */
+  
   for(i = 0; i < track->num_video_streams; i++)
     {
     stream = bgav_track_get_video_stream(track, i);
     vs = stream->priv;
+
+    if((stream->action == BGAV_STREAM_MUTE) || !vs->com.stream->indx.num_indices)
+      continue;
+    
     vs->com.index_record = seek_indx(&vs->com.stream->indx, real_time,
                                  &position, &start_packet, &end_packet);
     STREAM_SET_SYNC(stream, vs->com.stream->indx.records[vs->com.index_record].timestamp);
@@ -1615,6 +1633,10 @@ static void seek_rmff(bgav_demuxer_context_t * ctx, int64_t time, int scale)
     {
     stream = bgav_track_get_audio_stream(track, i);
     rs = stream->priv;
+
+    if((stream->action == BGAV_STREAM_MUTE) || !rs->stream->indx.num_indices)
+      continue;
+    
     rs->index_record = seek_indx(&rs->stream->indx, real_time,
                                  &position, &start_packet, &end_packet);
     STREAM_SET_SYNC(stream, rs->stream->indx.records[rs->index_record].timestamp);
@@ -1623,7 +1645,7 @@ static void seek_rmff(bgav_demuxer_context_t * ctx, int64_t time, int scale)
   
   /* Seek to the position */
 
-  if(!rm->is_multirate)
+  if(!rm->is_multirate && (position != ~0x0))
     {
     bgav_input_seek(ctx->input, position, SEEK_SET);
 
@@ -1632,7 +1654,10 @@ static void seek_rmff(bgav_demuxer_context_t * ctx, int64_t time, int scale)
     rm->do_seek = 1;
     rm->next_packet = start_packet;
     while(rm->next_packet < end_packet)
-      next_packet_rmff(ctx);
+      {
+      if(next_packet_rmff(ctx) != GAVL_SOURCE_OK)
+        break;
+      }
     rm->do_seek = 0;
     }
   }
@@ -32,6 +32,23 @@
 
 #define STREAM_ID 1
 
+/*
+ *  The whole file is parsed once when opening. The cues are kept in a
+ *  table sorted by start time, the UTF-8 texts are stored
+ *  zero terminated in a single buffer.
+ */
+
+typedef struct
+  {
+  int64_t pts;
+  int64_t duration;
+  uint32_t text_offset;
+  uint32_t text_len;
+
+  /* Latest end time of this and all earlier cues */
+  int64_t max_end;
+  } srt_cue_t;
+
 typedef struct
   {
   int64_t time_offset;
@@ -42,6 +59,17 @@ typedef struct
 
   gavl_buffer_t line_buf;
 
+  srt_cue_t * cues;
+  int num_cues;
+  int cues_alloc;
+
+  gavl_buffer_t text;
+
+  /* Next cue to output */
+  int cur;
+
+  /* Cues ending before this are skipped after a seek */
+  int64_t seek_time;
   } srt_t;
 
 static int probe_srt(bgav_input_context_t * input)
@@ -70,37 +98,70 @@ static int probe_srt(bgav_input_context_t * input)
     return 0;
   }
 
-static gavl_source_status_t next_packet_srt(bgav_demuxer_context_t * ctx)
+/* Add a cue, keeping the table sorted by start time */
+
+static srt_cue_t * add_cue(srt_t * srt, int64_t pts)
   {
-  bgav_stream_t * s;
+  int idx;
+  
+  if(srt->num_cues >= srt->cues_alloc)
+    {
+    srt->cues_alloc += 256;
+    srt->cues = realloc(srt->cues, srt->cues_alloc * sizeof(*srt->cues));
+    }
+
+  /* Cues are almost always in order */
+  idx = srt->num_cues;
+  while(idx && (srt->cues[idx-1].pts > pts))
+    idx--;
+
+  if(idx < srt->num_cues)
+    memmove(srt->cues + idx + 1, srt->cues + idx,
+            (srt->num_cues - idx) * sizeof(*srt->cues));
+  
+  srt->num_cues++;
+  memset(srt->cues + idx, 0, sizeof(*srt->cues));
+  srt->cues[idx].pts = pts;
+  return srt->cues + idx;
+  }
+
+/* Must be called after all cues are read since add_cue() can insert */
+
+static void set_max_end(srt_t * srt)
+  {
+  int i;
+  int64_t end;
+  int64_t max_end = 0;
   
+  for(i = 0; i < srt->num_cues; i++)
+    {
+    end = srt->cues[i].pts + srt->cues[i].duration;
+    if(!i || (end > max_end))
+      max_end = end;
+    srt->cues[i].max_end = max_end;
+    }
+  }
+
+/* Parse one cue, return 0 on EOF */
+
+static int read_cue(bgav_demuxer_context_t * ctx)
+  {
   int lines_read;
   int a1,a2,a3,a4,b1,b2,b3,b4;
   int i,len;
   srt_t * srt;
   gavl_time_t start, end;
   char * str;
-
-  bgav_packet_t * p;
+  srt_cue_t * cue;
+  uint32_t text_offset;
   
   srt = ctx->priv;
-
-  s = bgav_track_find_stream(ctx, STREAM_ID);
-
-  /* Detect post seek */
-  if(ctx->input->position == ctx->tt->cur->data_start)
-    {
-    //    fprintf(stderr, "SRT: Resetting time\n");
-    srt->time_offset = 0;
-    srt->scale_num = 1;
-    srt->scale_den = 1;
-    }
   
   /* Read lines */
   while(1)
     {
     if(!bgav_input_read_convert_line(ctx->input, &srt->line_buf))
-      return GAVL_SOURCE_EOF;
+      return 0;
     str = (char*)srt->line_buf.buf;
     // fprintf(stderr, "Line: %s (%c)\n", srt->line, srt->line[0]);
     
@@ -133,8 +194,6 @@ static gavl_source_status_t next_packet_srt(bgav_demuxer_context_t * ctx)
       }
     }
 
-  //  p = 
-  
   start  = a1;
   start *= 60;
   start += a2;
@@ -151,23 +210,10 @@ static gavl_source_status_t next_packet_srt(bgav_demuxer_context_t * ctx)
   end *= 1000;
   end += b4;
 
-  p = bgav_stream_get_packet_write(s);
-  
-  p->pts = start + srt->time_offset;
-  p->duration = end - start;
-
-  p->pts = gavl_time_rescale(srt->scale_den,
-                             srt->scale_num,
-                             p->pts);
-
-  p->duration = gavl_time_rescale(srt->scale_den,
-                                  srt->scale_num,
-                                  p->duration);
-  
-  p->buf.len = 0;
-  
   /* Read lines until we are done */
 
+  text_offset = srt->text.len;
+  
   lines_read = 0;
   while(1)
     {
@@ -175,33 +221,101 @@ static gavl_source_status_t next_packet_srt(bgav_demuxer_context_t * ctx)
       {
       srt->line_buf.len = 0;
       if(!lines_read)
-        return GAVL_SOURCE_EOF;
+        return 0;
       }
     
     if(!srt->line_buf.len)
-      {
-      /* Zero terminate */
-      if(lines_read)
-        {
-        p->buf.buf[p->buf.len] = '\0';
-        // Terminator doesn't count for data size
-        // p->data_size++;
-        }
-      bgav_stream_done_packet_write(s, p);
-      return GAVL_SOURCE_OK;
-      }
+      break;
+    
     if(lines_read)
-      {
-      p->buf.buf[p->buf.len] = '\n';
-      p->buf.len++;
-      }
+      gavl_buffer_append_data(&srt->text, (const uint8_t*)"\n", 1);
     
     lines_read++;
-    bgav_packet_alloc(p, p->buf.len + srt->line_buf.len + 2);
-    gavl_buffer_append(&p->buf, &srt->line_buf);
+    gavl_buffer_append(&srt->text, &srt->line_buf);
     }
-  /* Never get here */
-  return GAVL_SOURCE_EOF;
+
+  cue = add_cue(srt, gavl_time_rescale(srt->scale_den,
+                                       srt->scale_num,
+                                       start + srt->time_offset));
+  
+  cue->duration = gavl_time_rescale(srt->scale_den,
+                                    srt->scale_num,
+                                    end - start);
+  
+  cue->text_offset = text_offset;
+  cue->text_len = srt->text.len - text_offset;
+
+  /* Zero terminate (the terminator doesn't count for the length) */
+  gavl_buffer_append_data(&srt->text, (const uint8_t*)"", 1);
+  return 1;
+  }
+
+static gavl_source_status_t next_packet_srt(bgav_demuxer_context_t * ctx)
+  {
+  bgav_stream_t * s;
+  srt_t * srt;
+  srt_cue_t * cue;
+  bgav_packet_t * p;
+  
+  srt = ctx->priv;
+
+  while((srt->cur < srt->num_cues) &&
+        (srt->cues[srt->cur].pts + srt->cues[srt->cur].duration <=
+         srt->seek_time))
+    srt->cur++;
+  
+  if(srt->cur >= srt->num_cues)
+    return GAVL_SOURCE_EOF;
+  
+  cue = srt->cues + srt->cur;
+  srt->cur++;
+  
+  if(!(s = bgav_track_find_stream(ctx, STREAM_ID)))
+    return GAVL_SOURCE_OK;
+  
+  p = bgav_stream_get_packet_write(s);
+  
+  p->pts = cue->pts;
+  p->duration = cue->duration;
+
+  bgav_packet_alloc(p, cue->text_len + 1);
+  memcpy(p->buf.buf, srt->text.buf + cue->text_offset, cue->text_len + 1);
+  p->buf.len = cue->text_len;
+  
+  bgav_stream_done_packet_write(s, p);
+  return GAVL_SOURCE_OK;
+  }
+
+static void seek_srt(bgav_demuxer_context_t * ctx, int64_t time, int scale)
+  {
+  int lo, hi, mid;
+  int64_t t;
+  srt_t * srt = ctx->priv;
+
+  t = gavl_time_rescale(scale, 1000, time);
+  
+  /* First cue starting at or after the seek time */
+  lo = 0;
+  hi = srt->num_cues;
+
+  while(lo < hi)
+    {
+    mid = (lo + hi) / 2;
+    if(srt->cues[mid].pts < t)
+      lo = mid + 1;
+    else
+      hi = mid;
+    }
+
+  /* Include cues, which are still displayed. A long cue can overlap
+     several later ones, so walk back over the running maximum of the
+     end times. Cues in between, which are already over, are skipped in
+     next_packet_srt() */
+  while(lo && (srt->cues[lo-1].max_end > t))
+    lo--;
+  
+  srt->cur = lo;
+  srt->seek_time = t;
   }
 
 static int open_srt(bgav_demuxer_context_t * ctx)
@@ -221,9 +335,17 @@ static int open_srt(bgav_demuxer_context_t * ctx)
   s->timescale = 1000;
   srt->scale_num = 1;
   srt->scale_den = 1;
+  srt->seek_time = GAVL_TIME_UNDEFINED;
+
+  while(read_cue(ctx))
+    ;
 
-  if(ctx->input->flags & BGAV_INPUT_CAN_SEEK_BYTE)
-    ctx->flags |= BGAV_DEMUXER_CAN_SEEK;
+  set_max_end(srt);
+
+  gavl_log(GAVL_LOG_DEBUG, LOG_DOMAIN, "Read %d cues", srt->num_cues);
+  
+  /* Seeking doesn't touch the input */
+  ctx->flags |= BGAV_DEMUXER_CAN_SEEK;
   
   return 1;
   }
@@ -233,6 +355,9 @@ static void close_srt(bgav_demuxer_context_t * ctx)
   srt_t * srt = ctx->priv;
 
   gavl_buffer_free(&srt->line_buf);
+  gavl_buffer_free(&srt->text);
+  if(srt->cues)
+    free(srt->cues);
   free(srt);
   }
   
@@ -240,7 +365,7 @@ const bgav_demuxer_t bgav_demuxer_srt =
   {
     .probe =       probe_srt,
     .open =        open_srt,
-    .seek =        bgav_subtitle_seek,
+    .seek =        seek_srt,
     .next_packet = next_packet_srt,
     .close =       close_srt
   };
@@ -40,6 +40,9 @@ typedef struct
 
   
   int buf_size;
+
+  /* Frame data plus FRAME header line. 0 if frames have variable sizes */
+  int frame_size;
   } y4m_t;
 
 static int probe_y4m(bgav_input_context_t * input)
@@ -91,6 +94,7 @@ static int open_y4m(bgav_demuxer_context_t * ctx)
   const char * pos;
   const char * end;
   const char * format = NULL;
+  char header[6];
   
   /* Allocate private data */
   
@@ -224,8 +228,31 @@ static int open_y4m(bgav_demuxer_context_t * ctx)
   s->fourcc = BGAV_MK_FOURCC('y','4','m',' ');
 
   bgav_track_set_format(ctx->tt->cur, "yuv4mpeg", NULL);
+
+  ctx->tt->cur->data_start = ctx->input->position;
+  
+  /*
+   *  If the first frame header has no parameters and the framerate is constant,
+   *  we assume all frames to have the same size. This lets us seek directly.
+   */
+  
+  if((ctx->input->flags & BGAV_INPUT_CAN_SEEK_BYTE) &&
+     (s->data.video.format->framerate_mode != GAVL_FRAMERATE_VARIABLE) &&
+     (bgav_input_get_data(ctx->input, (uint8_t*)header, 6) == 6) &&
+     !strncmp(header, "FRAME\n", 6))
+    {
+    priv->frame_size = priv->buf_size + 6;
+
+    if(ctx->input->total_bytes > 0)
+      s->stats.pts_end = (ctx->input->total_bytes - ctx->tt->cur->data_start) /
+        priv->frame_size * s->data.video.format->frame_duration;
+    
+    ctx->flags |= BGAV_DEMUXER_CAN_SEEK;
+    ctx->index_mode = INDEX_MODE_CONST;
+    }
+  else
+    ctx->index_mode = INDEX_MODE_SIMPLE;
   
-  ctx->index_mode = INDEX_MODE_SIMPLE;
   return 1;
   }
 
@@ -309,6 +336,30 @@ static gavl_source_status_t next_packet_y4m(bgav_demuxer_context_t * ctx)
   return GAVL_SOURCE_OK;
   }
 
+static void seek_y4m(bgav_demuxer_context_t * ctx, int64_t time, int scale)
+  {
+  char header[5];
+  int64_t t;
+  y4m_t * priv = ctx->priv;
+  bgav_stream_t * s = bgav_track_get_video_stream(ctx->tt->cur, 0);
+  
+  t = bgav_demuxer_seek_const(ctx, time, scale,
+                              s->data.video.format->timescale,
+                              s->data.video.format->frame_duration,
+                              priv->frame_size);
+
+  /* Frame headers with parameters break the arithmetic */
+  if((bgav_input_get_data(ctx->input, (uint8_t*)header, 5) < 5) ||
+     strncmp(header, "FRAME", 5))
+    {
+    gavl_log(GAVL_LOG_WARNING, LOG_DOMAIN, "No frame header at %"PRId64", seeking to start",
+             ctx->input->position);
+    bgav_input_seek(ctx->input, ctx->tt->cur->data_start, SEEK_SET);
+    t = 0;
+    }
+  
+  STREAM_SET_SYNC(s, t);
+  }
 
 static void close_y4m(bgav_demuxer_context_t * ctx)
   {
@@ -325,5 +376,6 @@ const bgav_demuxer_t bgav_demuxer_y4m =
     .probe        = probe_y4m,
     .open         = open_y4m,
     .next_packet = next_packet_y4m,
+    .seek =        seek_y4m,
     .close =       close_y4m
   };
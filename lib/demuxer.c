@@ -335,6 +335,7 @@ void bgav_demuxer_destroy(bgav_demuxer_context_t * ctx)
 
   if(ctx->si)
     bgav_superindex_destroy(ctx->si);
+  bgav_si_cursor_free(&ctx->si_cursor);
   free(ctx);
   }
 
@@ -392,25 +393,108 @@ void bgav_demuxer_check_interleave(bgav_demuxer_context_t * ctx)
     }
   }
 
-static int read_packet_superindex(bgav_demuxer_context_t * ctx, bgav_stream_t * s,
-                                  gavl_packet_t * p, int pos)
+/*
+ *  Small packets (e.g. PCM chunks or subtitle samples) are not read one
+ *  by one. Instead we read a run of contiguous or nearly contiguous index
+ *  entries with a single call into the cursor buffer and copy the packets
+ *  out of it. Larger packets are read directly into the packet buffer.
+ */
+
+#define SI_COALESCE_BYTES (256*1024)
+#define SI_COALESCE_GAP   4096
+
+void bgav_si_cursor_free(bgav_si_cursor_t * c)
+  {
+  if(c->own_input && c->input)
+    {
+    if(c->parent)
+      bgav_input_counters_add(&c->parent->counters, &c->input->counters);
+    bgav_input_destroy(c->input);
+    }
+  gavl_buffer_free(&c->buf);
+  memset(c, 0, sizeof(*c));
+  }
+
+static int si_seek(bgav_input_context_t * input, int64_t offset)
   {
-  if(ctx->si->entries[pos].offset > ctx->input->position)
-    bgav_input_skip(ctx->input, ctx->si->entries[pos].offset - ctx->input->position);
-  else if(ctx->si->entries[pos].offset < ctx->input->position)
+  if(offset > input->position)
+    bgav_input_skip(input, offset - input->position);
+  else if(offset < input->position)
     {
-    if(!(ctx->input->flags & BGAV_INPUT_CAN_SEEK_BYTE))
+    if(!(input->flags & BGAV_INPUT_CAN_SEEK_BYTE))
       {
       gavl_log(GAVL_LOG_ERROR, LOG_DOMAIN, "Couldn't seek backwards");
       return 0;
       }
-    bgav_input_seek(ctx->input, ctx->si->entries[pos].offset, SEEK_SET);
+    bgav_input_seek(input, offset, SEEK_SET);
+    }
+  return 1;
+  }
+
+/* Return the end offset of the run starting at pos or -1 if the entry should be read directly */
+
+static int64_t si_get_run(bgav_superindex_t * si, int pos)
+  {
+  int i;
+  int64_t start, end;
+  
+  if(si->entries[pos].size > SI_COALESCE_BYTES / 4)
+    return -1;
+
+  start = si->entries[pos].offset;
+  end = start + si->entries[pos].size;
+  
+  for(i = pos + 1; i < si->num_entries; i++)
+    {
+    if((si->entries[i].offset < end) ||
+       (si->entries[i].offset - end > SI_COALESCE_GAP) ||
+       (si->entries[i].offset + si->entries[i].size - start > SI_COALESCE_BYTES))
+      break;
+    end = si->entries[i].offset + si->entries[i].size;
     }
+
+  if(i == pos + 1)
+    return -1;
+  return end;
+  }
+
+static int read_packet_superindex(bgav_demuxer_context_t * ctx, bgav_stream_t * s,
+                                  bgav_si_cursor_t * c, gavl_packet_t * p, int pos)
+  {
+  int64_t offset = ctx->si->entries[pos].offset;
+  int64_t end;
+  int result;
   
   p->buf.len = ctx->si->entries[pos].size;
   bgav_packet_alloc(p, p->buf.len);
-  if(bgav_input_read_data(ctx->input, p->buf.buf, p->buf.len) < p->buf.len)
-    return 0;
+
+  /* Try buffered data */
+  if(!c->buf.len || (offset < c->buf_offset) ||
+     (offset + p->buf.len > c->buf_offset + c->buf.len))
+    {
+    if((end = si_get_run(ctx->si, pos)) < 0)
+      {
+      if(!si_seek(c->input, offset) ||
+         (bgav_input_read_data(c->input, p->buf.buf, p->buf.len) < p->buf.len))
+        return 0;
+      goto done;
+      }
+    
+    if(!si_seek(c->input, offset))
+      return 0;
+    
+    gavl_buffer_alloc(&c->buf, end - offset);
+    result = bgav_input_read_data(c->input, c->buf.buf, end - offset);
+    c->buf.len = (result > 0) ? result : 0;
+    c->buf_offset = offset;
+
+    if(c->buf.len < p->buf.len)
+      return 0;
+    }
+  
+  memcpy(p->buf.buf, c->buf.buf + (offset - c->buf_offset), p->buf.len);
+  
+  done:
   
   if(s->flags & STREAM_DTS_ONLY)
     p->dts = ctx->si->entries[pos].pts;
@@ -433,6 +517,7 @@ gavl_source_status_t bgav_demuxer_next_packet_si(bgav_demuxer_context_t * ctx)
   int idx;
   bgav_stream_t * s = NULL;
   gavl_packet_t * p;
+  bgav_si_cursor_t * c;
   
   if(ctx->flags & BGAV_DEMUXER_NONINTERLEAVED)
     {
@@ -458,7 +543,26 @@ gavl_source_status_t bgav_demuxer_next_packet_si(bgav_demuxer_context_t * ctx)
 
     idx = s->index_position;
     s->index_position++;
+
+    /*
+     *  Each stream reads from its own region of the file. Give it an own
+     *  cursor (and input if possible) so we don't seek back and forth
+     *  for every packet.
+     */
     
+    if(!s->si_cursor)
+      {
+      s->si_cursor = calloc(1, sizeof(*s->si_cursor));
+      
+      if((s->si_cursor->input = bgav_input_clone(ctx->input)))
+        {
+        s->si_cursor->own_input = 1;
+        s->si_cursor->parent = ctx->input;
+        }
+      else
+        s->si_cursor->input = ctx->input;
+      }
+    c = s->si_cursor;
     }
   else // Interleaved
     {
@@ -478,6 +582,8 @@ gavl_source_status_t bgav_demuxer_next_packet_si(bgav_demuxer_context_t * ctx)
       return GAVL_SOURCE_EOF;
     idx = ctx->si->current_position;
     ctx->si->current_position++;
+    c = &ctx->si_cursor;
+    c->input = ctx->input;
     }
     
   /* Shouldn't be neccesary */
@@ -486,7 +592,7 @@ gavl_source_status_t bgav_demuxer_next_packet_si(bgav_demuxer_context_t * ctx)
   
   p = bgav_stream_get_packet_write(s);
 
-  if(!read_packet_superindex(ctx, s, p, idx))
+  if(!read_packet_superindex(ctx, s, c, p, idx))
     return GAVL_SOURCE_EOF;
   
   bgav_stream_done_packet_write(s, p);
@@ -664,6 +770,7 @@ gavl_source_status_t bgav_demuxer_next_packet(bgav_demuxer_context_t * demuxer)
   {
   gavl_source_status_t ret = GAVL_SOURCE_EOF;
   int i;
+  gavl_time_t t;
   
   /* Send state */
   if((demuxer->b->flags & (BGAV_FLAG_STATE_SENT|BGAV_FLAG_IS_RUNNING)) ==
@@ -696,7 +803,10 @@ gavl_source_status_t bgav_demuxer_next_packet(bgav_demuxer_context_t * demuxer)
       break;
     case DEMUX_MODE_STREAM:
 #endif
+      t = bgav_stats_time();
       ret = demuxer->demuxer->next_packet(demuxer);
+      demuxer->next_packet_time += bgav_stats_time() - t;
+      demuxer->next_packet_calls++;
       
       if(ret == GAVL_SOURCE_EOF)
         {
@@ -908,6 +1018,32 @@ void bgav_demuxer_set_clock_time(bgav_demuxer_context_t * ctx,
   
   }
 
+int64_t bgav_demuxer_seek_const(bgav_demuxer_context_t * ctx,
+                                int64_t time, int scale,
+                                int timescale, int64_t packet_duration,
+                                int64_t packet_size)
+  {
+  int64_t packet;
+  int64_t num_packets;
+  bgav_track_t * t = ctx->tt->cur;
+  
+  packet = gavl_time_rescale(scale, timescale, time) / packet_duration;
+
+  if(packet < 0)
+    packet = 0;
+  
+  /* Clamp to the last complete packet */
+  if(t->data_end > t->data_start)
+    {
+    num_packets = (t->data_end - t->data_start) / packet_size;
+    if(packet >= num_packets)
+      packet = num_packets > 0 ? num_packets - 1 : 0;
+    }
+  
+  bgav_input_seek(ctx->input, t->data_start + packet * packet_size, SEEK_SET);
+  return packet * packet_duration;
+  }
+
 #if 0
 void bgav_demuxer_parse_track(bgav_demuxer_context_t * ctx)
   {
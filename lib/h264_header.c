@@ -177,96 +177,96 @@ int bgav_h264_decode_nal_rbsp(const uint8_t * in_buffer, int len,
 static void get_hrd_parameters(bgav_bitstream_t * b,
                                bgav_h264_vui_t * vui)
   {
-  int dummy, i;
+  int i;
   int cpb_cnt_minus1;
   
-  bgav_bitstream_get_golomb_ue(b, &cpb_cnt_minus1);
+  cpb_cnt_minus1 = bgav_bitstream_get_golomb_ue_unchecked(b);
 
-  bgav_bitstream_get(b, &dummy, 4); // bit_rate_scale
-  bgav_bitstream_get(b, &dummy, 4); // cpb_size_scale
+  bgav_bitstream_skip(b, 4); // bit_rate_scale
+  bgav_bitstream_skip(b, 4); // cpb_size_scale
   
   for(i = 0; i <= cpb_cnt_minus1; i++ )
     {
-    bgav_bitstream_get_golomb_ue(b, &dummy); // bit_rate_value_minus1[ SchedSelIdx ]
-    bgav_bitstream_get_golomb_ue(b, &dummy); // cpb_size_value_minus1[ SchedSelIdx ]
-    bgav_bitstream_get(b, &dummy, 1); // cbr_flag[ SchedSelIdx ]
+    bgav_bitstream_get_golomb_ue_unchecked(b); // bit_rate_value_minus1[ SchedSelIdx ]
+    bgav_bitstream_get_golomb_ue_unchecked(b); // cpb_size_value_minus1[ SchedSelIdx ]
+    bgav_bitstream_skip(b, 1); // cbr_flag[ SchedSelIdx ]
     }
-  bgav_bitstream_get(b, &dummy, 5); // initial_cpb_removal_delay_length_minus1
-  bgav_bitstream_get(b, &vui->cpb_removal_delay_length_minus1, 5); 
-  bgav_bitstream_get(b, &vui->dpb_output_delay_length_minus1, 5); 
-  bgav_bitstream_get(b, &dummy, 5); // time_offset_length
+  bgav_bitstream_skip(b, 5); // initial_cpb_removal_delay_length_minus1
+  vui->cpb_removal_delay_length_minus1 = bgav_bitstream_get_unchecked(b, 5); 
+  vui->dpb_output_delay_length_minus1 = bgav_bitstream_get_unchecked(b, 5); 
+  bgav_bitstream_skip(b, 5); // time_offset_length
   }
 
 static void vui_parse(bgav_bitstream_t * b, bgav_h264_vui_t * vui)
   {
-  bgav_bitstream_get(b, &vui->aspect_ratio_info_present_flag, 1);
+  vui->aspect_ratio_info_present_flag = bgav_bitstream_get_unchecked(b, 1);
   if(vui->aspect_ratio_info_present_flag)
     {
-    bgav_bitstream_get(b, &vui->aspect_ratio_idc, 8);
+    vui->aspect_ratio_idc = bgav_bitstream_get_unchecked(b, 8);
     if(vui->aspect_ratio_idc == 255) // Extended_SAR
       {
-      bgav_bitstream_get(b, &vui->sar_width, 16);
-      bgav_bitstream_get(b, &vui->sar_height, 16);
+      vui->sar_width = bgav_bitstream_get_unchecked(b, 16);
+      vui->sar_height = bgav_bitstream_get_unchecked(b, 16);
       }
     }
 
-  bgav_bitstream_get(b, &vui->overscan_info_present_flag, 1);
+  vui->overscan_info_present_flag = bgav_bitstream_get_unchecked(b, 1);
   if(vui->overscan_info_present_flag)
-    bgav_bitstream_get(b, &vui->overscan_appropriate_flag, 1);
+    vui->overscan_appropriate_flag = bgav_bitstream_get_unchecked(b, 1);
 
-  bgav_bitstream_get(b, &vui->video_signal_type_present_flag, 1);
+  vui->video_signal_type_present_flag = bgav_bitstream_get_unchecked(b, 1);
   if(vui->video_signal_type_present_flag)
     {
-    bgav_bitstream_get(b, &vui->video_format, 3);
-    bgav_bitstream_get(b, &vui->video_full_range_flag, 1);
-    bgav_bitstream_get(b, &vui->colour_description_present_flag, 1);
+    vui->video_format = bgav_bitstream_get_unchecked(b, 3);
+    vui->video_full_range_flag = bgav_bitstream_get_unchecked(b, 1);
+    vui->colour_description_present_flag = bgav_bitstream_get_unchecked(b, 1);
     if(vui->colour_description_present_flag)
       {
-      bgav_bitstream_get(b, &vui->colour_primaries, 8);
-      bgav_bitstream_get(b, &vui->transfer_characteristics, 8);
-      bgav_bitstream_get(b, &vui->matrix_coefficients, 8);
+      vui->colour_primaries = bgav_bitstream_get_unchecked(b, 8);
+      vui->transfer_characteristics = bgav_bitstream_get_unchecked(b, 8);
+      vui->matrix_coefficients = bgav_bitstream_get_unchecked(b, 8);
       }
     }
 
-  bgav_bitstream_get(b, &vui->chroma_loc_info_present_flag, 1);
+  vui->chroma_loc_info_present_flag = bgav_bitstream_get_unchecked(b, 1);
   if(vui->chroma_loc_info_present_flag)
     {
-    bgav_bitstream_get_golomb_ue(b, &vui->chroma_sample_loc_type_top_field);
-    bgav_bitstream_get_golomb_ue(b, &vui->chroma_sample_loc_type_bottom_field);
+    vui->chroma_sample_loc_type_top_field = bgav_bitstream_get_golomb_ue_unchecked(b);
+    vui->chroma_sample_loc_type_bottom_field = bgav_bitstream_get_golomb_ue_unchecked(b);
     }
 
-  bgav_bitstream_get(b, &vui->timing_info_present_flag, 1);
+  vui->timing_info_present_flag = bgav_bitstream_get_unchecked(b, 1);
   if(vui->timing_info_present_flag)
     {
-    bgav_bitstream_get(b, &vui->num_units_in_tick, 32);
-    bgav_bitstream_get(b, &vui->time_scale, 32);
-    bgav_bitstream_get(b, &vui->fixed_frame_rate_flag, 1);
+    vui->num_units_in_tick = bgav_bitstream_get_unchecked(b, 32);
+    vui->time_scale = bgav_bitstream_get_unchecked(b, 32);
+    vui->fixed_frame_rate_flag = bgav_bitstream_get_unchecked(b, 1);
     }
 
-  bgav_bitstream_get(b, &vui->nal_hrd_parameters_present_flag, 1);
+  vui->nal_hrd_parameters_present_flag = bgav_bitstream_get_unchecked(b, 1);
   if(vui->nal_hrd_parameters_present_flag)
     get_hrd_parameters(b, vui);
 
-  bgav_bitstream_get(b, &vui->vcl_hrd_parameters_present_flag, 1);
+  vui->vcl_hrd_parameters_present_flag = bgav_bitstream_get_unchecked(b, 1);
   if(vui->vcl_hrd_parameters_present_flag)
     get_hrd_parameters(b, vui);
 
   if(vui->nal_hrd_parameters_present_flag || vui->vcl_hrd_parameters_present_flag)
-    bgav_bitstream_get(b, &vui->low_delay_hrd_flag, 1);
+    vui->low_delay_hrd_flag = bgav_bitstream_get_unchecked(b, 1);
 
-  bgav_bitstream_get(b, &vui->pic_struct_present_flag, 1);
-  bgav_bitstream_get(b, &vui->bitstream_restriction_flag, 1);
+  vui->pic_struct_present_flag = bgav_bitstream_get_unchecked(b, 1);
+  vui->bitstream_restriction_flag = bgav_bitstream_get_unchecked(b, 1);
   
   if(&vui->bitstream_restriction_flag )
     {
-    bgav_bitstream_get(b, &vui->motion_vectors_over_pic_boundaries_flag, 1);
-
-    bgav_bitstream_get_golomb_ue(b, &vui->max_bytes_per_pic_denom);
-    bgav_bitstream_get_golomb_ue(b, &vui->max_bits_per_mb_denom);
-    bgav_bitstream_get_golomb_ue(b, &vui->log2_max_mv_length_horizontal);
-    bgav_bitstream_get_golomb_ue(b, &vui->log2_max_mv_length_vertical);
-    bgav_bitstream_get_golomb_ue(b, &vui->num_reorder_frames);
-    bgav_bitstream_get_golomb_ue(b, &vui->max_dec_frame_buffering);
+    vui->motion_vectors_over_pic_boundaries_flag = bgav_bitstream_get_unchecked(b, 1);
+
+    vui->max_bytes_per_pic_denom = bgav_bitstream_get_golomb_ue_unchecked(b);
+    vui->max_bits_per_mb_denom = bgav_bitstream_get_golomb_ue_unchecked(b);
+    vui->log2_max_mv_length_horizontal = bgav_bitstream_get_golomb_ue_unchecked(b);
+    vui->log2_max_mv_length_vertical = bgav_bitstream_get_golomb_ue_unchecked(b);
+    vui->num_reorder_frames = bgav_bitstream_get_golomb_ue_unchecked(b);
+    vui->max_dec_frame_buffering = bgav_bitstream_get_golomb_ue_unchecked(b);
     }
   
   }
@@ -417,16 +417,16 @@ int bgav_h264_sps_parse(bgav_h264_sps_t * sps,
 
   bgav_bitstream_init(&b, buffer, len);
 
-  bgav_bitstream_get(&b, &sps->profile_idc, 8);
-  bgav_bitstream_get(&b, &sps->constraint_set0_flag, 1);
-  bgav_bitstream_get(&b, &sps->constraint_set1_flag, 1);
-  bgav_bitstream_get(&b, &sps->constraint_set2_flag, 1);
-  bgav_bitstream_get(&b, &sps->constraint_set3_flag, 1);
+  sps->profile_idc = bgav_bitstream_get_unchecked(&b, 8);
+  sps->constraint_set0_flag = bgav_bitstream_get_unchecked(&b, 1);
+  sps->constraint_set1_flag = bgav_bitstream_get_unchecked(&b, 1);
+  sps->constraint_set2_flag = bgav_bitstream_get_unchecked(&b, 1);
+  sps->constraint_set3_flag = bgav_bitstream_get_unchecked(&b, 1);
   
-  bgav_bitstream_get(&b, &dummy, 4); /* reserved_zero_4bits */
-  bgav_bitstream_get(&b, &sps->level_idc, 8); /* level_idc */
+  bgav_bitstream_skip(&b, 4); /* reserved_zero_4bits */
+  sps->level_idc = bgav_bitstream_get_unchecked(&b, 8); /* level_idc */
 
-  bgav_bitstream_get_golomb_ue(&b, &sps->seq_parameter_set_id);
+  sps->seq_parameter_set_id = bgav_bitstream_get_golomb_ue_unchecked(&b);
 
   /* ffmpeg has just (sps->profile_idc >= 100) */
   if(sps->profile_idc == 100 ||
@@ -437,14 +437,14 @@ int bgav_h264_sps_parse(bgav_h264_sps_t * sps,
      sps->profile_idc == 83 ||
      sps->profile_idc == 86 ) 
     {
-    bgav_bitstream_get_golomb_ue(&b, &sps->chroma_format_idc);
+    sps->chroma_format_idc = bgav_bitstream_get_golomb_ue_unchecked(&b);
     if(sps->chroma_format_idc == 3)
-      bgav_bitstream_get(&b, &sps->separate_colour_plane_flag, 1);
-    bgav_bitstream_get_golomb_ue(&b, &sps->bit_depth_luma_minus8);
-    bgav_bitstream_get_golomb_ue(&b, &sps->bit_depth_chroma_minus8);
+      sps->separate_colour_plane_flag = bgav_bitstream_get_unchecked(&b, 1);
+    sps->bit_depth_luma_minus8 = bgav_bitstream_get_golomb_ue_unchecked(&b);
+    sps->bit_depth_chroma_minus8 = bgav_bitstream_get_golomb_ue_unchecked(&b);
 
-    bgav_bitstream_get(&b, &sps->qpprime_y_zero_transform_bypass_flag, 1);
-    bgav_bitstream_get(&b, &sps->seq_scaling_matrix_present_flag, 1);
+    sps->qpprime_y_zero_transform_bypass_flag = bgav_bitstream_get_unchecked(&b, 1);
+    sps->seq_scaling_matrix_present_flag = bgav_bitstream_get_unchecked(&b, 1);
     
     if(sps->seq_scaling_matrix_present_flag)
       {
@@ -471,48 +471,67 @@ int bgav_h264_sps_parse(bgav_h264_sps_t * sps,
       }
     }
   
-  bgav_bitstream_get_golomb_ue(&b, &sps->log2_max_frame_num_minus4);
-  bgav_bitstream_get_golomb_ue(&b, &sps->pic_order_cnt_type);
+  sps->log2_max_frame_num_minus4 = bgav_bitstream_get_golomb_ue_unchecked(&b);
+
+  /* frame_num is read with the unchecked getter for each slice */
+  if((sps->log2_max_frame_num_minus4 < 0) ||
+     (sps->log2_max_frame_num_minus4 > 12))
+    {
+    gavl_log(GAVL_LOG_ERROR, LOG_DOMAIN, "Invalid log2_max_frame_num_minus4 %d in SPS",
+             sps->log2_max_frame_num_minus4);
+    return 0;
+    }
+  
+  sps->pic_order_cnt_type = bgav_bitstream_get_golomb_ue_unchecked(&b);
 
   if(!sps->pic_order_cnt_type)
-    bgav_bitstream_get_golomb_ue(&b, &sps->log2_max_pic_order_cnt_lsb_minus4);
+    {
+    sps->log2_max_pic_order_cnt_lsb_minus4 = bgav_bitstream_get_golomb_ue_unchecked(&b);
+    if((sps->log2_max_pic_order_cnt_lsb_minus4 < 0) ||
+       (sps->log2_max_pic_order_cnt_lsb_minus4 > 12))
+      {
+      gavl_log(GAVL_LOG_ERROR, LOG_DOMAIN, "Invalid log2_max_pic_order_cnt_lsb_minus4 %d in SPS",
+               sps->log2_max_pic_order_cnt_lsb_minus4);
+      return 0;
+      }
+    }
   else if(sps->pic_order_cnt_type == 1)
     {
-    bgav_bitstream_get(&b, &sps->delta_pic_order_always_zero_flag, 1);
+    sps->delta_pic_order_always_zero_flag = bgav_bitstream_get_unchecked(&b, 1);
 
-    bgav_bitstream_get_golomb_se(&b, &sps->offset_for_non_ref_pic);  
-    bgav_bitstream_get_golomb_se(&b, &sps->offset_for_top_to_bottom_field); 
-    bgav_bitstream_get_golomb_ue(&b, &sps->num_ref_frames_in_pic_order_cnt_cycle);
+    sps->offset_for_non_ref_pic = bgav_bitstream_get_golomb_se_unchecked(&b);  
+    sps->offset_for_top_to_bottom_field = bgav_bitstream_get_golomb_se_unchecked(&b); 
+    sps->num_ref_frames_in_pic_order_cnt_cycle = bgav_bitstream_get_golomb_ue_unchecked(&b);
 
     sps->offset_for_ref_frame =
       malloc(sizeof(*sps->offset_for_ref_frame) *
              sps->num_ref_frames_in_pic_order_cnt_cycle);
     for(i = 0; i < sps->num_ref_frames_in_pic_order_cnt_cycle; i++)
       {
-      bgav_bitstream_get_golomb_se(&b, &sps->offset_for_ref_frame[i]);
+      sps->offset_for_ref_frame[i] = bgav_bitstream_get_golomb_se_unchecked(&b);
       }
     }
-  bgav_bitstream_get_golomb_ue(&b, &sps->num_ref_frames);
-  bgav_bitstream_get(&b, &sps->gaps_in_frame_num_value_allowed_flag, 1);
+  sps->num_ref_frames = bgav_bitstream_get_golomb_ue_unchecked(&b);
+  sps->gaps_in_frame_num_value_allowed_flag = bgav_bitstream_get_unchecked(&b, 1);
 
-  bgav_bitstream_get_golomb_ue(&b, &sps->pic_width_in_mbs_minus1);
-  bgav_bitstream_get_golomb_ue(&b, &sps->pic_height_in_map_units_minus1);
+  sps->pic_width_in_mbs_minus1 = bgav_bitstream_get_golomb_ue_unchecked(&b);
+  sps->pic_height_in_map_units_minus1 = bgav_bitstream_get_golomb_ue_unchecked(&b);
 
-  bgav_bitstream_get(&b, &sps->frame_mbs_only_flag, 1);
+  sps->frame_mbs_only_flag = bgav_bitstream_get_unchecked(&b, 1);
 
   if(!sps->frame_mbs_only_flag)
-    bgav_bitstream_get(&b, &sps->mb_adaptive_frame_field_flag, 1);
+    sps->mb_adaptive_frame_field_flag = bgav_bitstream_get_unchecked(&b, 1);
 
-  bgav_bitstream_get(&b, &sps->direct_8x8_inference_flag, 1);
-  bgav_bitstream_get(&b, &sps->frame_cropping_flag, 1);
+  sps->direct_8x8_inference_flag = bgav_bitstream_get_unchecked(&b, 1);
+  sps->frame_cropping_flag = bgav_bitstream_get_unchecked(&b, 1);
   if(sps->frame_cropping_flag)
     {
-    bgav_bitstream_get_golomb_ue(&b, &sps->frame_crop_left_offset);
-    bgav_bitstream_get_golomb_ue(&b, &sps->frame_crop_right_offset);
-    bgav_bitstream_get_golomb_ue(&b, &sps->frame_crop_top_offset);
-    bgav_bitstream_get_golomb_ue(&b, &sps->frame_crop_bottom_offset);
+    sps->frame_crop_left_offset = bgav_bitstream_get_golomb_ue_unchecked(&b);
+    sps->frame_crop_right_offset = bgav_bitstream_get_golomb_ue_unchecked(&b);
+    sps->frame_crop_top_offset = bgav_bitstream_get_golomb_ue_unchecked(&b);
+    sps->frame_crop_bottom_offset = bgav_bitstream_get_golomb_ue_unchecked(&b);
     }
-  bgav_bitstream_get(&b, &sps->vui_parameters_present_flag, 1);
+  sps->vui_parameters_present_flag = bgav_bitstream_get_unchecked(&b, 1);
 
   if(sps->vui_parameters_present_flag)
     vui_parse(&b, &sps->vui);
@@ -780,20 +799,23 @@ void bgav_h264_slice_header_parse(const uint8_t * data, int len,
 
   memset(ret, 0, sizeof(*ret));
 
-  bgav_bitstream_get_golomb_ue(&b, &ret->first_mb_in_slice);
-  bgav_bitstream_get_golomb_ue(&b, &ret->slice_type);
-  bgav_bitstream_get_golomb_ue(&b, &ret->pic_parameter_set_id);
+  /* Called for each frame: Use the unchecked functions, which return
+     zero after the end of the buffer just like the memset above */
+  
+  ret->first_mb_in_slice    = bgav_bitstream_get_golomb_ue_unchecked(&b);
+  ret->slice_type           = bgav_bitstream_get_golomb_ue_unchecked(&b);
+  ret->pic_parameter_set_id = bgav_bitstream_get_golomb_ue_unchecked(&b);
 
   if(sps->separate_colour_plane_flag)
-    bgav_bitstream_get(&b, &ret->colour_plane_id, 2);
+    ret->colour_plane_id = bgav_bitstream_get_unchecked(&b, 2);
 
-  bgav_bitstream_get(&b, &ret->frame_num, sps->log2_max_frame_num_minus4+4);
+  ret->frame_num = bgav_bitstream_get_unchecked(&b, sps->log2_max_frame_num_minus4+4);
 
   if(!sps->frame_mbs_only_flag)
     {
-    bgav_bitstream_get(&b, &ret->field_pic_flag, 1);
+    ret->field_pic_flag = bgav_bitstream_get_unchecked(&b, 1);
     if(ret->field_pic_flag)
-      bgav_bitstream_get(&b, &ret->bottom_field_flag, 1);
+      ret->bottom_field_flag = bgav_bitstream_get_unchecked(&b, 1);
     }
   }
 
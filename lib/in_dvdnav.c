@@ -32,12 +32,30 @@
 #define META_TITLE "title"
 #define META_ANGLE "angle"
 
+#define DVD_BLOCK_SIZE 2048
+
+/* Maximum number of blocks handed to the input at once */
+#define MAX_RUN_BLOCKS 1024
+
 typedef struct
   {
   dvdnav_t * d;
-  uint8_t block[2048];
+  uint8_t block[DVD_BLOCK_SIZE];
   int blocks_read;
 
+  /* Blocks passed to the input by the last read_block() call.
+     If they come from the libdvdnav cache, they are contiguous
+     in memory and must be freed before the next call */
+  uint8_t * run;
+  int run_blocks;
+  int run_cached;
+
+  /* Block, which didn't fit into the last run */
+  uint8_t * pending;
+  int pending_cached;
+
+  int eof;
+
   int current_title;
   int current_angle;
   
@@ -132,11 +150,15 @@ static int open_dvd(bgav_input_context_t * ctx, const char * url, char ** r)
   
   priv = calloc(1, sizeof(*priv));
   ctx->priv = priv;
-  ctx->block_size = 2048;
+  ctx->block_size = DVD_BLOCK_SIZE;
   
   if(dvdnav_open2(&priv->d, NULL, &log_cb, url) != DVDNAV_STATUS_OK)
     goto fail;
 
+  /* Needed for dvdnav_get_next_cache_block() to return
+     pointers into the read ahead cache */
+  dvdnav_set_readahead_flag(priv->d, 1);
+
   /* Read track table */
   if(dvdnav_get_number_of_titles(priv->d, &num_titles) != DVDNAV_STATUS_OK)
     goto fail;
@@ -488,26 +510,112 @@ static int open_dvd(bgav_input_context_t * ctx, const char * url, char ** r)
   return ret;
   }
 
+static void free_run(dvd_priv_t * priv)
+  {
+  int i;
+
+  if(priv->run_cached)
+    {
+    for(i = 0; i < priv->run_blocks; i++)
+      dvdnav_free_cache_block(priv->d, priv->run + i * DVD_BLOCK_SIZE);
+    }
+  priv->run = NULL;
+  priv->run_blocks = 0;
+  priv->run_cached = 0;
+  }
+
+static void free_pending(dvd_priv_t * priv)
+  {
+  if(priv->pending && priv->pending_cached)
+    dvdnav_free_cache_block(priv->d, priv->pending);
+  priv->pending = NULL;
+  priv->pending_cached = 0;
+  }
+
+/* Append a block to the current run. Return 0 if it's not contiguous */
+
+static int append_block(dvd_priv_t * priv, uint8_t * buf)
+  {
+  int cached = (buf != priv->block);
+  
+  if(!priv->run_blocks)
+    {
+    priv->run = buf;
+    priv->run_blocks = 1;
+    priv->run_cached = cached;
+    return 1;
+    }
+  if(cached && priv->run_cached &&
+     (priv->run_blocks < MAX_RUN_BLOCKS) &&
+     (buf == priv->run + priv->run_blocks * DVD_BLOCK_SIZE))
+    {
+    priv->run_blocks++;
+    return 1;
+    }
+  return 0;
+  }
+
+/*
+ *  Pass all data blocks of a VOBU at once. The blocks are taken
+ *  directly from the libdvdnav cache, so they are not copied here.
+ *  A run ends at the next NAV packet, at an event, which ends
+ *  the title or if the next block isn't contiguous in memory.
+ *  Blocks, which aren't from the cache, are stored in priv->block
+ *  and passed alone.
+ */
+
 static int read_block_dvd(bgav_input_context_t * ctx)
   {
-  int ret = 0;
   int done = 0;
   int32_t event, event_len;
+  uint8_t * buf;
   dvd_priv_t * priv = ctx->priv;
 
-  while(dvdnav_get_next_block(priv->d, priv->block, &event, &event_len) == DVDNAV_STATUS_OK)
+  free_run(priv);
+
+  if(priv->pending)
     {
+    append_block(priv, priv->pending);
+    priv->pending = NULL;
+    priv->pending_cached = 0;
+
+    if(!priv->run_cached)
+      done = 1;
+    }
+  else if(priv->eof)
+    return 0;
+  
+  while(!done)
+    {
+    buf = priv->block;
+    
+    if(dvdnav_get_next_cache_block(priv->d, &buf, &event, &event_len) != DVDNAV_STATUS_OK)
+      break;
+
+    if((event != DVDNAV_BLOCK_OK) && (buf != priv->block))
+      {
+      dvdnav_free_cache_block(priv->d, buf);
+      buf = priv->block;
+      }
+    
     switch(event)
       {
       case DVDNAV_STOP:
         done = 1;
+        priv->eof = 1;
         fprintf(stderr, "DVDNAV_STOP\n");
         break;
       case DVDNAV_BLOCK_OK:
-        ret = 1;
-        done = 1;
-        // fprintf(stderr, "DVDNAV_OK\n");
         priv->blocks_read++;
+        
+        if(!append_block(priv, buf))
+          {
+          priv->pending = buf;
+          priv->pending_cached = (buf != priv->block);
+          done = 1;
+          }
+        else if(!priv->run_cached)
+          done = 1; /* Will be overwritten by the next call */
         break;
       case DVDNAV_WAIT:
         fprintf(stderr, "DVDNAV_WAIT\n");
@@ -520,7 +628,9 @@ static int read_block_dvd(bgav_input_context_t * ctx)
         fprintf(stderr, "DVDNAV_STILL_FRAME done\n");
         break;
       case DVDNAV_NAV_PACKET:
-        fprintf(stderr, "DVD_NAV_PACKET\n");
+        /* Start of the next VOBU */
+        if(priv->run_blocks)
+          done = 1;
         break;
       case DVDNAV_CELL_CHANGE:
         {
@@ -533,6 +643,7 @@ static int read_block_dvd(bgav_input_context_t * ctx)
         if(title != priv->current_title)
           {
           fprintf(stderr, "Detected track change\n");
+          priv->eof = 1;
           done = 1;
           }
         }
@@ -543,18 +654,24 @@ static int read_block_dvd(bgav_input_context_t * ctx)
       case DVDNAV_AUDIO_STREAM_CHANGE:
       case DVDNAV_VTS_CHANGE:
         if(priv->blocks_read)
+          {
+          priv->eof = 1;
           done = 1;
+          }
         break;
       default:
         fprintf(stderr, "Unhandled event %d\n", event);
         break;
       }
-    if(done)
-      break;
     }
-  ctx->block = priv->block;
+
+  if(!priv->run_blocks)
+    return 0;
   
-  return ret;
+  ctx->block = priv->run;
+  ctx->block_size = priv->run_blocks * DVD_BLOCK_SIZE;
+  
+  return 1;
   }
 
 static int select_track_dvd(bgav_input_context_t * ctx, int track)
@@ -567,6 +684,11 @@ static int select_track_dvd(bgav_input_context_t * ctx, int track)
   gavl_dictionary_get_int(dict, META_ANGLE, &priv->current_angle);
   priv->blocks_read = 0;
   
+  free_run(priv);
+  free_pending(priv);
+  priv->eof = 0;
+  ctx->block_ptr = NULL;
+  
   /* Select track and angle and start vm */
   dvdnav_title_play(priv->d, priv->current_title);
   dvdnav_angle_change(priv->d, priv->current_angle);
@@ -578,7 +700,11 @@ static void close_dvd(bgav_input_context_t * ctx)
   dvd_priv_t * priv = ctx->priv;
   
   if(priv->d)
+    {
+    free_run(priv);
+    free_pending(priv);
     dvdnav_close(priv->d);
+    }
   free(priv);
   }
 
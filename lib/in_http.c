@@ -36,6 +36,52 @@
    downloaded at once and buffered */
 #define MAX_DOWNLOAD_SIZE (100*1024*1024)
 
+/*
+ *  Block cache for seekable resources. The file is divided into
+ *  aligned blocks, which are kept in memory (LRU). Consecutive misses
+ *  are served from the same range request with a growing readahead.
+ *  Blocks, which were slow to download, can be spilled to a temporary
+ *  file when they are evicted from memory.
+ */
+
+#define BLOCK_SIZE    (64*1024)
+#define MEM_BLOCKS    128 /* 8 MB */
+#define MAX_READAHEAD 16  /* Blocks */
+
+typedef struct
+  {
+  int64_t index; /* -1 if unused */
+  int len;
+  int64_t last_used;
+  gavl_time_t fetch_time;
+  uint8_t * data;
+  } cache_block_t;
+
+typedef struct
+  {
+  cache_block_t blocks[MEM_BLOCKS];
+  uint8_t * mem;
+  int64_t counter;
+  
+  int64_t num_blocks;
+  int64_t position;    /* Read position */
+  int64_t io_position; /* Position of the http client, -1 if unknown */
+
+  /* Sequential readahead */
+  int64_t next_block;
+  int readahead;
+  
+  /* Spill file */
+  FILE * spill;
+  int32_t * spill_slots; /* Slot + 1 for each block, 0 if not spilled */
+  int num_spill_slots;
+  int max_spill_slots;
+  gavl_time_t spill_time;
+
+  /* Seeking the http client failed: Fall back to uncached reading */
+  int failed;
+  } block_cache_t;
+
 typedef struct
   {
   int icy_metaint;
@@ -47,9 +93,259 @@ typedef struct
   int64_t bytes_read;
 
   gavl_buffer_t buffer;
-  
+
+  block_cache_t * cache;
+
+  /* The client is at an unknown position after a failed seek */
+  int seek_error;
   } http_priv;
 
+static block_cache_t * cache_create(bgav_input_context_t * ctx)
+  {
+  int i;
+  block_cache_t * c = calloc(1, sizeof(*c));
+
+  c->mem = malloc(MEM_BLOCKS * BLOCK_SIZE);
+  
+  for(i = 0; i < MEM_BLOCKS; i++)
+    {
+    c->blocks[i].index = -1;
+    c->blocks[i].data = c->mem + i * BLOCK_SIZE;
+    }
+  
+  c->num_blocks = (ctx->total_bytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  c->readahead = 1;
+  
+  /* Spilling follows the semantics of the index cache options:
+     Only blocks, which took longer than cache_time to download are
+     kept and the total size is limited by cache_size (0 = infinite) */
+  
+  if(ctx->opt.cache_size > 0)
+    c->max_spill_slots = (int64_t)ctx->opt.cache_size * 1024 * 1024 / BLOCK_SIZE;
+  else
+    c->max_spill_slots = c->num_blocks;
+
+  if(c->max_spill_slots > c->num_blocks)
+    c->max_spill_slots = c->num_blocks;
+  
+  c->spill_time = (gavl_time_t)ctx->opt.cache_time * (GAVL_TIME_SCALE / 1000);
+  
+  return c;
+  }
+
+static void cache_destroy(block_cache_t * c)
+  {
+  if(c->spill)
+    fclose(c->spill);
+  if(c->spill_slots)
+    free(c->spill_slots);
+  free(c->mem);
+  free(c);
+  }
+
+static cache_block_t * cache_find(block_cache_t * c, int64_t index)
+  {
+  int i;
+  for(i = 0; i < MEM_BLOCKS; i++)
+    {
+    if(c->blocks[i].index == index)
+      return &c->blocks[i];
+    }
+  return NULL;
+  }
+
+static int cache_is_spilled(block_cache_t * c, int64_t index)
+  {
+  return c->spill_slots && c->spill_slots[index];
+  }
+
+static void cache_spill(block_cache_t * c, cache_block_t * b)
+  {
+  if((b->fetch_time < c->spill_time) ||
+     (c->num_spill_slots >= c->max_spill_slots) ||
+     cache_is_spilled(c, b->index))
+    return;
+
+  if(!c->spill)
+    {
+    if(!(c->spill = tmpfile()))
+      {
+      gavl_log(GAVL_LOG_WARNING, LOG_DOMAIN, "Cannot create spill file for the block cache");
+      c->max_spill_slots = 0;
+      return;
+      }
+    c->spill_slots = calloc(c->num_blocks, sizeof(*c->spill_slots));
+    }
+  
+  if(fseeko(c->spill, (off_t)c->num_spill_slots * BLOCK_SIZE, SEEK_SET) ||
+     (fwrite(b->data, 1, b->len, c->spill) < (size_t)b->len))
+    return;
+  
+  c->spill_slots[b->index] = ++c->num_spill_slots;
+  }
+
+/* Get an unused block, evict the least recently used one if necessary */
+
+static cache_block_t * cache_get_free(block_cache_t * c)
+  {
+  int i;
+  cache_block_t * ret = &c->blocks[0];
+  
+  for(i = 0; i < MEM_BLOCKS; i++)
+    {
+    if(c->blocks[i].index < 0)
+      return &c->blocks[i];
+    if(c->blocks[i].last_used < ret->last_used)
+      ret = &c->blocks[i];
+    }
+  
+  cache_spill(c, ret);
+  ret->index = -1;
+  return ret;
+  }
+
+static int read_data(bgav_input_context_t* ctx,
+                     uint8_t * buffer, int len);
+
+/* Fetch a block (and possibly the following ones) into memory */
+
+static cache_block_t * cache_fetch(bgav_input_context_t * ctx, int64_t index)
+  {
+  int i;
+  int num;
+  int len;
+  int64_t pos;
+  gavl_time_t fetch_time;
+  cache_block_t * b;
+  cache_block_t * ret = NULL;
+  http_priv * p = ctx->priv;
+  block_cache_t * c = p->cache;
+  
+  if((b = cache_find(c, index)))
+    {
+    b->last_used = ++c->counter;
+    return b;
+    }
+
+  /* Re-read spilled block */
+  if(cache_is_spilled(c, index))
+    {
+    b = cache_get_free(c);
+    
+    pos = index * BLOCK_SIZE;
+    len = (ctx->total_bytes - pos < BLOCK_SIZE) ? ctx->total_bytes - pos : BLOCK_SIZE;
+    
+    if(!fseeko(c->spill, (off_t)(c->spill_slots[index] - 1) * BLOCK_SIZE, SEEK_SET) &&
+       (fread(b->data, 1, len, c->spill) == (size_t)len))
+      {
+      b->index = index;
+      b->len = len;
+      b->fetch_time = 0;
+      b->last_used = ++c->counter;
+      return b;
+      }
+    c->spill_slots[index] = 0;
+    }
+  
+  /* Grow the readahead for sequential access */
+  if(index == c->next_block)
+    {
+    c->readahead *= 2;
+    if(c->readahead > MAX_READAHEAD)
+      c->readahead = MAX_READAHEAD;
+    }
+  else
+    c->readahead = 1;
+  
+  /* Coalesce the following uncached blocks into the same request */
+  num = 1;
+  
+  while((num < c->readahead) && (index + num < c->num_blocks) &&
+        !cache_find(c, index + num) && !cache_is_spilled(c, index + num))
+    num++;
+  
+  pos = index * BLOCK_SIZE;
+  
+  if(c->io_position != pos)
+    {
+    if(gavf_io_seek(p->io, pos, SEEK_SET) != pos)
+      {
+      gavl_log(GAVL_LOG_WARNING, LOG_DOMAIN,
+               "Seeking to %"PRId64" failed, disabling the block cache", pos);
+      c->io_position = -1;
+      c->failed = 1;
+      return NULL;
+      }
+    c->io_position = pos;
+    }
+  
+  fetch_time = bgav_stats_time();
+  
+  for(i = 0; i < num; i++)
+    {
+    b = cache_get_free(c);
+    
+    len = (ctx->total_bytes - pos < BLOCK_SIZE) ? ctx->total_bytes - pos : BLOCK_SIZE;
+
+    if(read_data(ctx, b->data, len) < len)
+      {
+      c->io_position = -1;
+      break;
+      }
+    
+    b->index = index + i;
+    b->len = len;
+    b->last_used = ++c->counter;
+
+    if(!i)
+      ret = b;
+    
+    pos += len;
+    c->io_position = pos;
+    }
+
+  /* Distribute the download time over the blocks */
+  if(i > 0)
+    {
+    fetch_time = (bgav_stats_time() - fetch_time) / i;
+    num = i;
+    for(i = 0; i < num; i++)
+      {
+      if((b = cache_find(c, index + i)))
+        b->fetch_time = fetch_time;
+      }
+    }
+  
+  c->next_block = index + num;
+  return ret;
+  }
+
+static int read_cached(bgav_input_context_t * ctx, uint8_t * buffer, int len)
+  {
+  int bytes_read = 0;
+  int offset;
+  int bytes_to_copy;
+  cache_block_t * b;
+  http_priv * p = ctx->priv;
+  block_cache_t * c = p->cache;
+
+  while((bytes_read < len) && (c->position < ctx->total_bytes))
+    {
+    if(!(b = cache_fetch(ctx, c->position / BLOCK_SIZE)))
+      break;
+    
+    offset = c->position - b->index * BLOCK_SIZE;
+    bytes_to_copy = b->len - offset;
+    if(bytes_to_copy > len - bytes_read)
+      bytes_to_copy = len - bytes_read;
+
+    memcpy(buffer + bytes_read, b->data + offset, bytes_to_copy);
+    bytes_read += bytes_to_copy;
+    c->position += bytes_to_copy;
+    }
+  return bytes_read;
+  }
+
 static void create_header(gavl_dictionary_t * ret, const bgav_options_t * opt)
   {
   gavl_dictionary_set_string(ret, "User-Agent", PACKAGE"/"VERSION);
@@ -240,7 +536,15 @@ static int open_http(bgav_input_context_t * ctx, const char * url1, char ** r)
     }
 
   if(gavf_io_can_seek(p->io))
-    ctx->flags |= (BGAV_INPUT_SEEK_SLOW | BGAV_INPUT_CAN_PAUSE);
+    {
+    ctx->flags |= BGAV_INPUT_CAN_PAUSE;
+
+    /* With the block cache, seeking is cheap enough for bisection */
+    if(!p->icy_metaint && (ctx->total_bytes > 0))
+      p->cache = cache_create(ctx);
+    else
+      ctx->flags |= BGAV_INPUT_SEEK_SLOW;
+    }
   else
     ctx->flags &= ~BGAV_INPUT_CAN_SEEK_BYTE;
   
@@ -257,7 +561,15 @@ static int64_t seek_byte_http(bgav_input_context_t * ctx,
   {
   http_priv * p = ctx->priv;
   //  fprintf(stderr, "seek_byte_http %"PRId64" %"PRId64"\n", pos, ctx->position);
-  gavf_io_seek(p->io, pos, whence);
+
+  /* Data is fetched on demand */
+  if(p->cache)
+    {
+    p->cache->position = ctx->position;
+    return ctx->position;
+    }
+  
+  p->seek_error = (gavf_io_seek(p->io, pos, whence) != ctx->position);
   return ctx->position;
   }
 
@@ -266,6 +578,9 @@ static void pause_http(bgav_input_context_t * ctx)
   http_priv * p = ctx->priv;
   //  fprintf(stderr, "pause_http\n");
   gavl_http_client_pause(p->io);
+
+  if(p->cache)
+    p->cache->io_position = -1;
   }
 
 static void resume_http(bgav_input_context_t * ctx)
@@ -429,6 +744,34 @@ static int do_read(bgav_input_context_t* ctx,
 static int read_http(bgav_input_context_t* ctx,
                      uint8_t * buffer, int len)
   {
+  int bytes_read;
+  http_priv * p = ctx->priv;
+
+  if(p->cache)
+    {
+    bytes_read = read_cached(ctx, buffer, len);
+    
+    if(!p->cache->failed)
+      return bytes_read;
+
+    /* Continue uncached from the current position of the client */
+    cache_destroy(p->cache);
+    p->cache = NULL;
+    ctx->flags |= BGAV_INPUT_SEEK_SLOW;
+    
+    p->seek_error = (gavf_io_seek(p->io, ctx->position + bytes_read, SEEK_SET) !=
+                     ctx->position + bytes_read);
+    
+    if(p->seek_error)
+      return bytes_read;
+    
+    return bytes_read + do_read(ctx, buffer + bytes_read, len - bytes_read);
+    }
+
+  /* Don't deliver data from the wrong offset */
+  if(p->seek_error)
+    return 0;
+  
   return do_read(ctx, buffer, len);
   }
 
@@ -442,6 +785,10 @@ static void close_http(bgav_input_context_t * ctx)
   
   if(p->charset_cnv)
     bgav_charset_converter_destroy(p->charset_cnv);
+
+  if(p->cache)
+    cache_destroy(p->cache);
+  
   free(p);
   }
 
@@ -28,21 +28,26 @@
 
 typedef struct
   {
-  uint8_t * data;
-  uint8_t * data_ptr;
+  const uint8_t * data;
+  const uint8_t * data_ptr;
   bgav_input_context_t* input;
-  
+
+  /* Called on close for caller owned memory */
+  void (*free_func)(void * priv);
+  void * free_priv;
   } mem_priv_t;
 
 static int read_mem(bgav_input_context_t* ctx,
                     uint8_t * buffer, int len)
   {
   int bytes_to_read;
-  int bytes_left;
+  int64_t bytes_left;
   
   mem_priv_t * priv = ctx->priv;
-  bytes_left = ctx->total_bytes - (uint32_t)(priv->data_ptr - priv->data);
+  bytes_left = ctx->total_bytes - (priv->data_ptr - priv->data);
   bytes_to_read = (len < bytes_left) ? len : bytes_left;
+  if(bytes_to_read <= 0)
+    return 0;
   memcpy(buffer, priv->data_ptr, bytes_to_read);
   priv->data_ptr += bytes_to_read;
   return bytes_to_read;
@@ -52,26 +57,42 @@ static int64_t seek_byte_mem(bgav_input_context_t * ctx,
                              int64_t pos, int whence)
   {
   mem_priv_t * priv = ctx->priv;
+
+  if(ctx->position > ctx->total_bytes)
+    ctx->position = ctx->total_bytes;
+  
   priv->data_ptr = priv->data + ctx->position;
   return ctx->position;
   }
 
+static const uint8_t * get_ptr_mem(bgav_input_context_t * ctx,
+                                   int64_t * len)
+  {
+  mem_priv_t * priv = ctx->priv;
+  *len = ctx->total_bytes - (priv->data_ptr - priv->data);
+  return priv->data_ptr;
+  }
+
 static void    close_mem(bgav_input_context_t * ctx)
   {
   mem_priv_t * priv = ctx->priv;
+  if(priv->free_func)
+    priv->free_func(priv->free_priv);
   free(priv);
   }
 
 static const bgav_input_t input_mem =
   {
+    .name =      "memory",
     .open =      NULL, /* Not needed */
     .read =      read_mem,
     .seek_byte = seek_byte_mem,
+    .get_ptr =   get_ptr_mem,
     .close =     close_mem
   };
 
-bgav_input_context_t * bgav_input_open_memory(uint8_t * data,
-                                              uint32_t data_size)
+bgav_input_context_t * bgav_input_open_memory(const uint8_t * data,
+                                              int64_t data_size)
   {
   bgav_input_context_t * ret;
   mem_priv_t * priv;
@@ -89,8 +110,8 @@ bgav_input_context_t * bgav_input_open_memory(uint8_t * data,
   }
 
 void bgav_input_reopen_memory(bgav_input_context_t * ctx,
-                              uint8_t * data,
-                              uint32_t data_size)
+                              const uint8_t * data,
+                              int64_t data_size)
   {
   mem_priv_t * priv;
   priv = ctx->priv;
@@ -103,6 +124,37 @@ void bgav_input_reopen_memory(bgav_input_context_t * ctx,
   gavl_buffer_reset(&ctx->buf);
   }
 
+int bgav_open_memory(bgav_t * b,
+                     const uint8_t * data, int64_t data_size,
+                     void (*free_func)(void * priv), void * free_priv,
+                     const char * filename, const char * mimetype)
+  {
+  mem_priv_t * priv;
+  
+  bgav_codecs_init(&b->opt);
+
+  priv = calloc(1, sizeof(*priv));
+  priv->data      = data;
+  priv->data_ptr  = data;
+  priv->free_func = free_func;
+  priv->free_priv = free_priv;
+  
+  b->input = bgav_input_create(b, NULL);
+  b->input->priv = priv;
+  b->input->input = &input_mem;
+  b->input->total_bytes = data_size;
+  b->input->flags |= BGAV_INPUT_CAN_SEEK_BYTE;
+  b->input->location = gavl_strdup(filename);
+  
+  if(mimetype)
+    gavl_dictionary_set_string(gavl_metadata_get_src_nc(&b->input->m, GAVL_META_SRC, 0),
+                               GAVL_META_MIMETYPE, mimetype);
+  
+  if(!bgav_init(b))
+    return 0;
+  return 1;
+  }
+
 /* Buffer for another input */
 
 static int read_buffer(bgav_input_context_t* ctx,
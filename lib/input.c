@@ -38,7 +38,7 @@
 
 #undef HAVE_LINUXDVB
 
-static int do_read(bgav_input_context_t * ctx, uint8_t * buffer, int len)
+static int do_read_internal(bgav_input_context_t * ctx, uint8_t * buffer, int len)
   {
   if(ctx->input->read)
     {
@@ -74,6 +74,20 @@ static int do_read(bgav_input_context_t * ctx, uint8_t * buffer, int len)
     
   }
 
+static int do_read(bgav_input_context_t * ctx, uint8_t * buffer, int len)
+  {
+  int ret;
+  gavl_time_t t = bgav_stats_time();
+  
+  ret = do_read_internal(ctx, buffer, len);
+
+  ctx->counters.read_time += bgav_stats_time() - t;
+  ctx->counters.read_calls++;
+  if(ret > 0)
+    ctx->counters.bytes_read += ret;
+  return ret;
+  }
+
 static void add_char_16(gavl_buffer_t * buf,
                         uint16_t c)
   {
@@ -245,8 +259,13 @@ static int input_read_data(bgav_input_context_t * ctx, uint8_t * buffer, int len
   if(len > bytes_read)
     {
     if(!block && ctx->input->read_nonblock)
+      {
       result =
         ctx->input->read_nonblock(ctx, buffer + bytes_read, len - bytes_read);
+      ctx->counters.read_calls++;
+      if(result > 0)
+        ctx->counters.bytes_read += result;
+      }
     else
       result = do_read(ctx, buffer + bytes_read, len - bytes_read);
     
@@ -306,6 +325,19 @@ int bgav_input_get_data(bgav_input_context_t * ctx, uint8_t * buffer, int len)
     }
 
   
+  /* Memory input: Copy directly from the source */
+  if(ctx->input->get_ptr && (ctx->buf.pos >= ctx->buf.len))
+    {
+    int64_t bytes_available;
+    const uint8_t * ptr = ctx->input->get_ptr(ctx, &bytes_available);
+
+    bytes_gotten = (len > bytes_available) ? bytes_available : len;
+    
+    if(bytes_gotten > 0)
+      memcpy(buffer, ptr, bytes_gotten);
+    return bytes_gotten;
+    }
+  
   bgav_input_ensure_buffer_size(ctx, len);
   
   bytes_gotten = (len > ctx->buf.len) ? ctx->buf.len : len;
@@ -1009,18 +1041,31 @@ void bgav_input_close(bgav_input_context_t * ctx)
   return;
   }
 
+void bgav_input_counters_add(bgav_input_counters_t * dst,
+                             const bgav_input_counters_t * src)
+  {
+  dst->bytes_read    += src->bytes_read;
+  dst->read_calls    += src->read_calls;
+  dst->read_time     += src->read_time;
+  dst->seeks         += src->seeks;
+  dst->bytes_skipped += src->bytes_skipped;
+  }
+
 void bgav_input_destroy(bgav_input_context_t * ctx)
   {
   bgav_input_close(ctx);
   free(ctx);
   }
 
+/* Chunk size for discarding data from unseekable inputs */
+#define SKIP_BUFFER_SIZE 16384
+
 void bgav_input_skip(bgav_input_context_t * ctx, int64_t bytes)
   {
-  int i;
+  int result;
   //  int64_t old_pos;
   int64_t bytes_to_skip = bytes;
-  uint8_t buf;
+  uint8_t buf[SKIP_BUFFER_SIZE];
 
   //  ctx->position += bytes;
   //  old_pos = ctx->position;
@@ -1028,6 +1073,8 @@ void bgav_input_skip(bgav_input_context_t * ctx, int64_t bytes)
   if(bytes < 0)
     fprintf(stderr, "Bytes < 0 in bgav_input_skip. That's most likely a bug\n");
 
+  ctx->counters.bytes_skipped += bytes;
+
   if(ctx->buf.len > ctx->buf.pos)
     {
     if(ctx->buf.len - ctx->buf.pos >= bytes_to_skip)
@@ -1047,16 +1094,23 @@ void bgav_input_skip(bgav_input_context_t * ctx, int64_t bytes)
       gavl_buffer_reset(&ctx->buf);
       }
     }
-  if((ctx->flags & (BGAV_INPUT_CAN_SEEK_BYTE|BGAV_INPUT_SEEK_SLOW)) ==
-     BGAV_INPUT_CAN_SEEK_BYTE)
+  if(((ctx->flags & (BGAV_INPUT_CAN_SEEK_BYTE|BGAV_INPUT_SEEK_SLOW)) ==
+      BGAV_INPUT_CAN_SEEK_BYTE) || ctx->input->get_ptr)
     bgav_input_seek(ctx, bytes_to_skip, SEEK_CUR);
   else if(((ctx->flags & (BGAV_INPUT_CAN_SEEK_BYTE|BGAV_INPUT_SEEK_SLOW)) ==
            (BGAV_INPUT_CAN_SEEK_BYTE|BGAV_INPUT_SEEK_SLOW)) && (bytes_to_skip >= 10 * 1024))
     bgav_input_seek(ctx, bytes_to_skip, SEEK_CUR);
-  else /* Only small amounts of data should be skipped like this */
+  else /* Read and discard */
     {
-    for(i = 0; i < bytes_to_skip; i++)
-      bgav_input_read_8(ctx, &buf);
+    while(bytes_to_skip > 0)
+      {
+      result = bgav_input_read_data(ctx, buf,
+                                    bytes_to_skip > SKIP_BUFFER_SIZE ?
+                                    SKIP_BUFFER_SIZE : bytes_to_skip);
+      if(result <= 0)
+        break;
+      bytes_to_skip -= result;
+      }
     }
   //  do_buffer(ctx);
   }
@@ -1092,10 +1146,47 @@ void bgav_input_seek(bgav_input_context_t * ctx,
                      int64_t position,
                      int whence)
   {
+  int64_t buf_start;
+  int64_t new_position;
+  
   /*
    *  ctx->position MUST be set before seeking takes place
    *  because some seek() methods might use the position value
    */
+
+  switch(whence)
+    {
+    case SEEK_CUR:
+      new_position = ctx->position + position;
+      break;
+    case SEEK_END:
+      new_position = ctx->total_bytes + position;
+      break;
+    default:
+      new_position = position;
+      break;
+    }
+
+  /*
+   *  If the target is still in the buffer, we just move the buffer position.
+   *  The buffer starts at ctx->position - ctx->buf.pos and the underlying
+   *  input is positioned after its end.
+   */
+  
+  if(ctx->buf.len > 0)
+    {
+    buf_start = ctx->position - ctx->buf.pos;
+    
+    if((new_position >= buf_start) &&
+       (new_position < buf_start + ctx->buf.len))
+      {
+      ctx->buf.pos = new_position - buf_start;
+      ctx->position = new_position;
+      return;
+      }
+    }
+
+  ctx->counters.seeks++;
   
   switch(whence)
     {
@@ -1170,13 +1261,15 @@ int bgav_input_reopen(bgav_input_context_t * ctx)
   char * redir = NULL;
   bgav_options_t opt;
   bgav_track_table_t * tt = NULL;
-
+  bgav_input_counters_t counters;
+  
   bgav_t * b;
   
   if(ctx->location)
     {
     location = ctx->location;
     input = ctx->input;
+    counters = ctx->counters;
 
     bgav_options_copy(&opt, &ctx->opt);
     
@@ -1200,6 +1293,7 @@ int bgav_input_reopen(bgav_input_context_t * ctx)
     bgav_options_copy(&ctx->opt, &opt);
     
     ctx->b = b;
+    ctx->counters = counters;
     
     if(!ctx->input->open(ctx, location, &redir))
       {
@@ -1220,6 +1314,30 @@ int bgav_input_reopen(bgav_input_context_t * ctx)
   return ret;
   }
 
+bgav_input_context_t * bgav_input_clone(bgav_input_context_t * ctx)
+  {
+  bgav_input_context_t * ret;
+  char * redir = NULL;
+  
+  /* Only local files can be opened multiple times cheaply */
+  if((ctx->input != &bgav_input_file) || !ctx->location)
+    return NULL;
+
+  ret = bgav_input_create(ctx->b, &ctx->opt);
+  ret->input = ctx->input;
+  ret->flags = BGAV_INPUT_CAN_SEEK_BYTE;
+  gavl_metadata_add_src(&ret->m, GAVL_META_SRC, NULL, ctx->location);
+  
+  if(!ret->input->open(ret, ctx->location, &redir))
+    {
+    if(redir)
+      free(redir);
+    bgav_input_destroy(ret);
+    return NULL;
+    }
+  return ret;
+  }
+
 bgav_yml_node_t * bgav_input_get_yml(bgav_input_context_t * ctx)
   {
   if(ctx->yml)
@@ -2059,9 +2059,11 @@ void bgav_mkv_cluster_free(bgav_mkv_cluster_t * c)
 
 /* Block */
 
-int bgav_mkv_block_read(bgav_input_context_t * ctx,
-                         bgav_mkv_block_t * ret,
-                         bgav_mkv_element_t * parent)
+/* Read the block header, the input is left at the start of the payload */
+
+int bgav_mkv_block_read_header(bgav_input_context_t * ctx,
+                               bgav_mkv_block_t * ret,
+                               bgav_mkv_element_t * parent)
   {
   uint8_t tmp_8;
   int data_alloc_save;
@@ -2098,6 +2100,15 @@ int bgav_mkv_block_read(bgav_input_context_t * ctx,
 
   ret->data_size = parent->size - (ctx->position - pos);
 
+  if(ret->data_size < 0)
+    return 0;
+  
+  return 1;
+  }
+
+int bgav_mkv_block_read_payload(bgav_input_context_t * ctx,
+                                bgav_mkv_block_t * ret)
+  {
   if(ret->data_alloc < ret->data_size)
     {
     ret->data_alloc = ret->data_size + 1024;
@@ -2109,6 +2120,14 @@ int bgav_mkv_block_read(bgav_input_context_t * ctx,
   return 1;
   }
 
+int bgav_mkv_block_read(bgav_input_context_t * ctx,
+                         bgav_mkv_block_t * ret,
+                         bgav_mkv_element_t * parent)
+  {
+  return bgav_mkv_block_read_header(ctx, ret, parent) &&
+    bgav_mkv_block_read_payload(ctx, ret);
+  }
+
 void bgav_mkv_block_dump(int indent, bgav_mkv_block_t * b)
   {
   bgav_diprintf(indent, "Block\n");
@@ -2168,7 +2187,16 @@ int bgav_mkv_block_group_read(bgav_input_context_t * ctx,
         break;
       case MKV_ID_Block:
       case MKV_ID_SimpleBlock:
-        if(!bgav_mkv_block_read(ctx, &ret->block, &e))
+        if(!bgav_mkv_block_read_header(ctx, &ret->block, &e))
+          return 0;
+
+        if(ret->read_payload &&
+           !ret->read_payload(ret->read_payload_priv, ret->block.track))
+          {
+          bgav_input_skip(ctx, ret->block.data_size);
+          ret->block.skipped = 1;
+          }
+        else if(!bgav_mkv_block_read_payload(ctx, &ret->block))
           return 0;
         break;
       default:
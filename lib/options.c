@@ -122,6 +122,11 @@ void bgav_options_set_audio_dynrange(bgav_options_t* opt, int audio_dynrange)
   opt->audio_dynrange = audio_dynrange;
   }
 
+void bgav_options_set_pcm_zerocopy(bgav_options_t* opt, int zerocopy)
+  {
+  opt->pcm_zerocopy = zerocopy;
+  }
+
 
 
 void bgav_options_set_default_subtitle_encoding(bgav_options_t* b,
@@ -178,6 +183,21 @@ void bgav_options_set_dv_datetime(bgav_options_t* opt,
   opt->dv_datetime = datetime;
   }
 
+void bgav_options_set_image_sequence(bgav_options_t* opt,
+                                     int enable)
+  {
+  opt->image_sequence = enable;
+  }
+
+void bgav_options_set_image_sequence_rate(bgav_options_t* opt,
+                                          int timescale, int frame_duration)
+  {
+  if((timescale <= 0) || (frame_duration <= 0))
+    return;
+  opt->image_sequence_timescale = timescale;
+  opt->image_sequence_frame_duration = frame_duration;
+  }
+
 void bgav_options_set_shrink(bgav_options_t* opt,
                              int shrink)
   {
@@ -196,9 +216,20 @@ void bgav_options_set_vaapi(bgav_options_t* opt,
   opt->vaapi = vaapi;
   }
 
+void bgav_options_set_mpegts_all_programs(bgav_options_t* opt,
+                                          int enable)
+  {
+  opt->mpegts_all_programs = enable;
+  }
+
 void bgav_options_set_threads(bgav_options_t * opt, int threads)
   {
-  /* NOOP */
+  opt->threads = threads;
+  }
+
+void bgav_options_set_thread_type(bgav_options_t * opt, int thread_type)
+  {
+  opt->thread_type = thread_type;
   }
 
 void bgav_options_set_dump_headers(bgav_options_t* opt,
@@ -240,6 +271,9 @@ void bgav_options_set_defaults(bgav_options_t * b)
   b->cache_time = 500;
   b->cache_size = 20;
 
+  b->image_sequence_timescale = 25;
+  b->image_sequence_frame_duration = 1;
+
   b->vaapi = 1;
 
   b->log_level =
@@ -302,16 +336,24 @@ void bgav_options_copy(bgav_options_t * dst, const bgav_options_t * src)
   /* DVB */
   
   CP_STR(dvb_channels_file);
+
+  CP_INT(mpegts_all_programs);
   
   /* Audio */
 
   CP_INT(audio_dynrange);
+  CP_INT(pcm_zerocopy);
   
   CP_INT(prefer_ffmpeg_demuxers);
   CP_INT(dv_datetime);
+  CP_INT(image_sequence);
+  CP_INT(image_sequence_timescale);
+  CP_INT(image_sequence_frame_duration);
   CP_INT(shrink);
 
   CP_INT(vaapi);
+  CP_INT(threads);
+  CP_INT(thread_type);
   CP_INT(dump_headers);
   CP_INT(dump_indices);
   CP_INT(dump_packets);
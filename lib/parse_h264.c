@@ -80,6 +80,16 @@ static void get_rbsp(bgav_packet_parser_t * parser, const uint8_t * pos, int len
   priv->rbsp_len = bgav_h264_decode_nal_rbsp(pos, len, priv->rbsp);
   }
 
+/* Unescape only the part of the slice, which the header parser looks at */
+
+static void get_slice_header_rbsp(bgav_packet_parser_t * parser,
+                                  const uint8_t * pos, int len)
+  {
+  if(len > H264_SLICE_HEADER_MAX_BYTES)
+    len = H264_SLICE_HEADER_MAX_BYTES;
+  get_rbsp(parser, pos, len);
+  }
+
 static const uint8_t avchd_mdpm[] =
   { 0x17,0xee,0x8c,0x60,0xf8,0x4d,0x11,0xd9,0x8c,0xd6,0x08,0x00,0x20,0x0c,0x9a,0x66,
     'M','D','P','M' };
@@ -408,7 +418,7 @@ static int parse_frame_avc(bgav_packet_parser_t * parser,
       if(nh.ref_idc)
         PACKET_SET_REF(p);
       
-      get_rbsp(parser, ptr, nal_len - 1);
+      get_slice_header_rbsp(parser, ptr, nal_len - 1);
 
       bgav_h264_slice_header_parse(priv->rbsp, priv->rbsp_len,
                                    &priv->sps,
@@ -727,7 +737,7 @@ static int parse_frame_h264(bgav_packet_parser_t * parser, bgav_packet_t * p)
         //        if(!priv->has_picture_start || !parser->cache[parser->cache_size-1].coding_type)
         //          {
         nal_end = get_nal_end(p, ptr);
-        get_rbsp(parser, ptr, nal_end - ptr);
+        get_slice_header_rbsp(parser, ptr, nal_end - ptr);
         
         bgav_h264_slice_header_parse(priv->rbsp, priv->rbsp_len,
                                      &priv->sps,
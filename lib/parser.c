@@ -106,30 +106,74 @@ parsers[] =
     { /* End */ }
   };
 
+/* Update buf after store or store_start changed */
+
+static void update_view(bgav_packet_parser_t * p)
+  {
+  p->buf.buf = p->store.buf + p->store_start;
+  p->buf.len = p->store.len - p->store_start;
+  }
+
+static void parser_append(bgav_packet_parser_t * p, gavl_packet_t * pkt)
+  {
+  int remaining = p->store.len - p->store_start;
+
+  if(!remaining && (pkt == &p->in_packet) && pkt->buf.alloc)
+    {
+    /* Take over the packet memory instead of copying */
+    gavl_buffer_t tmp = p->store;
+    p->store = pkt->buf;
+    pkt->buf = tmp;
+    gavl_buffer_reset(&pkt->buf);
+    p->store_start = 0;
+    }
+  else
+    {
+    /* Move the remaining bytes to the start only if they are less than
+       the flushed ones or if we would need to realloc anyway */
+    if(p->store_start &&
+       ((p->store_start >= remaining) ||
+        (p->store.len + pkt->buf.len > p->store.alloc)))
+      {
+      if(remaining)
+        memmove(p->store.buf, p->store.buf + p->store_start, remaining);
+      p->store.len = remaining;
+      p->store_start = 0;
+      }
+    gavl_buffer_append(&p->store, &pkt->buf);
+    }
+  update_view(p);
+  }
+
 static void parser_flush_bytes(bgav_packet_parser_t * p)
   {
   int i;
   int num_del = 0;
   int bytes = p->buf.pos;
+  packet_info_t * pi;
   
   if(!bytes)
     return;
-  
-  gavl_buffer_flush(&p->buf, bytes);
+
+  p->store_start += bytes;
+  update_view(p);
+  p->buf.pos = 0;
   
   p->raw_position += bytes;
+
+  pi = p->packets + p->packets_start;
   
   for(i = 0; i < p->num_packets; i++)
     {
-    if(p->packets[i].size > bytes)
+    if(pi[i].size > bytes)
       {
-      p->packets[i].size -= bytes;
+      pi[i].size -= bytes;
       break;
       }
     else
       {
-      bytes -= p->packets[i].size;
-      p->packets[i].size = 0;
+      bytes -= pi[i].size;
+      pi[i].size = 0;
       num_del++;
       if(!bytes)
         break;
@@ -138,11 +182,11 @@ static void parser_flush_bytes(bgav_packet_parser_t * p)
 
   if(num_del > 0)
     {
-    if(num_del < p->num_packets)
-      memmove(p->packets, p->packets + num_del, sizeof(*p->packets) * (p->num_packets - num_del));
+    p->packets_start += num_del;
     p->num_packets -= num_del;
+    if(!p->num_packets)
+      p->packets_start = 0;
     }
-  
   }
 
 static int do_parse_frame(bgav_packet_parser_t * p, gavl_packet_t * pkt)
@@ -172,6 +216,41 @@ static int do_parse_frame(bgav_packet_parser_t * p, gavl_packet_t * pkt)
   return 1;
   }
 
+/* Output the first p->buf.pos bytes as a frame */
+
+static gavl_sink_status_t output_frame(bgav_packet_parser_t * p)
+  {
+  packet_info_t * pi;
+  gavl_packet_t * pkt = gavl_packet_sink_get_packet(p->next);
+  
+  gavl_buffer_append_data_pad(&pkt->buf, p->buf.buf, p->buf.pos, GAVL_PACKET_PADDING);
+
+  /* Set pts */
+  if(p->num_packets)
+    {
+    pi = p->packets + p->packets_start;
+    
+    if(pi->pts != GAVL_TIME_UNDEFINED)
+      {
+      pkt->pes_pts = pi->pts;
+      
+      pkt->position = pi->position;
+      
+      /* Don't use this pts for other frames */
+      pi->pts = GAVL_TIME_UNDEFINED;
+      pi->position = -1;
+      }
+    }
+  
+  /* Parse frame (must be done *after* pes_pts is set) */
+  if(!do_parse_frame(p, pkt))
+    return GAVL_SINK_ERROR;
+  
+  if(p->stream_flags & STREAM_RAW_PACKETS)
+    pkt->position = p->raw_position;
+      
+  return gavl_packet_sink_put_packet(p->next, pkt);
+  }
 
 /* Parse frame */
 
@@ -203,30 +282,40 @@ static gavl_sink_status_t sink_put_func_full(void * priv, gavl_packet_t * pkt)
   int skip = 0;
   packet_info_t * pi;
   bgav_packet_parser_t * p = priv;
+  int64_t pts = GAVL_TIME_UNDEFINED;
   
-  /* Append packet */
-  gavl_buffer_append(&p->buf, &pkt->buf);
-
-  if(p->num_packets == p->packets_alloc)
+  if(pkt->pts != GAVL_TIME_UNDEFINED)
+    pts = pkt->pts;
+  else if(pkt->pes_pts != GAVL_TIME_UNDEFINED)
+    pts = pkt->pes_pts;
+  
+  if(p->raw_position < 0)
+    p->raw_position = pkt->position;
+  
+  if(p->packets_start + p->num_packets == p->packets_alloc)
     {
-    p->packets_alloc += 16;
-    p->packets = realloc(p->packets, sizeof(*p->packets) * p->packets_alloc);
-    memset(p->packets + p->num_packets, 0,
-           sizeof(*p->packets) * (p->packets_alloc - p->num_packets));
+    if(p->packets_start)
+      {
+      memmove(p->packets, p->packets + p->packets_start,
+              sizeof(*p->packets) * p->num_packets);
+      p->packets_start = 0;
+      }
+    else
+      {
+      p->packets_alloc += 16;
+      p->packets = realloc(p->packets, sizeof(*p->packets) * p->packets_alloc);
+      }
     }
-  pi = p->packets + p->num_packets;
+  pi = p->packets + p->packets_start + p->num_packets;
   p->num_packets++;
 
-  if(pkt->pts != GAVL_TIME_UNDEFINED)
-    pi->pts = pkt->pts;
-  else if(pkt->pes_pts != GAVL_TIME_UNDEFINED)
-    pi->pts = pkt->pes_pts;
-  
+  memset(pi, 0, sizeof(*pi));
+  pi->pts = pts;
   pi->position = pkt->position;
   pi->size = pkt->buf.len;
-
-  if(p->raw_position < 0)
-    p->raw_position = pkt->position;
+  
+  /* Append packet (this might take over the packet buffer) */
+  parser_append(p, pkt);
   
   /*
    *   Check if we have a chance to find a frame boundary
@@ -247,36 +336,9 @@ static gavl_sink_status_t sink_put_func_full(void * priv, gavl_packet_t * pkt)
       /* Skip undecodeable bytes */
       p->parser_flags |= PARSER_HAS_SYNC;
       }
-    else
-      {
-      /* Get new packet */
-      gavl_packet_t * pkt = gavl_packet_sink_get_packet(p->next);
-      gavl_buffer_append_data_pad(&pkt->buf, p->buf.buf, p->buf.pos, GAVL_PACKET_PADDING);
-      
-      /* Set pts */
-      if(p->packets[0].pts != GAVL_TIME_UNDEFINED)
-        {
-        pkt->pes_pts = p->packets[0].pts;
-
-        pkt->position = p->packets[0].position;
-        
-        /* Don't use this pts for other frames */
-        p->packets[0].pts = GAVL_TIME_UNDEFINED;
-        p->packets[0].position = -1;
-        }
-
-      
-      /* Parse frame (must be done *after* pes_pts is set) */
-      if(!do_parse_frame(p, pkt))
-        {
-        return GAVL_SINK_ERROR;
-        }
-      if(p->stream_flags & STREAM_RAW_PACKETS)
-        pkt->position = p->raw_position;
-      
-      if(gavl_packet_sink_put_packet(p->next, pkt) != GAVL_SINK_OK)
-        return GAVL_SINK_ERROR;
-      }
+    else if(output_frame(p) != GAVL_SINK_OK)
+      return GAVL_SINK_ERROR;
+    
     parser_flush_bytes(p);
     p->buf.pos = skip;
     }
@@ -359,7 +421,7 @@ void bgav_packet_parser_destroy(bgav_packet_parser_t * p)
   if(p->sink)
     gavl_packet_sink_destroy(p->sink);
 
-  gavl_buffer_free(&p->buf);
+  gavl_buffer_free(&p->store);
   gavl_packet_free(&p->in_packet);
 
   gavl_compression_info_free(&p->ci);
@@ -372,40 +434,12 @@ void bgav_packet_parser_destroy(bgav_packet_parser_t * p)
 
 void bgav_packet_parser_flush(bgav_packet_parser_t * p)
   {
-  gavl_packet_t * pkt;
-  
   if(!(p->stream_flags & STREAM_PARSE_FULL) || !p->buf.len)
     return;
   
   /* Output last packet */
-
-  /* Get new packet */
-  pkt = gavl_packet_sink_get_packet(p->next);
-  gavl_buffer_append_data_pad(&pkt->buf, p->buf.buf, p->buf.len, GAVL_PACKET_PADDING);
-      
-  /* Set pts */
-  if(p->packets[0].pts != GAVL_TIME_UNDEFINED)
-    {
-    pkt->pes_pts = p->packets[0].pts;
-
-    pkt->position = p->packets[0].position;
-        
-    /* Don't use this pts for other frames */
-    p->packets[0].pts = GAVL_TIME_UNDEFINED;
-    p->packets[0].position = -1;
-    }
-
-      
-  /* Parse frame (must be done *after* pes_pts is set) */
-  if(!do_parse_frame(p, pkt))
-    return;
-
-  if(p->stream_flags & STREAM_RAW_PACKETS)
-    pkt->position = p->raw_position;
-      
-  if(gavl_packet_sink_put_packet(p->next, pkt) != GAVL_SINK_OK)
-    return;
-  
+  p->buf.pos = p->buf.len;
+  output_frame(p);
   }
 
 /* Call after seeking */
@@ -414,8 +448,12 @@ void bgav_packet_parser_reset(bgav_packet_parser_t * p)
   p->parser_flags &= ~PARSER_HAS_SYNC;
   //  p->timestamp = GAVL_TIME_UNDEFINED;
   p->num_packets = 0;
+  p->packets_start = 0;
   p->raw_position = -1;
-  gavl_buffer_reset(&p->buf);
+  gavl_buffer_reset(&p->store);
+  p->store_start = 0;
+  update_view(p);
+  p->buf.pos = 0;
 
   if(p->sink)
     gavl_packet_sink_reset(p->sink);
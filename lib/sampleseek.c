@@ -146,7 +146,8 @@ void bgav_seek_audio(bgav_t * bgav, int stream, int64_t sample)
   
   bgav_stream_clear(s);
 
-  if(bgav->demuxer->index_mode == INDEX_MODE_PCM)
+  if((bgav->demuxer->index_mode == INDEX_MODE_PCM) ||
+     (bgav->demuxer->index_mode == INDEX_MODE_CONST))
     {
     bgav->demuxer->demuxer->seek(bgav->demuxer, sample,
                                  s->data.audio.format->samplerate);
@@ -214,6 +215,9 @@ void bgav_seek_video(bgav_t * bgav, int stream, int64_t time)
     bgav_superindex_seek(bgav->demuxer->si, s, &frame_time, s->timescale);
     s->out_time = bgav->demuxer->si->entries[s->index_position].pts;
     }
+  else if(bgav->demuxer->index_mode == INDEX_MODE_CONST)
+    bgav->demuxer->demuxer->seek(bgav->demuxer, time,
+                                 s->data.video.format->timescale);
     
   bgav_video_resync(s);
 
@@ -363,6 +367,7 @@ void bgav_check_sample_accurate(bgav_t * b)
   switch(b->demuxer->index_mode)
     {
     case INDEX_MODE_PCM:
+    case INDEX_MODE_CONST:
     case INDEX_MODE_SI_SA:
       if(!(b->input->flags & BGAV_INPUT_CAN_SEEK_BYTE))
         return;
@@ -398,6 +403,7 @@ int bgav_set_sample_accurate(bgav_t * b)
       return 0;
       break;
     case INDEX_MODE_PCM:
+    case INDEX_MODE_CONST:
     case INDEX_MODE_SI_SA:
       if(!(b->input->flags & BGAV_INPUT_CAN_SEEK_BYTE))
         return 0;
@@ -0,0 +1,182 @@
+/*****************************************************************
+ * gmerlin-avdecoder - a general purpose multimedia decoding library
+ *
+ * Copyright (c) 2001 - 2012 Members of the Gmerlin project
+ * gmerlin-general@lists.sourceforge.net
+ * http://gmerlin.sourceforge.net
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * *****************************************************************/
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <avdec_private.h>
+
+typedef struct
+  {
+  bgav_slice_pool_t * p;
+  pthread_t thread;
+  int index;
+  } worker_t;
+
+struct bgav_slice_pool_s
+  {
+  int num_workers;
+  worker_t * workers;
+  
+  pthread_mutex_t mutex;
+  pthread_cond_t start_cond;
+  pthread_cond_t done_cond;
+
+  /* Incremented for each job */
+  int generation;
+  int pending;
+  int quit;
+  
+  bgav_slice_func func;
+  void * data;
+  int num;
+  };
+
+static void run_slice(bgav_slice_pool_t * p, bgav_slice_func func,
+                      void * data, int num, int index)
+  {
+  int start, end;
+
+  start = (int)(((int64_t)num * index) / (p->num_workers + 1));
+  end   = (int)(((int64_t)num * (index+1)) / (p->num_workers + 1));
+
+  if(end > start)
+    func(data, start, end);
+  }
+
+static void * worker_func(void * data)
+  {
+  worker_t * w = data;
+  bgav_slice_pool_t * p = w->p;
+  int generation = 0;
+  
+  bgav_slice_func func;
+  void * func_data;
+  int num;
+  
+  pthread_mutex_lock(&p->mutex);
+  
+  while(1)
+    {
+    while((p->generation == generation) && !p->quit)
+      pthread_cond_wait(&p->start_cond, &p->mutex);
+
+    if(p->quit)
+      break;
+    
+    generation = p->generation;
+    func      = p->func;
+    func_data = p->data;
+    num       = p->num;
+    
+    pthread_mutex_unlock(&p->mutex);
+    
+    run_slice(p, func, func_data, num, w->index);
+    
+    pthread_mutex_lock(&p->mutex);
+    
+    p->pending--;
+    if(!p->pending)
+      pthread_cond_signal(&p->done_cond);
+    }
+  
+  pthread_mutex_unlock(&p->mutex);
+  return NULL;
+  }
+
+bgav_slice_pool_t * bgav_slice_pool_create(int num_threads)
+  {
+  int i;
+  bgav_slice_pool_t * ret;
+  
+  if(num_threads < 2)
+    return NULL;
+  
+  ret = calloc(1, sizeof(*ret));
+  
+  pthread_mutex_init(&ret->mutex, NULL);
+  pthread_cond_init(&ret->start_cond, NULL);
+  pthread_cond_init(&ret->done_cond, NULL);
+
+  /* The calling thread works as well */
+  ret->workers = calloc(num_threads - 1, sizeof(*ret->workers));
+  
+  for(i = 0; i < num_threads - 1; i++)
+    {
+    ret->workers[i].p = ret;
+    ret->workers[i].index = i + 1;
+    
+    if(pthread_create(&ret->workers[i].thread, NULL,
+                      worker_func, &ret->workers[i]))
+      break;
+    ret->num_workers++;
+    }
+
+  if(!ret->num_workers)
+    {
+    bgav_slice_pool_destroy(ret);
+    return NULL;
+    }
+  
+  return ret;
+  }
+
+void bgav_slice_pool_run(bgav_slice_pool_t * p, bgav_slice_func func,
+                         void * data, int num)
+  {
+  pthread_mutex_lock(&p->mutex);
+  
+  p->func    = func;
+  p->data    = data;
+  p->num     = num;
+  p->pending = p->num_workers;
+  p->generation++;
+  
+  pthread_cond_broadcast(&p->start_cond);
+  pthread_mutex_unlock(&p->mutex);
+
+  run_slice(p, func, data, num, 0);
+
+  pthread_mutex_lock(&p->mutex);
+  while(p->pending)
+    pthread_cond_wait(&p->done_cond, &p->mutex);
+  pthread_mutex_unlock(&p->mutex);
+  }
+
+void bgav_slice_pool_destroy(bgav_slice_pool_t * p)
+  {
+  int i;
+  
+  pthread_mutex_lock(&p->mutex);
+  p->quit = 1;
+  pthread_cond_broadcast(&p->start_cond);
+  pthread_mutex_unlock(&p->mutex);
+
+  for(i = 0; i < p->num_workers; i++)
+    pthread_join(p->workers[i].thread, NULL);
+
+  pthread_mutex_destroy(&p->mutex);
+  pthread_cond_destroy(&p->start_cond);
+  pthread_cond_destroy(&p->done_cond);
+  
+  free(p->workers);
+  free(p);
+  }
@@ -0,0 +1,172 @@
+/*****************************************************************
+ * gmerlin-avdecoder - a general purpose multimedia decoding library
+ *
+ * Copyright (c) 2001 - 2012 Members of the Gmerlin project
+ * gmerlin-general@lists.sourceforge.net
+ * http://gmerlin.sourceforge.net
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * *****************************************************************/
+
+/* Performance counters */
+
+#include <string.h>
+#include <time.h>
+
+#include <avdec_private.h>
+
+gavl_time_t bgav_stats_time(void)
+  {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (gavl_time_t)ts.tv_sec * GAVL_TIME_SCALE + ts.tv_nsec / 1000;
+  }
+
+static const char * stream_type_name(gavl_stream_type_t type)
+  {
+  switch(type)
+    {
+    case GAVL_STREAM_AUDIO:
+      return "audio";
+    case GAVL_STREAM_VIDEO:
+      return "video";
+    case GAVL_STREAM_TEXT:
+      return "text";
+    case GAVL_STREAM_OVERLAY:
+      return "overlay";
+    case GAVL_STREAM_MSG:
+      return "msg";
+    case GAVL_STREAM_NONE:
+      break;
+    }
+  return "none";
+  }
+
+static void get_stream_stats(bgav_stream_t * s, int index, gavl_dictionary_t * dict)
+  {
+  gavl_dictionary_set_string(dict, "type", stream_type_name(s->type));
+  gavl_dictionary_set_int(dict, "index", index);
+
+  gavl_dictionary_set_long(dict, "packets",        s->counters.packets);
+  gavl_dictionary_set_long(dict, "bytes",          s->counters.bytes);
+  gavl_dictionary_set_long(dict, "parser_bytes",   s->counters.parser_bytes);
+  gavl_dictionary_set_long(dict, "packets_reused", s->counters.packets_reused);
+  gavl_dictionary_set_long(dict, "packets_new",    s->counters.packets_new);
+  gavl_dictionary_set_long(dict, "frames",         s->counters.frames);
+  gavl_dictionary_set_long(dict, "decode_time",    s->counters.decode_time);
+  }
+
+/* Inputs of the per stream cursors of non-interleaved files */
+
+static bgav_input_context_t * get_cursor_input(bgav_stream_t * s)
+  {
+  if(s->si_cursor && s->si_cursor->own_input)
+    return s->si_cursor->input;
+  else
+    return NULL;
+  }
+
+void bgav_get_stats(bgav_t * b, gavl_dictionary_t * ret)
+  {
+  int i, j;
+  gavl_dictionary_t * dict;
+  gavl_array_t * arr;
+  gavl_value_t val;
+  bgav_track_t * t;
+  bgav_input_counters_t counters;
+  bgav_input_context_t * input;
+  
+  if(b->input)
+    {
+    /* Reads through cloned inputs count for the main input */
+    counters = b->input->counters;
+
+    if(b->tt && (t = b->tt->cur))
+      {
+      for(i = 0; i < t->num_streams; i++)
+        {
+        if((input = get_cursor_input(t->streams[i])))
+          bgav_input_counters_add(&counters, &input->counters);
+        }
+      }
+    
+    dict = gavl_dictionary_get_dictionary_create(ret, "input");
+    gavl_dictionary_set_long(dict, "bytes_read",    counters.bytes_read);
+    gavl_dictionary_set_long(dict, "read_calls",    counters.read_calls);
+    gavl_dictionary_set_long(dict, "read_time",     counters.read_time);
+    gavl_dictionary_set_long(dict, "seeks",         counters.seeks);
+    gavl_dictionary_set_long(dict, "bytes_skipped", counters.bytes_skipped);
+    }
+
+  if(b->demuxer)
+    {
+    dict = gavl_dictionary_get_dictionary_create(ret, "demuxer");
+    gavl_dictionary_set_long(dict, "next_packet_calls", b->demuxer->next_packet_calls);
+    gavl_dictionary_set_long(dict, "next_packet_time",  b->demuxer->next_packet_time);
+    }
+
+  if(!b->tt || !(t = b->tt->cur))
+    return;
+
+  /* Replace the streams from an earlier call */
+  arr = gavl_dictionary_get_array_create(ret, "streams");
+  gavl_array_reset(arr);
+
+  for(i = 0; i < t->num_streams; i++)
+    {
+    /* Index within the streams of the same type */
+    int index = 0;
+
+    for(j = 0; j < i; j++)
+      {
+      if(t->streams[j]->type == t->streams[i]->type)
+        index++;
+      }
+
+    gavl_value_init(&val);
+    dict = gavl_value_set_dictionary(&val);
+    get_stream_stats(t->streams[i], index, dict);
+    gavl_array_splice_val_nocopy(arr, -1, 0, &val);
+    }
+  }
+
+void bgav_reset_stats(bgav_t * b)
+  {
+  int i, j;
+  bgav_track_t * t;
+  bgav_input_context_t * input;
+  
+  if(b->input)
+    memset(&b->input->counters, 0, sizeof(b->input->counters));
+
+  if(b->demuxer)
+    {
+    b->demuxer->next_packet_calls = 0;
+    b->demuxer->next_packet_time = 0;
+    }
+
+  if(!b->tt)
+    return;
+
+  for(i = 0; i < b->tt->num_tracks; i++)
+    {
+    t = b->tt->tracks[i];
+    for(j = 0; j < t->num_streams; j++)
+      {
+      memset(&t->streams[j]->counters, 0, sizeof(t->streams[j]->counters));
+      if((input = get_cursor_input(t->streams[j])))
+        memset(&input->counters, 0, sizeof(input->counters));
+      }
+    }
+  }
@@ -127,7 +127,14 @@ void bgav_stream_stop(bgav_stream_t * s)
 
   bgav_stream_clear(s);
   s->index_position = s->first_index_position;
-  
+
+  /* Close the own input of non-interleaved streams */
+  if(s->si_cursor)
+    {
+    bgav_si_cursor_free(s->si_cursor);
+    free(s->si_cursor);
+    s->si_cursor = NULL;
+    }
   }
 
 static void create_parser(bgav_stream_t * s)
@@ -316,6 +323,12 @@ void bgav_stream_free(bgav_stream_t * s)
   if(s->timecode_table)
     bgav_timecode_table_destroy(s->timecode_table);
 
+  if(s->si_cursor)
+    {
+    bgav_si_cursor_free(s->si_cursor);
+    free(s->si_cursor);
+    }
+
   if(s->parser)
     bgav_packet_parser_destroy(s->parser);
   if(s->pf)
@@ -415,10 +428,21 @@ int bgav_stream_skipto(bgav_stream_t * s, gavl_time_t * time, int scale)
 
 bgav_packet_t * bgav_stream_get_packet_write(bgav_stream_t * s)
   {
+  bgav_packet_t * ret;
   //  if(s->type == GAVL_STREAM_VIDEO)
   //    fprintf(stderr, "bgav_stream_get_packet_write\n");
       
-  return gavl_packet_sink_get_packet(s->psink);
+  ret = gavl_packet_sink_get_packet(s->psink);
+
+  /* Recycled packets still have their memory */
+  if(ret)
+    {
+    if(ret->buf.alloc)
+      s->counters.packets_reused++;
+    else
+      s->counters.packets_new++;
+    }
+  return ret;
   }
 
 void bgav_stream_done_packet_write(bgav_stream_t * s, bgav_packet_t * p)
@@ -430,6 +454,11 @@ void bgav_stream_done_packet_write(bgav_stream_t * s, bgav_packet_t * p)
 
   s->in_position++;
 
+  s->counters.packets++;
+  s->counters.bytes += p->buf.len;
+  if(s->parser)
+    s->counters.parser_bytes += p->buf.len;
+  
   if(!(s->flags & STREAM_WRITE_STARTED))
     {
     bgav_stream_set_timing(s);
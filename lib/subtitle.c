@@ -326,15 +326,6 @@ void bgav_subtitle_stop(bgav_stream_t * s)
   s->data.subtitle.video.vsrc = NULL;
   }
 
-/* Generic seek function for subtitle readers */
-void bgav_subtitle_seek(bgav_demuxer_context_t * ctx, int64_t time, int scale)
-  {
-  bgav_stream_t * s = bgav_track_get_subtitle_stream(ctx->tt->cur, 0);
-  
-  bgav_input_seek(ctx->input, ctx->tt->cur->data_start, SEEK_SET);
-  bgav_subtitle_skipto(s, &time, scale);
-  }
-
 void bgav_subtitle_resync(bgav_stream_t * s)
   {
   /* Nothing to do here */
@@ -0,0 +1,80 @@
+/*****************************************************************
+ * gmerlin-avdecoder - a general purpose multimedia decoding library
+ *
+ * Copyright (c) 2001 - 2012 Members of the Gmerlin project
+ * gmerlin-general@lists.sourceforge.net
+ * http://gmerlin.sourceforge.net
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * *****************************************************************/
+
+/*
+ *  Process wide accounting of decoding threads. Each decoder asks for
+ *  threads when it's initialized and gives them back when it's closed.
+ *  If a limit is set, decoders get fewer threads (but at least one)
+ *  when many of them are open at the same time.
+ */
+
+#include <pthread.h>
+
+#include <avdec_private.h>
+
+static pthread_mutex_t budget_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int thread_limit = 0;
+static int threads_used = 0;
+
+void bgav_set_thread_limit(int num)
+  {
+  pthread_mutex_lock(&budget_mutex);
+  thread_limit = (num > 0) ? num : 0;
+  pthread_mutex_unlock(&budget_mutex);
+  }
+
+int bgav_threads_acquire(const bgav_options_t * opt, int max)
+  {
+  int ret;
+  
+  if(opt->threads > 0)
+    ret = opt->threads;
+  else
+    ret = gavl_num_cpus();
+
+  if((max > 0) && (ret > max))
+    ret = max;
+  
+  pthread_mutex_lock(&budget_mutex);
+
+  if(thread_limit > 0)
+    {
+    if(ret > thread_limit - threads_used)
+      ret = thread_limit - threads_used;
+    }
+  
+  /* The decoding thread itself is always there */
+  if(ret < 1)
+    ret = 1;
+  
+  threads_used += ret;
+  pthread_mutex_unlock(&budget_mutex);
+  return ret;
+  }
+
+void bgav_threads_release(int num)
+  {
+  pthread_mutex_lock(&budget_mutex);
+  threads_used -= num;
+  if(threads_used < 0)
+    threads_used = 0;
+  pthread_mutex_unlock(&budget_mutex);
+  }
@@ -248,6 +248,20 @@ int bgav_video_has_still(bgav_t * bgav, int stream)
   return check_still(s);
   }
 
+static gavl_source_status_t decode_frame(bgav_stream_t * s,
+                                         gavl_video_frame_t * frame)
+  {
+  gavl_source_status_t ret;
+  gavl_time_t t = bgav_stats_time();
+  
+  ret = s->data.video.decoder->decode(s, frame);
+
+  s->counters.decode_time += bgav_stats_time() - t;
+  if(ret == GAVL_SOURCE_OK)
+    s->counters.frames++;
+  return ret;
+  }
+
 static gavl_source_status_t
 read_video_nocopy(void * sp,
                   gavl_video_frame_t ** frame)
@@ -257,7 +271,7 @@ read_video_nocopy(void * sp,
   //  fprintf(stderr, "Read video nocopy\n");
   if(!check_still(s))
     return GAVL_SOURCE_AGAIN;
-  if((st = s->data.video.decoder->decode(sp, NULL)) != GAVL_SOURCE_OK)
+  if((st = decode_frame(s, NULL)) != GAVL_SOURCE_OK)
     {
     // fprintf(stderr, "EOF :)\n");
     if(st == GAVL_SOURCE_EOF)
@@ -284,7 +298,7 @@ static gavl_source_status_t read_video_copy(void * sp,
   
   if(frame)
     {
-    if((st = s->data.video.decoder->decode(sp, *frame)) != GAVL_SOURCE_OK)
+    if((st = decode_frame(s, *frame)) != GAVL_SOURCE_OK)
       {
       if(st == GAVL_SOURCE_EOF)
         gavl_log(GAVL_LOG_INFO, LOG_DOMAIN, "Detected EOF 2");
@@ -294,7 +308,7 @@ static gavl_source_status_t read_video_copy(void * sp,
     }
   else
     {
-    if((st = s->data.video.decoder->decode(sp, NULL)) != GAVL_SOURCE_OK)
+    if((st = decode_frame(s, NULL)) != GAVL_SOURCE_OK)
       {
       if(st == GAVL_SOURCE_EOF)
         gavl_log(GAVL_LOG_INFO, LOG_DOMAIN, "Detected EOF 3");
@@ -600,6 +614,8 @@ int bgav_video_skipto(bgav_stream_t * s, int64_t * time, int scale)
   /* Easy case: Intra only streams */
   if(!(s->ci->flags & GAVL_COMPRESSION_HAS_P_FRAMES))
     {
+    int dropped = 0;
+    
     while(1)
       {
       p = NULL;
@@ -608,12 +624,18 @@ int bgav_video_skipto(bgav_stream_t * s, int64_t * time, int scale)
       
       if(p->pts + p->duration > time_scaled)
         {
+        /* Decoders might have frames from the dropped packets
+           decoded in advance */
+        if(dropped && s->data.video.decoder && s->data.video.decoder->resync)
+          s->data.video.decoder->resync(s);
+        
         s->out_time = p->pts;
         return 1;
         }
       p = NULL;
       bgav_stream_get_packet_read(s, &p);
       bgav_stream_done_packet_read(s, p);
+      dropped = 1;
       }
     *time = gavl_time_rescale(s->data.video.format->timescale, scale, s->out_time);
     return 1;
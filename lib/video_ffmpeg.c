@@ -143,6 +143,8 @@ typedef struct
 
   AVBufferRef * devctx;
 
+  /* Acquired from the thread budget */
+  int num_threads;
 
 #ifdef COUNT_PACKETS
   int packet_count_o;
@@ -688,6 +690,45 @@ static AVCodec * find_decoder(bgav_stream_t * s, enum AVCodecID id)
 
 
 
+/*
+ *  Map the shrink option to what the codec can do:
+ *  DCT based codecs (MJPEG, MPEG-1/2/4, DV, ...) can decode directly into
+ *  a downscaled image. Others (H.264, HEVC, ...) can only save work by
+ *  skipping the loop filter and (for non-reference frames) the IDCT.
+ */
+
+static void init_shrink(bgav_stream_t * s, const AVCodec * codec)
+  {
+  ffmpeg_video_priv * priv = s->decoder_priv;
+  
+  if(codec->max_lowres > 0)
+    {
+    /* Hardware decoders don't support lowres */
+    if(priv->hwctx)
+      return;
+    
+    priv->ctx->lowres = s->opt->shrink;
+    if(priv->ctx->lowres > codec->max_lowres)
+      priv->ctx->lowres = codec->max_lowres;
+
+    gavl_log(GAVL_LOG_INFO, LOG_DOMAIN,
+             "Decoding at 1/%d resolution", 1 << priv->ctx->lowres);
+    }
+  else
+    {
+    if(s->opt->shrink > 1)
+      priv->ctx->skip_loop_filter = AVDISCARD_ALL;
+    else
+      priv->ctx->skip_loop_filter = AVDISCARD_NONREF;
+
+    if(s->opt->shrink > 2)
+      priv->ctx->skip_idct = AVDISCARD_NONREF;
+
+    gavl_log(GAVL_LOG_INFO, LOG_DOMAIN,
+             "Decoding with reduced quality (shrink factor %d)", s->opt->shrink);
+    }
+  }
+
 static int init_ffmpeg(bgav_stream_t * s)
   {
   AVCodec * codec;
@@ -734,7 +775,18 @@ static int init_ffmpeg(bgav_stream_t * s)
   priv->ctx->codec_id = codec->id;
 
   /* Threads (disabled for VAAPI) */
-  priv->ctx->thread_count = gavl_num_cpus();
+  priv->num_threads = bgav_threads_acquire(s->opt, 0);
+  priv->ctx->thread_count = priv->num_threads;
+
+  switch(s->opt->thread_type)
+    {
+    case BGAV_THREAD_TYPE_FRAME:
+      priv->ctx->thread_type = FF_THREAD_FRAME;
+      break;
+    case BGAV_THREAD_TYPE_SLICE:
+      priv->ctx->thread_type = FF_THREAD_SLICE;
+      break;
+    }
   
 #ifdef HAVE_LIBVA
   if(s->opt->vaapi && vaapi_supported(codec) && init_vaapi(s))
@@ -743,6 +795,8 @@ static int init_ffmpeg(bgav_stream_t * s)
 
     
     priv->ctx->thread_count = 1;
+    bgav_threads_release(priv->num_threads - 1);
+    priv->num_threads = 1;
     }
 #endif
 
@@ -836,6 +890,10 @@ static int init_ffmpeg(bgav_stream_t * s)
   priv->ctx->error_concealment = 3;
   
   //  priv->ctx->error_resilience = 3;
+
+  /* Preview quality */
+  if(s->opt->shrink > 0)
+    init_shrink(s, codec);
   
   /* Open this thing */
 
@@ -848,10 +906,6 @@ static int init_ffmpeg(bgav_stream_t * s)
     }
   bgav_ffmpeg_unlock();
   
-  //  priv->ctx->skip_frame = AVDISCARD_NONREF;
-  //  priv->ctx->skip_loop_filter = AVDISCARD_ALL;
-  //  priv->ctx->skip_idct = AVDISCARD_ALL;
-  
   /* Set missing format values */
   
   priv->flags |= NEED_FORMAT;
@@ -863,7 +917,32 @@ static int init_ffmpeg(bgav_stream_t * s)
     return 0;
     }
 
-     
+  /* The decoder downscaled the image: Frame size is from the decoder,
+     the image size (crop) is scaled. The pixel aspect ratio stays the same. */
+  if(priv->ctx->lowres)
+    {
+    gavl_video_format_t * fmt = s->data.video.format;
+    
+    if(fmt->image_width && fmt->image_height)
+      {
+      fmt->image_width  = AV_CEIL_RSHIFT(fmt->image_width,  priv->ctx->lowres);
+      fmt->image_height = AV_CEIL_RSHIFT(fmt->image_height, priv->ctx->lowres);
+      }
+    else
+      {
+      fmt->image_width  = priv->ctx->width;
+      fmt->image_height = priv->ctx->height;
+      }
+    
+    fmt->frame_width  = priv->ctx->width;
+    fmt->frame_height = priv->ctx->height;
+
+    if(fmt->image_width > fmt->frame_width)
+      fmt->image_width = fmt->frame_width;
+    if(fmt->image_height > fmt->frame_height)
+      fmt->image_height = fmt->frame_height;
+    }
+  
   get_format(priv->ctx, s->data.video.format);
 
   priv->flags &= ~NEED_FORMAT;
@@ -951,6 +1030,8 @@ static void close_ffmpeg(bgav_stream_t * s)
     bgav_ffmpeg_unlock();
     av_free(priv->ctx);
     }
+  if(priv->num_threads)
+    bgav_threads_release(priv->num_threads);
   if(priv->gavl_frame)
     {
     gavl_video_frame_null(priv->gavl_frame);
@@ -2246,7 +2327,16 @@ static void init_put_frame(bgav_stream_t * s)
     }
   }
 
-/* Global locking */
+/*
+ *  Global locking
+ *
+ *  Since 58.9.100, libavcodec serializes the initialization of non thread-safe
+ *  codecs internally (and av_lockmgr_register() is deprecated). Opening and closing
+ *  codecs doesn't need our lock anymore then, so opening many files in parallel
+ *  doesn't queue up here.
+ */
+
+#if LIBAVCODEC_VERSION_INT < ((58<<16)|(9<<8)|100)
 
 static pthread_mutex_t ffmpeg_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -2260,3 +2350,15 @@ void bgav_ffmpeg_unlock()
   pthread_mutex_unlock(&ffmpeg_mutex);
   }
 
+#else
+
+void bgav_ffmpeg_lock()
+  {
+  }
+
+void bgav_ffmpeg_unlock()
+  {
+  }
+
+#endif
+
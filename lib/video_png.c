@@ -32,23 +32,172 @@
 
 #define LOG_DOMAIN "video_png"
 
+/*
+ *  Since all frames are independent, we can decode several
+ *  packets in parallel. The frames are decoded into our own buffers
+ *  and handed out in order without copying (s->vframe).
+ */
+
+#define MAX_THREADS 4
+
 typedef struct
   {
   bgav_png_reader_t * png_reader;
   int have_header;
   gavl_video_format_t format;
+
+  /* Frame parallel decoding */
+  bgav_slice_pool_t * pool;
+  int num_threads;
+  
+  bgav_png_reader_t * readers[MAX_THREADS];
+  gavl_video_frame_t * frames[MAX_THREADS];
+  gavl_video_format_t formats[MAX_THREADS]; /* Formats of frames[] */
+  bgav_packet_t packets[MAX_THREADS];
+  int ok[MAX_THREADS];
+
+  /* For images with a different size than the stream */
+  gavl_video_frame_t * out_frame;
+  
+  int num_decoded;
+  int decoded_pos;
   } png_priv_t;
 
 // static int frame_counter = 0;
 
+static void decode_slice(void * data, int start, int end)
+  {
+  int i;
+  png_priv_t * priv = data;
+
+  for(i = start; i < end; i++)
+    {
+    if(priv->ok[i])
+      priv->ok[i] = bgav_png_reader_read_image(priv->readers[i], priv->frames[i]);
+    }
+  }
+
+/* Read the header of a packet and make sure, the frame is large enough */
+
+static int prepare_slot(png_priv_t * priv, int i)
+  {
+  gavl_video_format_t format;
+
+  gavl_video_format_copy(&format, &priv->format);
+  
+  if(!bgav_png_reader_read_header(priv->readers[i],
+                                  priv->packets[i].buf.buf, priv->packets[i].buf.len,
+                                  &format))
+    return 0;
+
+  if(format.pixelformat != priv->format.pixelformat)
+    {
+    gavl_log(GAVL_LOG_ERROR, LOG_DOMAIN, "Pixelformat changed from %s to %s",
+             gavl_pixelformat_to_string(priv->format.pixelformat),
+             gavl_pixelformat_to_string(format.pixelformat));
+    bgav_png_reader_reset(priv->readers[i]);
+    return 0;
+    }
+  
+  if((format.frame_width != priv->formats[i].frame_width) ||
+     (format.frame_height != priv->formats[i].frame_height))
+    {
+    gavl_video_frame_destroy(priv->frames[i]);
+    priv->frames[i] = gavl_video_frame_create(&format);
+    gavl_video_format_copy(&priv->formats[i], &format);
+    }
+  return 1;
+  }
+
+/* Read up to num_threads packets and decode them at once */
+
+static gavl_source_status_t decode_parallel(bgav_stream_t * s)
+  {
+  int i;
+  bgav_packet_t * p;
+  gavl_buffer_t buf;
+  gavl_source_status_t st;
+  png_priv_t * priv = s->decoder_priv;
+  
+  for(i = 0; i < priv->num_threads; i++)
+    {
+    p = NULL;
+    if((st = bgav_stream_get_packet_read(s, &p)) != GAVL_SOURCE_OK)
+      {
+      if(!i)
+        return st;
+      break;
+      }
+
+    /* Take over the packet data */
+    bgav_packet_copy_metadata(&priv->packets[i], p);
+    priv->packets[i].dst_x = p->dst_x;
+    priv->packets[i].dst_y = p->dst_y;
+    gavl_rectangle_i_copy(&priv->packets[i].src_rect, &p->src_rect);
+    
+    buf = priv->packets[i].buf;
+    priv->packets[i].buf = p->buf;
+    p->buf = buf;
+    gavl_buffer_reset(&p->buf);
+    
+    bgav_stream_done_packet_read(s, p);
+
+    priv->ok[i] = prepare_slot(priv, i);
+    }
+  
+  priv->num_decoded = i;
+  priv->decoded_pos = 0;
+  
+  bgav_slice_pool_run(priv->pool, decode_slice, priv, priv->num_decoded);
+  return GAVL_SOURCE_OK;
+  }
+
 static gavl_source_status_t
 decode_png(bgav_stream_t * s, gavl_video_frame_t * frame)
   {
   png_priv_t * priv;
   bgav_packet_t * p = NULL;
   gavl_source_status_t st;
+  int idx;
   
   priv = s->decoder_priv;
+
+  /* Frame parallel mode: We always decode, frame is NULL */
+  if(priv->pool)
+    {
+    if((priv->decoded_pos >= priv->num_decoded) &&
+       ((st = decode_parallel(s)) != GAVL_SOURCE_OK))
+      return st;
+
+    idx = priv->decoded_pos++;
+    
+    if(!priv->ok[idx])
+      return GAVL_SOURCE_EOF;
+
+    if((priv->formats[idx].frame_width != priv->format.frame_width) ||
+       (priv->formats[idx].frame_height != priv->format.frame_height))
+      {
+      gavl_video_format_t format;
+
+      /* Copy the overlapping area */
+      gavl_video_format_copy(&format, &priv->format);
+      if(format.image_width > priv->formats[idx].image_width)
+        format.image_width = priv->formats[idx].image_width;
+      if(format.image_height > priv->formats[idx].image_height)
+        format.image_height = priv->formats[idx].image_height;
+      
+      gavl_video_frame_clear(priv->out_frame, &priv->format);
+      gavl_video_frame_copy(&format, priv->out_frame, priv->frames[idx]);
+      s->vframe = priv->out_frame;
+      }
+    else
+      s->vframe = priv->frames[idx];
+    
+    bgav_set_video_frame_from_packet(&priv->packets[idx], s->vframe);
+    s->vframe->src_rect.w = priv->format.image_width;
+    s->vframe->src_rect.h = priv->format.image_height;
+    return GAVL_SOURCE_OK;
+    }
   
   if((st = bgav_stream_get_packet_read(s, &p)) != GAVL_SOURCE_OK)
     return st;
@@ -80,6 +229,37 @@ decode_png(bgav_stream_t * s, gavl_video_frame_t * frame)
   return GAVL_SOURCE_OK;
   }
 
+/* Get the stream format from the first packet and allocate the frames */
+
+static int init_parallel(bgav_stream_t * s)
+  {
+  int i;
+  bgav_packet_t * p = NULL;
+  png_priv_t * priv = s->decoder_priv;
+
+  if((bgav_stream_peek_packet_read(s, &p) != GAVL_SOURCE_OK) ||
+     !bgav_png_reader_read_header(priv->png_reader,
+                                  p->buf.buf, p->buf.len,
+                                  s->data.video.format))
+    return 0;
+  
+  bgav_png_reader_reset(priv->png_reader);
+  gavl_video_format_copy(&priv->format, s->data.video.format);
+  
+  for(i = 0; i < priv->num_threads; i++)
+    {
+    priv->readers[i] = bgav_png_reader_create();
+    gavl_packet_init(&priv->packets[i]);
+    priv->frames[i] = gavl_video_frame_create(&priv->format);
+    gavl_video_format_copy(&priv->formats[i], &priv->format);
+    }
+  priv->out_frame = gavl_video_frame_create(&priv->format);
+
+  /* Makes the video source use our frames */
+  s->vframe = priv->frames[0];
+  return 1;
+  }
+
 static int init_png(bgav_stream_t * s)
   {
   png_priv_t * priv;
@@ -88,15 +268,45 @@ static int init_png(bgav_stream_t * s)
   s->decoder_priv = priv;
   
   priv->png_reader = bgav_png_reader_create();
+
+  priv->num_threads = bgav_threads_acquire(s->opt, MAX_THREADS);
+
+  if((priv->pool = bgav_slice_pool_create(priv->num_threads)) &&
+     !init_parallel(s))
+    {
+    /* Decode serially */
+    bgav_slice_pool_destroy(priv->pool);
+    priv->pool = NULL;
+    bgav_threads_release(priv->num_threads - 1);
+    priv->num_threads = 1;
+    }
+  
   gavl_dictionary_set_string(s->m, GAVL_META_FORMAT, "PNG");
   return 1;
   }
 
 static void close_png(bgav_stream_t * s)
   {
+  int i;
   png_priv_t * priv = s->decoder_priv;
   if(priv->png_reader)
     bgav_png_reader_destroy(priv->png_reader);
+
+  bgav_threads_release(priv->num_threads);
+
+  if(priv->pool)
+    {
+    bgav_slice_pool_destroy(priv->pool);
+
+    for(i = 0; i < priv->num_threads; i++)
+      {
+      bgav_png_reader_destroy(priv->readers[i]);
+      gavl_packet_free(&priv->packets[i]);
+      gavl_video_frame_destroy(priv->frames[i]);
+      }
+    gavl_video_frame_destroy(priv->out_frame);
+    }
+  
   free(priv);
   }
 
@@ -106,6 +316,10 @@ static void resync_png(bgav_stream_t * s)
   priv = s->decoder_priv;
   bgav_png_reader_reset(priv->png_reader);
   priv->have_header = 0;
+
+  /* Drop frames decoded in advance */
+  priv->num_decoded = 0;
+  priv->decoded_pos = 0;
   }
 
 static bgav_video_decoder_t decoder =
@@ -116,7 +330,6 @@ static bgav_video_decoder_t decoder =
     .decode = decode_png,
     .resync = resync_png,
     .close =  close_png,
-    .resync = NULL,
   };
 
 void bgav_init_video_decoders_png()
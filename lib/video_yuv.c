@@ -28,13 +28,32 @@
 #include <avdec_private.h>
 #include <codecs.h>
 
+#ifdef BGAV_HAVE_SSSE3
+#include <tmmintrin.h>
+#endif
+
 #define PAD(size, bytes) ((((size)+bytes-1)/bytes)*bytes)
 
+/* Images at least this large are converted by multiple threads */
+#define SLICE_MIN_PIXELS (1280*720)
+
+/* Maximum number of threads for the conversion */
+#define SLICE_MAX_THREADS 4
+
 typedef struct
   {
   gavl_video_frame_t * frame;
   bgav_packet_t * p;
   void (*decode_func)(bgav_stream_t * s, bgav_packet_t * p, gavl_video_frame_t * f);
+
+  /* For the converting decoders: Convert rows (or row groups)
+     start..end-1 from frame into f */
+  void (*rows_func)(bgav_stream_t * s, gavl_video_frame_t * f, int start, int end);
+  int num_rows;
+  bgav_slice_pool_t * pool;
+  int num_threads;
+  
+  int ssse3;
   } yuv_priv_t;
 
 /* Common initialization */
@@ -45,39 +64,151 @@ static void init_common(bgav_stream_t * s)
   priv = calloc(1, sizeof(*priv));
   s->decoder_priv = priv;
   priv->frame = gavl_video_frame_create(NULL);
+#ifdef BGAV_HAVE_SSSE3
+  if(gavl_accel_supported() & GAVL_ACCEL_SSSE3)
+    priv->ssse3 = 1;
+#endif
+  }
+
+/* Converting decoders: Split the rows into slices for large images */
+
+typedef struct
+  {
+  bgav_stream_t * s;
+  gavl_video_frame_t * f;
+  } slice_t;
+
+static void slice_func(void * data, int start, int end)
+  {
+  slice_t * sl = data;
+  yuv_priv_t * priv = sl->s->decoder_priv;
+  priv->rows_func(sl->s, sl->f, start, end);
+  }
+
+static void decode_rows(bgav_stream_t * s, bgav_packet_t * p, gavl_video_frame_t * f)
+  {
+  slice_t sl;
+  yuv_priv_t * priv;
+  priv = s->decoder_priv;
+  
+  priv->frame->planes[0] = p->buf.buf;
+
+  /* Skipped frame */
+  if(!f)
+    return;
+  
+  if(priv->pool)
+    {
+    sl.s = s;
+    sl.f = f;
+    bgav_slice_pool_run(priv->pool, slice_func, &sl, priv->num_rows);
+    }
+  else
+    priv->rows_func(s, f, 0, priv->num_rows);
+  }
+
+static void init_rows(bgav_stream_t * s,
+                      void (*rows_func)(bgav_stream_t * s, gavl_video_frame_t * f, int start, int end),
+                      int num_rows)
+  {
+  yuv_priv_t * priv;
+  priv = s->decoder_priv;
+
+  priv->rows_func = rows_func;
+  priv->num_rows = num_rows;
+  priv->decode_func = decode_rows;
+  
+  if(s->data.video.format->image_width *
+     s->data.video.format->image_height < SLICE_MIN_PIXELS)
+    return;
+  
+  priv->num_threads = bgav_threads_acquire(s->opt, SLICE_MAX_THREADS);
+  priv->pool = bgav_slice_pool_create(priv->num_threads);
   }
 
 /* Decoding functions */
 
 /* yuv2: It's yuyv with signedness swapped and JPEG scaled */
 
-static void decode_yuv2(bgav_stream_t * s, bgav_packet_t * p, gavl_video_frame_t * f)
+static void decode_line_yuv2_c(const uint8_t * src, uint8_t * dst_y,
+                               uint8_t * dst_u, uint8_t * dst_v, int width)
   {
-  int i, j;
-  uint8_t * src, *dst_y, *dst_u, *dst_v;
+  int j;
+  
+  for(j = 0; j < width/2; j++)
+    {
+    dst_y[0] = src[0];        /* Y */
+    dst_u[0] = src[1] ^ 0x80; /* U */
+    dst_y[1] = src[2];        /* Y */
+    dst_v[0] = src[3] ^ 0x80; /* V */
+    src+=4;
+    dst_y+=2;
+    dst_u++;
+    dst_v++;
+    }
+  }
+
+#ifdef BGAV_HAVE_SSSE3
+
+/* 16 pixels per iteration */
+
+BGAV_SSSE3_FUNC
+static void decode_line_yuv2_ssse3(const uint8_t * src, uint8_t * dst_y,
+                                   uint8_t * dst_u, uint8_t * dst_v, int width)
+  {
+  const __m128i mask_y = _mm_setr_epi8(0,2,4,6,8,10,12,14,-1,-1,-1,-1,-1,-1,-1,-1);
+  const __m128i mask_u = _mm_setr_epi8(1,5,9,13,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1);
+  const __m128i mask_v = _mm_setr_epi8(3,7,11,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1);
+  const __m128i sign   = _mm_set1_epi8(0x80);
+  
+  while(width >= 16)
+    {
+    __m128i in0 = _mm_loadu_si128((const __m128i*)src);
+    __m128i in1 = _mm_loadu_si128((const __m128i*)(src + 16));
+
+    _mm_storeu_si128((__m128i*)dst_y,
+                     _mm_unpacklo_epi64(_mm_shuffle_epi8(in0, mask_y),
+                                        _mm_shuffle_epi8(in1, mask_y)));
+    _mm_storel_epi64((__m128i*)dst_u,
+                     _mm_xor_si128(_mm_unpacklo_epi32(_mm_shuffle_epi8(in0, mask_u),
+                                                      _mm_shuffle_epi8(in1, mask_u)), sign));
+    _mm_storel_epi64((__m128i*)dst_v,
+                     _mm_xor_si128(_mm_unpacklo_epi32(_mm_shuffle_epi8(in0, mask_v),
+                                                      _mm_shuffle_epi8(in1, mask_v)), sign));
+    src += 32;
+    dst_y += 16;
+    dst_u += 8;
+    dst_v += 8;
+    width -= 16;
+    }
+  decode_line_yuv2_c(src, dst_y, dst_u, dst_v, width);
+  }
+#endif
+
+static void rows_yuv2(bgav_stream_t * s, gavl_video_frame_t * f, int start, int end)
+  {
+  int i;
   yuv_priv_t * priv;
   priv = s->decoder_priv;
 
-  priv->frame->planes[0] = p->buf.buf;
-  
-  for(i = 0; i < s->data.video.format->image_height; i++)
+  for(i = start; i < end; i++)
     {
-    src = priv->frame->planes[0] + i * priv->frame->strides[0];
-    dst_y = f->planes[0]         + i * f->strides[0];
-    dst_u = f->planes[1]         + i * f->strides[1];
-    dst_v = f->planes[2]         + i * f->strides[2];
-    
-    for(j = 0; j < s->data.video.format->image_width/2; j++)
+#ifdef BGAV_HAVE_SSSE3
+    if(priv->ssse3)
       {
-      dst_y[0] = src[0];        /* Y */
-      dst_u[0] = src[1] ^ 0x80; /* U */
-      dst_y[1] = src[2];        /* Y */
-      dst_v[0] = src[3] ^ 0x80; /* V */
-      src+=4;
-      dst_y+=2;
-      dst_u++;
-      dst_v++;
+      decode_line_yuv2_ssse3(priv->frame->planes[0] + i * priv->frame->strides[0],
+                             f->planes[0] + i * f->strides[0],
+                             f->planes[1] + i * f->strides[1],
+                             f->planes[2] + i * f->strides[2],
+                             s->data.video.format->image_width);
+      continue;
       }
+#endif
+    decode_line_yuv2_c(priv->frame->planes[0] + i * priv->frame->strides[0],
+                       f->planes[0] + i * f->strides[0],
+                       f->planes[1] + i * f->strides[1],
+                       f->planes[2] + i * f->strides[2],
+                       s->data.video.format->image_width);
     }
   }
 
@@ -93,7 +224,7 @@ static int init_yuv2(bgav_stream_t * s)
   priv = s->decoder_priv;
 
   priv->frame->strides[0] = PAD(s->data.video.format->image_width * 2, 4);
-  priv->decode_func = decode_yuv2;
+  init_rows(s, rows_yuv2, s->data.video.format->image_height);
   s->data.video.format->pixelformat = GAVL_YUVJ_422_P;
   return 1;
   }
@@ -137,16 +268,14 @@ static const uint8_t decode_alpha_v408[256] =
 };
 
 
-static void decode_v408(bgav_stream_t * s, bgav_packet_t * p, gavl_video_frame_t * f)
+static void rows_v408(bgav_stream_t * s, gavl_video_frame_t * f, int start, int end)
   {
   int i, j;
   uint8_t * src, *dst;
   yuv_priv_t * priv;
   priv = s->decoder_priv;
 
-  priv->frame->planes[0] = p->buf.buf;
-  
-  for(i = 0; i < s->data.video.format->image_height; i++)
+  for(i = start; i < end; i++)
     {
     src = priv->frame->planes[0] + i * priv->frame->strides[0];
     dst = f->planes[0]         + i * f->strides[0];
@@ -175,7 +304,7 @@ static int init_v408(bgav_stream_t * s)
   priv = s->decoder_priv;
 
   priv->frame->strides[0] = s->data.video.format->image_width * 4;
-  priv->decode_func = decode_v408;
+  init_rows(s, rows_v408, s->data.video.format->image_height);
   s->data.video.format->pixelformat = GAVL_YUVA_32;
   return 1;
   }
@@ -276,6 +405,8 @@ static int init_yv12(bgav_stream_t * s)
   return 1;
   }
 
+/* Like yv12 but we just point the chroma planes the other way round */
+
 static void decode_YV12(bgav_stream_t * s, bgav_packet_t * p, gavl_video_frame_t * f)
   {
   yuv_priv_t * priv;
@@ -284,7 +415,6 @@ static void decode_YV12(bgav_stream_t * s, bgav_packet_t * p, gavl_video_frame_t
   priv->frame->planes[0] = p->buf.buf;
   priv->frame->planes[2] = priv->frame->planes[0] + s->data.video.format->image_height * priv->frame->strides[0];
   priv->frame->planes[1] = priv->frame->planes[2] + s->data.video.format->image_height/2 * priv->frame->strides[1];
-  gavl_video_frame_copy(s->data.video.format, f, priv->frame);
   }
 
 static int init_YV12(bgav_stream_t * s)
@@ -304,6 +434,7 @@ static int init_YV12(bgav_stream_t * s)
   
   priv->decode_func = decode_YV12;
   s->data.video.format->pixelformat = GAVL_YUV_420_P;
+  s->vframe = priv->frame;
   return 1;
   }
 
@@ -345,35 +476,94 @@ static int init_YVU9(bgav_stream_t * s)
 
 /* v308: Packed YUV 4:4:4, we make this planar */
 
-static void decode_v308(bgav_stream_t * s, bgav_packet_t * p, gavl_video_frame_t * f)
+static void decode_line_v308_c(const uint8_t * src, uint8_t * dst_y,
+                               uint8_t * dst_u, uint8_t * dst_v, int width)
   {
-  int i, j;
-  uint8_t * src, *dst_y, *dst_u, *dst_v;
-  yuv_priv_t * priv;
-  priv = s->decoder_priv;
+  int j;
+  for(j = 0; j < width; j++)
+    {
+    *dst_y = src[1];
+    *dst_u = src[2];
+    *dst_v = src[0];
+      
+    src+=3;
+    dst_y++;
+    dst_u++;
+    dst_v++;
+    }
+  }
 
-  priv->frame->planes[0] = p->buf.buf;
+#ifdef BGAV_HAVE_SSSE3
+
+/* 16 pixels (48 bytes) per iteration */
+
+BGAV_SSSE3_FUNC
+static inline __m128i v308_gather(__m128i in0, __m128i in1, __m128i in2,
+                                  __m128i m0, __m128i m1, __m128i m2)
+  {
+  return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(in0, m0),
+                                   _mm_shuffle_epi8(in1, m1)),
+                      _mm_shuffle_epi8(in2, m2));
+  }
+
+BGAV_SSSE3_FUNC
+static void decode_line_v308_ssse3(const uint8_t * src, uint8_t * dst_y,
+                                   uint8_t * dst_u, uint8_t * dst_v, int width)
+  {
+  const __m128i y0 = _mm_setr_epi8(1,4,7,10,13,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1);
+  const __m128i y1 = _mm_setr_epi8(-1,-1,-1,-1,-1,0,3,6,9,12,15,-1,-1,-1,-1,-1);
+  const __m128i y2 = _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,2,5,8,11,14);
+  const __m128i u0 = _mm_setr_epi8(2,5,8,11,14,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1);
+  const __m128i u1 = _mm_setr_epi8(-1,-1,-1,-1,-1,1,4,7,10,13,-1,-1,-1,-1,-1,-1);
+  const __m128i u2 = _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,0,3,6,9,12,15);
+  const __m128i v0 = _mm_setr_epi8(0,3,6,9,12,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1);
+  const __m128i v1 = _mm_setr_epi8(-1,-1,-1,-1,-1,-1,2,5,8,11,14,-1,-1,-1,-1,-1);
+  const __m128i v2 = _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,1,4,7,10,13);
   
-  for(i = 0; i < s->data.video.format->image_height; i++)
+  while(width >= 16)
     {
-    src = priv->frame->planes[0] + i * priv->frame->strides[0];
+    __m128i in0 = _mm_loadu_si128((const __m128i*)src);
+    __m128i in1 = _mm_loadu_si128((const __m128i*)(src + 16));
+    __m128i in2 = _mm_loadu_si128((const __m128i*)(src + 32));
 
-    dst_y = f->planes[0] + i * f->strides[0];
-    dst_u = f->planes[1] + i * f->strides[1];
-    dst_v = f->planes[2] + i * f->strides[2];
+    _mm_storeu_si128((__m128i*)dst_y, v308_gather(in0, in1, in2, y0, y1, y2));
+    _mm_storeu_si128((__m128i*)dst_u, v308_gather(in0, in1, in2, u0, u1, u2));
+    _mm_storeu_si128((__m128i*)dst_v, v308_gather(in0, in1, in2, v0, v1, v2));
     
-    for(j = 0; j < s->data.video.format->image_width; j++)
+    src += 48;
+    dst_y += 16;
+    dst_u += 16;
+    dst_v += 16;
+    width -= 16;
+    }
+  decode_line_v308_c(src, dst_y, dst_u, dst_v, width);
+  }
+#endif
+
+static void rows_v308(bgav_stream_t * s, gavl_video_frame_t * f, int start, int end)
+  {
+  int i;
+  yuv_priv_t * priv;
+  priv = s->decoder_priv;
+
+  for(i = start; i < end; i++)
+    {
+#ifdef BGAV_HAVE_SSSE3
+    if(priv->ssse3)
       {
-      *dst_y = src[1];
-      *dst_u = src[2];
-      *dst_v = src[0];
-      
-      src+=3;
-      dst_y++;
-      dst_u++;
-      dst_v++;
-      
+      decode_line_v308_ssse3(priv->frame->planes[0] + i * priv->frame->strides[0],
+                             f->planes[0] + i * f->strides[0],
+                             f->planes[1] + i * f->strides[1],
+                             f->planes[2] + i * f->strides[2],
+                             s->data.video.format->image_width);
+      continue;
       }
+#endif
+    decode_line_v308_c(priv->frame->planes[0] + i * priv->frame->strides[0],
+                       f->planes[0] + i * f->strides[0],
+                       f->planes[1] + i * f->strides[1],
+                       f->planes[2] + i * f->strides[2],
+                       s->data.video.format->image_width);
     }
   }
 
@@ -389,7 +579,7 @@ static int init_v308(bgav_stream_t * s)
   priv = s->decoder_priv;
 
   priv->frame->strides[0] = s->data.video.format->image_width * 3;
-  priv->decode_func = decode_v308;
+  init_rows(s, rows_v308, s->data.video.format->image_height);
   s->data.video.format->pixelformat = GAVL_YUV_444_P;
   return 1;
   }
@@ -399,35 +589,90 @@ static int init_v308(bgav_stream_t * s)
  *  we make this planar
  */
 
-static void decode_v410(bgav_stream_t * s, bgav_packet_t * p, gavl_video_frame_t * f)
+static void decode_line_v410_c(const uint8_t * src, uint16_t * dst_y,
+                               uint16_t * dst_u, uint16_t * dst_v, int width)
   {
-  int i, j;
-  uint8_t * src;
-  uint16_t *dst_y, *dst_u, *dst_v;
+  int j;
   uint32_t src_i;
-  yuv_priv_t * priv;
-  priv = s->decoder_priv;
+  
+  for(j = 0; j < width; j++)
+    {
+    src_i = GAVL_PTR_2_32LE(src);
 
-  priv->frame->planes[0] = p->buf.buf;
+    *(dst_v++) = (src_i & 0xffc00000) >> 16; /* V */
+    *(dst_y++) = (src_i & 0x3ff000) >> 6;    /* Y */
+    *(dst_u++) = (src_i & 0xffc) << 4;       /* U */
+      
+    src+=4;
+    }
+  }
+
+#ifdef BGAV_HAVE_SSSE3
+
+/* 8 pixels (32 bytes) per iteration */
+
+BGAV_SSSE3_FUNC
+static inline __m128i v410_pack(__m128i a, __m128i b)
+  {
+  /* Low 16 bits of each 32 bit word */
+  const __m128i mask = _mm_setr_epi8(0,1,4,5,8,9,12,13,-1,-1,-1,-1,-1,-1,-1,-1);
+  return _mm_unpacklo_epi64(_mm_shuffle_epi8(a, mask), _mm_shuffle_epi8(b, mask));
+  }
+
+BGAV_SSSE3_FUNC
+static void decode_line_v410_ssse3(const uint8_t * src, uint16_t * dst_y,
+                                   uint16_t * dst_u, uint16_t * dst_v, int width)
+  {
+  const __m128i mask = _mm_set1_epi32(0xffc0);
   
-  for(i = 0; i < s->data.video.format->image_height; i++)
+  while(width >= 8)
     {
-    src = priv->frame->planes[0] + i * priv->frame->strides[0];
+    __m128i in0 = _mm_loadu_si128((const __m128i*)src);
+    __m128i in1 = _mm_loadu_si128((const __m128i*)(src + 16));
+
+    _mm_storeu_si128((__m128i*)dst_v,
+                     v410_pack(_mm_and_si128(_mm_srli_epi32(in0, 16), mask),
+                               _mm_and_si128(_mm_srli_epi32(in1, 16), mask)));
+    _mm_storeu_si128((__m128i*)dst_y,
+                     v410_pack(_mm_and_si128(_mm_srli_epi32(in0, 6), mask),
+                               _mm_and_si128(_mm_srli_epi32(in1, 6), mask)));
+    _mm_storeu_si128((__m128i*)dst_u,
+                     v410_pack(_mm_and_si128(_mm_slli_epi32(in0, 4), mask),
+                               _mm_and_si128(_mm_slli_epi32(in1, 4), mask)));
+    src += 32;
+    dst_y += 8;
+    dst_u += 8;
+    dst_v += 8;
+    width -= 8;
+    }
+  decode_line_v410_c(src, dst_y, dst_u, dst_v, width);
+  }
+#endif
 
-    dst_y = (uint16_t*)(f->planes[0] + i * f->strides[0]);
-    dst_u = (uint16_t*)(f->planes[1] + i * f->strides[1]);
-    dst_v = (uint16_t*)(f->planes[2] + i * f->strides[2]);
-    
-    for(j = 0; j < s->data.video.format->image_width; j++)
-      {
-      src_i = GAVL_PTR_2_32LE(src);
+static void rows_v410(bgav_stream_t * s, gavl_video_frame_t * f, int start, int end)
+  {
+  int i;
+  yuv_priv_t * priv;
+  priv = s->decoder_priv;
 
-      *(dst_v++) = (src_i & 0xffc00000) >> 16; /* V */
-      *(dst_y++) = (src_i & 0x3ff000) >> 6;    /* Y */
-      *(dst_u++) = (src_i & 0xffc) << 4;       /* U */
-      
-      src+=4;
+  for(i = start; i < end; i++)
+    {
+#ifdef BGAV_HAVE_SSSE3
+    if(priv->ssse3)
+      {
+      decode_line_v410_ssse3(priv->frame->planes[0] + i * priv->frame->strides[0],
+                             (uint16_t*)(f->planes[0] + i * f->strides[0]),
+                             (uint16_t*)(f->planes[1] + i * f->strides[1]),
+                             (uint16_t*)(f->planes[2] + i * f->strides[2]),
+                             s->data.video.format->image_width);
+      continue;
       }
+#endif
+    decode_line_v410_c(priv->frame->planes[0] + i * priv->frame->strides[0],
+                       (uint16_t*)(f->planes[0] + i * f->strides[0]),
+                       (uint16_t*)(f->planes[1] + i * f->strides[1]),
+                       (uint16_t*)(f->planes[2] + i * f->strides[2]),
+                       s->data.video.format->image_width);
     }
   }
 
@@ -443,7 +688,7 @@ static int init_v410(bgav_stream_t * s)
   priv = s->decoder_priv;
 
   priv->frame->strides[0] = s->data.video.format->image_width * 4;
-  priv->decode_func = decode_v410;
+  init_rows(s, rows_v410, s->data.video.format->image_height);
   s->data.video.format->pixelformat = GAVL_YUV_444_P_16;
   return 1;
   }
@@ -453,71 +698,154 @@ static int init_v410(bgav_stream_t * s)
  *  we make this planar
  */
 
-static void decode_v210(bgav_stream_t * s, bgav_packet_t * p, gavl_video_frame_t * f)
+static void decode_line_v210_c(const uint8_t * src, uint16_t * dst_y,
+                               uint16_t * dst_u, uint16_t * dst_v, int width)
   {
-  int i, j;
-  uint8_t * src;
-  uint16_t *dst_y, *dst_u, *dst_v;
+  int j;
   uint32_t i1, i2, i3, i4;
-  yuv_priv_t * priv;
-  priv = s->decoder_priv;
-
-  priv->frame->planes[0] = p->buf.buf;
   
-  for(i = 0; i < s->data.video.format->image_height; i++)
+  for(j = 0; j < width/6; j++)
     {
-    src = priv->frame->planes[0] + i * priv->frame->strides[0];
+    i1 = GAVL_PTR_2_32LE(src);src+=4;
+    i2 = GAVL_PTR_2_32LE(src);src+=4;
+    i3 = GAVL_PTR_2_32LE(src);src+=4;
+    i4 = GAVL_PTR_2_32LE(src);src+=4;
 
-    dst_y = (uint16_t*)(f->planes[0] + i * f->strides[0]);
-    dst_u = (uint16_t*)(f->planes[1] + i * f->strides[1]);
-    dst_v = (uint16_t*)(f->planes[2] + i * f->strides[2]);
-    
-    for(j = 0; j < s->data.video.format->image_width/6; j++)
-      {
-      i1 = GAVL_PTR_2_32LE(src);src+=4;
-      i2 = GAVL_PTR_2_32LE(src);src+=4;
-      i3 = GAVL_PTR_2_32LE(src);src+=4;
-      i4 = GAVL_PTR_2_32LE(src);src+=4;
-
-      /* These are grouped to show the "pixel pairs" of  4:2:2 */
+    /* These are grouped to show the "pixel pairs" of  4:2:2 */
+      
+    *(dst_u++) = (i1 & 0x3ff) << 6;       /* Cb0 */
+    *(dst_y++) = (i1 & 0xffc00) >> 4;     /* Y0 */
+    *(dst_v++) = (i1 & 0x3ff00000) >> 14; /* Cr0 */
+    *(dst_y++) = (i2 & 0x3ff) << 6;       /* Y1 */
       
-      *(dst_u++) = (i1 & 0x3ff) << 6;       /* Cb0 */
-      *(dst_y++) = (i1 & 0xffc00) >> 4;     /* Y0 */
-      *(dst_v++) = (i1 & 0x3ff00000) >> 14; /* Cr0 */
-      *(dst_y++) = (i2 & 0x3ff) << 6;       /* Y1 */
+    *(dst_u++) = (i2 & 0xffc00) >> 4;     /* Cb1 */
+    *(dst_y++) = (i2 & 0x3ff00000) >> 14; /* Y2 */
+    *(dst_v++) = (i3 & 0x3ff) << 6;       /* Cr1 */
+    *(dst_y++) = (i3 & 0xffc00) >> 4;     /* Y3 */
       
+    *(dst_u++) = (i3 & 0x3ff00000) >> 14; /* Cb2 */
+    *(dst_y++) = (i4 & 0x3ff) << 6;       /* Y4 */
+    *(dst_v++) = (i4 & 0xffc00) >> 4;     /* Cr2 */
+    *(dst_y++) = (i4 & 0x3ff00000) >> 14; /* Y5 */
+    }
+
+  /* Handle the 2 or 4 pixels possibly remaining */
+  j = (width - ((width / 6) * 6));
+  if (j != 0)
+    {
+    i1 = GAVL_PTR_2_32LE(src);src+=4;
+    i2 = GAVL_PTR_2_32LE(src);src+=4;
+    i3 = GAVL_PTR_2_32LE(src);src+=4;
+    i4 = GAVL_PTR_2_32LE(src);src+=4;
+
+    *(dst_u++) = (i1 & 0x3ff) << 6;       /* Cb0 */
+    *(dst_y++) = (i1 & 0xffc00) >> 4;     /* Y0 */
+    *(dst_v++) = (i1 & 0x3ff00000) >> 14; /* Cr0 */
+    *(dst_y++) = (i2 & 0x3ff) << 6;       /* Y1 */
+    if (j == 4)
+      {
       *(dst_u++) = (i2 & 0xffc00) >> 4;     /* Cb1 */
       *(dst_y++) = (i2 & 0x3ff00000) >> 14; /* Y2 */
       *(dst_v++) = (i3 & 0x3ff) << 6;       /* Cr1 */
       *(dst_y++) = (i3 & 0xffc00) >> 4;     /* Y3 */
-      
-      *(dst_u++) = (i3 & 0x3ff00000) >> 14; /* Cb2 */
-      *(dst_y++) = (i4 & 0x3ff) << 6;       /* Y4 */
-      *(dst_v++) = (i4 & 0xffc00) >> 4;     /* Cr2 */
-      *(dst_y++) = (i4 & 0x3ff00000) >> 14; /* Y5 */
       }
+    }
+  }
+
+#ifdef BGAV_HAVE_SSSE3
+
+/*
+ *  Each 32 bit word contains 3 components a, b, c. We make 16 bit words
+ *  [a0 b0 a1 b1 a2 b2 a3 b3] and [c0 0 c1 0 c2 0 c3 0] and shuffle them
+ *  into Y [b0 a1 c1 b2 a3 c3] and U [a0 b1 c2] V [c0 a2 b3]
+ */
+
+BGAV_SSSE3_FUNC
+static inline void v210_group(__m128i in, __m128i * y, __m128i * uv)
+  {
+  const __m128i ab_y  = _mm_setr_epi8( 2, 3, 4, 5,-1,-1,10,11,12,13,-1,-1,-1,-1,-1,-1);
+  const __m128i c_y   = _mm_setr_epi8(-1,-1,-1,-1, 4, 5,-1,-1,-1,-1,12,13,-1,-1,-1,-1);
+  /* U in words 0..2, V in words 4..6 */
+  const __m128i ab_uv = _mm_setr_epi8( 0, 1, 6, 7,-1,-1,-1,-1,-1,-1, 8, 9,14,15,-1,-1);
+  const __m128i c_uv  = _mm_setr_epi8(-1,-1,-1,-1, 8, 9,-1,-1, 0, 1,-1,-1,-1,-1,-1,-1);
+  
+  __m128i ab = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(in, 6),
+                                          _mm_set1_epi32(0x0000ffc0)),
+                            _mm_and_si128(_mm_slli_epi32(in, 12),
+                                          _mm_set1_epi32(0xffc00000)));
+  __m128i c = _mm_and_si128(_mm_srli_epi32(in, 14), _mm_set1_epi32(0xffc0));
+
+  *y  = _mm_or_si128(_mm_shuffle_epi8(ab, ab_y),  _mm_shuffle_epi8(c, c_y));
+  *uv = _mm_or_si128(_mm_shuffle_epi8(ab, ab_uv), _mm_shuffle_epi8(c, c_uv));
+  }
+
+/* 12 pixels (32 bytes) per iteration */
+
+BGAV_SSSE3_FUNC
+static void decode_line_v210_ssse3(const uint8_t * src, uint16_t * dst_y,
+                                   uint16_t * dst_u, uint16_t * dst_v, int width)
+  {
+  __m128i y0, y1, uv0, uv1, u, v;
+  int32_t tmp;
+  const __m128i mask_lo = _mm_setr_epi32(-1, 0x0000ffff, 0, 0); /* Words 0..2 */
+  const __m128i mask_hi = _mm_setr_epi32(0, 0xffff0000, -1, 0); /* Words 3..5 */
 
-    /* Handle the 2 or 4 pixels possibly remaining */
-    j = (s->data.video.format->image_width - ((s->data.video.format->image_width / 6) * 6));
-    if (j != 0)
+  while(width >= 12)
+    {
+    v210_group(_mm_loadu_si128((const __m128i*)src), &y0, &uv0);
+    v210_group(_mm_loadu_si128((const __m128i*)(src + 16)), &y1, &uv1);
+
+    /* Y: 6 + 2 words, then 4 words */
+    _mm_storeu_si128((__m128i*)dst_y, _mm_or_si128(y0, _mm_slli_si128(y1, 12)));
+    _mm_storel_epi64((__m128i*)(dst_y + 8), _mm_srli_si128(y1, 4));
+
+    u = _mm_or_si128(_mm_and_si128(uv0, mask_lo),
+                     _mm_and_si128(_mm_slli_si128(uv1, 6), mask_hi));
+    v = _mm_or_si128(_mm_and_si128(_mm_srli_si128(uv0, 8), mask_lo),
+                     _mm_and_si128(_mm_srli_si128(uv1, 2), mask_hi));
+
+    /* U, V: 6 words each */
+    _mm_storel_epi64((__m128i*)dst_u, u);
+    tmp = _mm_cvtsi128_si32(_mm_srli_si128(u, 8));
+    memcpy(dst_u + 4, &tmp, 4);
+    _mm_storel_epi64((__m128i*)dst_v, v);
+    tmp = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    memcpy(dst_v + 4, &tmp, 4);
+    
+    src += 32;
+    dst_y += 12;
+    dst_u += 6;
+    dst_v += 6;
+    width -= 12;
+    }
+  decode_line_v210_c(src, dst_y, dst_u, dst_v, width);
+  }
+#endif
+
+static void rows_v210(bgav_stream_t * s, gavl_video_frame_t * f, int start, int end)
+  {
+  int i;
+  yuv_priv_t * priv;
+  priv = s->decoder_priv;
+  
+  for(i = start; i < end; i++)
+    {
+#ifdef BGAV_HAVE_SSSE3
+    if(priv->ssse3)
       {
-      i1 = GAVL_PTR_2_32LE(src);src+=4;
-      i2 = GAVL_PTR_2_32LE(src);src+=4;
-      i3 = GAVL_PTR_2_32LE(src);src+=4;
-      i4 = GAVL_PTR_2_32LE(src);src+=4;
-
-      *(dst_u++) = (i1 & 0x3ff) << 6;       /* Cb0 */
-      *(dst_y++) = (i1 & 0xffc00) >> 4;     /* Y0 */
-      *(dst_v++) = (i1 & 0x3ff00000) >> 14; /* Cr0 */
-      *(dst_y++) = (i2 & 0x3ff) << 6;       /* Y1 */
-      if (j == 4)
-        {
-        *(dst_u++) = (i2 & 0xffc00) >> 4;     /* Cb1 */
-        *(dst_y++) = (i2 & 0x3ff00000) >> 14; /* Y2 */
-        *(dst_v++) = (i3 & 0x3ff) << 6;       /* Cr1 */
-        *(dst_y++) = (i3 & 0xffc00) >> 4;     /* Y3 */
-        }
+      decode_line_v210_ssse3(priv->frame->planes[0] + i * priv->frame->strides[0],
+                             (uint16_t*)(f->planes[0] + i * f->strides[0]),
+                             (uint16_t*)(f->planes[1] + i * f->strides[1]),
+                             (uint16_t*)(f->planes[2] + i * f->strides[2]),
+                             s->data.video.format->image_width);
+      continue;
       }
+#endif
+    decode_line_v210_c(priv->frame->planes[0] + i * priv->frame->strides[0],
+                       (uint16_t*)(f->planes[0] + i * f->strides[0]),
+                       (uint16_t*)(f->planes[1] + i * f->strides[1]),
+                       (uint16_t*)(f->planes[2] + i * f->strides[2]),
+                       s->data.video.format->image_width);
     }
   }
 
@@ -533,7 +861,7 @@ static int init_v210(bgav_stream_t * s)
   priv = s->decoder_priv;
 
   priv->frame->strides[0] = (PAD(s->data.video.format->image_width, 48) * 8) / 3;
-  priv->decode_func = decode_v210;
+  init_rows(s, rows_v210, s->data.video.format->image_height);
   s->data.video.format->pixelformat = GAVL_YUV_422_P_16;
   return 1;
   }
@@ -545,18 +873,16 @@ static int init_v210(bgav_stream_t * s)
  *  qt4l/lqt universe :-)
  */
 
-static void decode_yuv4(bgav_stream_t * s, bgav_packet_t * p, gavl_video_frame_t * f)
+static void rows_yuv4(bgav_stream_t * s, gavl_video_frame_t * f, int start, int end)
   {
   int i, j;
   uint8_t * src, *dst_y, *dst_u, *dst_v;
   yuv_priv_t * priv;
   priv = s->decoder_priv;
 
-  priv->frame->planes[0] = p->buf.buf;
-
   /* Packing order for one macropixel is U0V0Y0Y1Y2Y3 */
 
-  for(i = 0; i < s->data.video.format->image_height/2; i++)
+  for(i = start; i < end; i++)
     {
     src = priv->frame->planes[0] + i * priv->frame->strides[0];
     dst_y = f->planes[0] + 2 * i * f->strides[0];
@@ -595,7 +921,7 @@ static int init_yuv4(bgav_stream_t * s)
   priv = s->decoder_priv;
 
   priv->frame->strides[0] = PAD(s->data.video.format->image_width, 2) * 3;
-  priv->decode_func = decode_yuv4;
+  init_rows(s, rows_yuv4, s->data.video.format->image_height/2);
   s->data.video.format->pixelformat = GAVL_YUV_420_P;
   return 1;
   }
@@ -650,6 +976,11 @@ static void close(bgav_stream_t * s)
   yuv_priv_t * priv;
   priv = s->decoder_priv;
 
+  if(priv->pool)
+    bgav_slice_pool_destroy(priv->pool);
+  if(priv->num_threads)
+    bgav_threads_release(priv->num_threads);
+  
   gavl_video_frame_null(priv->frame);
   gavl_video_frame_destroy(priv->frame);
   
@@ -301,6 +301,20 @@ supported encodings."),
       .val_default = GAVL_VALUE_INIT_INT(20),
       .help_string = TRS("Set the maximum total size of the cache directory."),
     },
+    {
+      .name =        "mpegts_all_programs",
+      .long_name =   TRS("Open all transport stream programs as one track"),
+      .type =        BG_PARAMETER_CHECKBUTTON,
+      .val_default = GAVL_VALUE_INIT_INT(0),
+      .help_string = TRS("Put the streams of all programs of an MPEG transport stream into one track. This allows decoding several programs while reading the file only once."),
+    },
+    {
+      .name =        "image_sequence",
+      .long_name =   TRS("Open numbered images as video"),
+      .type =        BG_PARAMETER_CHECKBUTTON,
+      .val_default = GAVL_VALUE_INIT_INT(0),
+      .help_string = TRS("Open a local image file, which is followed by files with consecutive numbers (e.g. frame_0001.png, frame_0002.png), as a video stream."),
+    },
     { /* End of parameters */ }
   };
 
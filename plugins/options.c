@@ -131,6 +131,14 @@ bg_avdec_option_set_parameter(bgav_options_t * opt, const char * name,
     {
     bgav_options_set_cache_time(opt, val->v.i);
     }
+  else if(!strcmp(name, "image_sequence"))
+    {
+    bgav_options_set_image_sequence(opt, val->v.i);
+    }
+  else if(!strcmp(name, "mpegts_all_programs"))
+    {
+    bgav_options_set_mpegts_all_programs(opt, val->v.i);
+    }
   else if(!strcmp(name, "dv_datetime"))
     {
     bgav_options_set_dv_datetime(opt, val->v.i);
@@ -151,4 +159,17 @@ bg_avdec_option_set_parameter(bgav_options_t * opt, const char * name,
     {
     bgav_options_set_threads(opt, val->v.i);
     }
+  else if(!strcmp(name, "thread_type"))
+    {
+    if(!strcmp(val->v.str, "frame"))
+      bgav_options_set_thread_type(opt, BGAV_THREAD_TYPE_FRAME);
+    else if(!strcmp(val->v.str, "slice"))
+      bgav_options_set_thread_type(opt, BGAV_THREAD_TYPE_SLICE);
+    else
+      bgav_options_set_thread_type(opt, BGAV_THREAD_TYPE_AUTO);
+    }
+  else if(!strcmp(name, "thread_limit"))
+    {
+    bgav_set_thread_limit(val->v.i);
+    }
   }
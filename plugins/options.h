@@ -48,10 +48,28 @@
   .name = "threads",    \
   .long_name = TRS("Number of decoding threads"),         \
   .type = BG_PARAMETER_INT,           \
-  .val_default = GAVL_VALUE_INIT_INT(1),              \
-  .val_min =     GAVL_VALUE_INIT_INT(1),              \
+  .val_default = GAVL_VALUE_INIT_INT(0),              \
+  .val_min =     GAVL_VALUE_INIT_INT(0),              \
   .val_max = GAVL_VALUE_INIT_INT(1024),              \
-  .help_string = TRS("Set the number of threads used by Video codecs") \
+  .help_string = TRS("Set the number of threads used by Video codecs. 0 means one thread per CPU.") \
+  },                   \
+  {                    \
+  .name = "thread_type",    \
+  .long_name = TRS("Threading method"),         \
+  .type = BG_PARAMETER_STRINGLIST,           \
+  .val_default = GAVL_VALUE_INIT_STRING("auto"),              \
+  .multi_names =  (char const *[]){ "auto", "frame", "slice", NULL }, \
+  .multi_labels = (char const *[]){ TRS("Auto"), TRS("Frame"), TRS("Slice"), NULL }, \
+  .help_string = TRS("Frame threading is faster but adds latency. Slice threading works only for some codecs.") \
+  },                   \
+  {                    \
+  .name = "thread_limit",    \
+  .long_name = TRS("Maximum decoding threads (global)"),         \
+  .type = BG_PARAMETER_INT,           \
+  .val_default = GAVL_VALUE_INIT_INT(0),              \
+  .val_min =     GAVL_VALUE_INIT_INT(0),              \
+  .val_max = GAVL_VALUE_INIT_INT(4096),              \
+  .help_string = TRS("Limit the number of decoding threads of all decoders in this process. 0 means unlimited.") \
   }
 
 #define PARAM_VIDEO_GENERIC \
@@ -64,7 +82,7 @@
     .val_min     = GAVL_VALUE_INIT_INT(0), \
     .val_max     = GAVL_VALUE_INIT_INT(3), \
     .val_default = GAVL_VALUE_INIT_INT(0), \
-    .help_string = TRS("This enables downscaling of images while decoding. Currently only supported for JPEG-2000."), \
+    .help_string = TRS("This enables downscaling of images while decoding (e.g. for previews). Supported for JPEG-2000, MJPEG, MPEG-1/2/4 and DV. Other codecs like H.264 decode with reduced quality instead."), \
   }, \
   {  \
     .name      =  "vaapi",                  \
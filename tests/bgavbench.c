@@ -0,0 +1,771 @@
+/*****************************************************************
+ * gmerlin-avdecoder - a general purpose multimedia decoding library
+ *
+ * Copyright (c) 2001 - 2012 Members of the Gmerlin project
+ * gmerlin-general@lists.sourceforge.net
+ * http://gmerlin.sourceforge.net
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * *****************************************************************/
+
+/*
+ *  Benchmark for a list of files. For each file we measure
+ *
+ *  - Open and probe latency
+ *  - Demultiplexing throughput (compressed packets of all streams)
+ *  - Decoding speed of each audio and video stream
+ *  - Latency of random and sequential seeks
+ *
+ *  The results are written as JSON so they can be compared across
+ *  library versions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avdec.h>
+#include <bgav_version.h>
+
+#include <gavl/log.h>
+
+#define MAX_DEPTH 16
+
+#define AUDIO_SAMPLES 4096
+
+static int track = 0;
+static int num_seeks = 20;
+static unsigned int seed = 1;
+static gavl_time_t max_decode_time = GAVL_TIME_UNDEFINED;
+
+static gavl_timer_t * timer;
+
+/* Minimal JSON writer */
+
+typedef struct
+  {
+  FILE * out;
+  int depth;
+  int first[MAX_DEPTH];
+  } json_t;
+
+static void json_indent(json_t * j)
+  {
+  int i;
+  for(i = 0; i < j->depth; i++)
+    fprintf(j->out, "  ");
+  }
+
+static void json_key(json_t * j, const char * key)
+  {
+  if(!j->first[j->depth])
+    fprintf(j->out, ",\n");
+  else if(j->depth)
+    fprintf(j->out, "\n");
+
+  j->first[j->depth] = 0;
+  json_indent(j);
+
+  if(key)
+    fprintf(j->out, "\"%s\": ", key);
+  }
+
+static void json_string_value(json_t * j, const char * str)
+  {
+  fputc('"', j->out);
+  while(*str)
+    {
+    if((*str == '"') || (*str == '\\'))
+      fprintf(j->out, "\\%c", *str);
+    else if((unsigned char)(*str) < 0x20)
+      fprintf(j->out, "\\u%04x", (unsigned char)(*str));
+    else
+      fputc(*str, j->out);
+    str++;
+    }
+  fputc('"', j->out);
+  }
+
+static void json_begin(json_t * j, const char * key, char c)
+  {
+  json_key(j, key);
+  fputc(c, j->out);
+  j->depth++;
+  j->first[j->depth] = 1;
+  }
+
+static void json_end(json_t * j, char c)
+  {
+  j->depth--;
+  fprintf(j->out, "\n");
+  json_indent(j);
+  fputc(c, j->out);
+  }
+
+static void json_begin_object(json_t * j, const char * key)
+  {
+  json_begin(j, key, '{');
+  }
+
+static void json_end_object(json_t * j)
+  {
+  json_end(j, '}');
+  }
+
+static void json_begin_array(json_t * j, const char * key)
+  {
+  json_begin(j, key, '[');
+  }
+
+static void json_end_array(json_t * j)
+  {
+  json_end(j, ']');
+  }
+
+static void json_string(json_t * j, const char * key, const char * val)
+  {
+  json_key(j, key);
+  json_string_value(j, val);
+  }
+
+static void json_int(json_t * j, const char * key, int64_t val)
+  {
+  json_key(j, key);
+  fprintf(j->out, "%"PRId64, val);
+  }
+
+static void json_double(json_t * j, const char * key, double val)
+  {
+  json_key(j, key);
+  fprintf(j->out, "%.6g", val);
+  }
+
+/* Timing */
+
+static double get_ms(void)
+  {
+  return gavl_time_to_seconds(gavl_timer_get(timer)) * 1000.0;
+  }
+
+static int compare_double(const void * p1, const void * p2)
+  {
+  const double * d1 = p1;
+  const double * d2 = p2;
+
+  if(*d1 < *d2)
+    return -1;
+  else if(*d1 > *d2)
+    return 1;
+  return 0;
+  }
+
+/* Write min, max, mean and percentiles of num latencies (in ms) */
+
+static void json_distribution(json_t * j, const char * key,
+                              double * v, int num)
+  {
+  int i;
+  double sum = 0.0;
+
+  json_begin_object(j, key);
+  json_int(j, "count", num);
+
+  if(num)
+    {
+    qsort(v, num, sizeof(*v), compare_double);
+
+    for(i = 0; i < num; i++)
+      sum += v[i];
+
+    json_double(j, "min_ms",    v[0]);
+    json_double(j, "mean_ms",   sum / num);
+    json_double(j, "median_ms", v[num/2]);
+    json_double(j, "p90_ms",    v[(num*9)/10]);
+    json_double(j, "max_ms",    v[num-1]);
+    }
+  json_end_object(j);
+  }
+
+/* Open a file and select the track. */
+
+static bgav_t * open_file(const char * filename,
+                          double * open_ms, double * select_ms)
+  {
+  bgav_t * b;
+  double t;
+
+  b = bgav_create();
+
+  t = get_ms();
+  if(!bgav_open(b, filename))
+    {
+    fprintf(stderr, "Could not open file %s\n", filename);
+    bgav_close(b);
+    return NULL;
+    }
+  if(open_ms)
+    *open_ms = get_ms() - t;
+
+  if((track < 0) || (track >= bgav_num_tracks(b)))
+    {
+    fprintf(stderr, "No such track %d in %s\n", track+1, filename);
+    bgav_close(b);
+    return NULL;
+    }
+
+  t = get_ms();
+  bgav_select_track(b, track);
+  if(select_ms)
+    *select_ms = get_ms() - t;
+
+  return b;
+  }
+
+/* Demultiplexing */
+
+typedef struct
+  {
+  int active;
+  int timescale;
+  int64_t time;
+
+  int64_t packets;
+  int64_t bytes;
+  } demux_stream_t;
+
+static void bench_demux(json_t * j, const char * filename)
+  {
+  bgav_t * b;
+  int i, num_audio, num_video, num, active = 0, min_index;
+  double t, start_ms, seconds;
+  demux_stream_t * streams;
+  gavl_compression_info_t ci;
+  gavl_packet_t p;
+  gavl_time_t test_time, min_time;
+  int64_t packets = 0, bytes = 0;
+  int result;
+
+  if(!(b = open_file(filename, NULL, NULL)))
+    return;
+
+  num_audio = bgav_num_audio_streams(b, track);
+  num_video = bgav_num_video_streams(b, track);
+  num = num_audio + num_video;
+
+  streams = calloc(num, sizeof(*streams));
+
+  /* Audio streams come first */
+
+  for(i = 0; i < num_audio; i++)
+    {
+    memset(&ci, 0, sizeof(ci));
+    if(bgav_get_audio_compression_info(b, i, &ci))
+      {
+      bgav_set_audio_stream(b, i, BGAV_STREAM_READRAW);
+      streams[i].active = 1;
+      active++;
+      }
+    gavl_compression_info_free(&ci);
+    }
+  for(i = 0; i < num_video; i++)
+    {
+    memset(&ci, 0, sizeof(ci));
+    if(bgav_get_video_compression_info(b, i, &ci))
+      {
+      bgav_set_video_stream(b, i, BGAV_STREAM_READRAW);
+      streams[num_audio + i].active = 1;
+      active++;
+      }
+    gavl_compression_info_free(&ci);
+    }
+
+  json_begin_object(j, "demux");
+  json_int(j, "streams", active);
+
+  if(!active)
+    goto end;
+
+  t = get_ms();
+  if(!bgav_start(b))
+    {
+    fprintf(stderr, "Starting %s failed\n", filename);
+    goto end;
+    }
+  start_ms = get_ms() - t;
+
+  for(i = 0; i < num_audio; i++)
+    {
+    if(streams[i].active)
+      streams[i].timescale = bgav_get_audio_format(b, i)->samplerate;
+    }
+  for(i = 0; i < num_video; i++)
+    {
+    if(streams[num_audio + i].active)
+      streams[num_audio + i].timescale =
+        bgav_get_video_format(b, i)->timescale;
+    }
+
+  memset(&p, 0, sizeof(p));
+
+  t = get_ms();
+
+  while(active)
+    {
+    /* Read from the stream with the smallest time like a muxer would */
+    min_index = -1;
+    min_time = GAVL_TIME_UNDEFINED;
+
+    for(i = 0; i < num; i++)
+      {
+      if(!streams[i].active)
+        continue;
+      test_time = gavl_time_unscale(streams[i].timescale, streams[i].time);
+      if((min_index < 0) || (test_time < min_time))
+        {
+        min_index = i;
+        min_time = test_time;
+        }
+      }
+
+    if(min_index < num_audio)
+      result = bgav_read_audio_packet(b, min_index, &p);
+    else
+      result = bgav_read_video_packet(b, min_index - num_audio, &p);
+
+    if(!result)
+      {
+      streams[min_index].active = 0;
+      active--;
+      continue;
+      }
+
+    streams[min_index].packets++;
+    streams[min_index].bytes += p.buf.len;
+
+    if(p.pts != GAVL_TIME_UNDEFINED)
+      streams[min_index].time = p.pts + p.duration;
+    else
+      streams[min_index].time += p.duration;
+    }
+
+  seconds = (get_ms() - t) / 1000.0;
+
+  for(i = 0; i < num; i++)
+    {
+    packets += streams[i].packets;
+    bytes += streams[i].bytes;
+    }
+
+  json_double(j, "start_ms", start_ms);
+  json_double(j, "seconds", seconds);
+  json_int(j, "packets", packets);
+  json_int(j, "bytes", bytes);
+
+  if(seconds > 0.0)
+    {
+    json_double(j, "packets_per_s", packets / seconds);
+    json_double(j, "mib_per_s", bytes / seconds / (1024.0 * 1024.0));
+    }
+
+  gavl_packet_free(&p);
+
+  end:
+
+  json_end_object(j);
+  free(streams);
+  bgav_close(b);
+  }
+
+/* Decoding */
+
+static void bench_decode_audio(json_t * j, const char * filename, int stream)
+  {
+  bgav_t * b;
+  double t, seconds;
+  gavl_audio_format_t format;
+  gavl_audio_frame_t * frame;
+  int64_t samples = 0;
+  int result;
+
+  if(!(b = open_file(filename, NULL, NULL)))
+    return;
+
+  bgav_set_audio_stream(b, stream, BGAV_STREAM_DECODE);
+
+  if(!bgav_start(b))
+    {
+    bgav_close(b);
+    return;
+    }
+
+  gavl_audio_format_copy(&format, bgav_get_audio_format(b, stream));
+  format.samples_per_frame = AUDIO_SAMPLES;
+  frame = gavl_audio_frame_create(&format);
+
+  t = get_ms();
+
+  while((result = bgav_read_audio(b, frame, stream, AUDIO_SAMPLES)))
+    {
+    samples += result;
+
+    if((max_decode_time != GAVL_TIME_UNDEFINED) &&
+       (get_ms() - t) * 1000 > max_decode_time)
+      break;
+    }
+
+  seconds = (get_ms() - t) / 1000.0;
+
+  json_begin_object(j, NULL);
+  json_string(j, "type", "audio");
+  json_int(j, "index", stream);
+  json_int(j, "samplerate", format.samplerate);
+  json_int(j, "num_channels", format.num_channels);
+  json_int(j, "samples", samples);
+  json_double(j, "seconds", seconds);
+
+  if(seconds > 0.0)
+    {
+    json_double(j, "samples_per_s", samples / seconds);
+    json_double(j, "realtime_factor",
+                (double)samples / format.samplerate / seconds);
+    }
+  json_end_object(j);
+
+  gavl_audio_frame_destroy(frame);
+  bgav_close(b);
+  }
+
+static void bench_decode_video(json_t * j, const char * filename, int stream)
+  {
+  bgav_t * b;
+  double t, seconds;
+  gavl_video_format_t format;
+  gavl_video_frame_t * frame;
+  int64_t frames = 0;
+  int64_t first_pts = GAVL_TIME_UNDEFINED;
+  int64_t end_pts = GAVL_TIME_UNDEFINED;
+
+  if(!(b = open_file(filename, NULL, NULL)))
+    return;
+
+  bgav_set_video_stream(b, stream, BGAV_STREAM_DECODE);
+
+  if(!bgav_start(b))
+    {
+    bgav_close(b);
+    return;
+    }
+
+  gavl_video_format_copy(&format, bgav_get_video_format(b, stream));
+  frame = gavl_video_frame_create(&format);
+
+  t = get_ms();
+
+  while(bgav_read_video(b, frame, stream))
+    {
+    if(first_pts == GAVL_TIME_UNDEFINED)
+      first_pts = frame->timestamp;
+    end_pts = frame->timestamp + frame->duration;
+    frames++;
+
+    if((max_decode_time != GAVL_TIME_UNDEFINED) &&
+       (get_ms() - t) * 1000 > max_decode_time)
+      break;
+    }
+
+  seconds = (get_ms() - t) / 1000.0;
+
+  json_begin_object(j, NULL);
+  json_string(j, "type", "video");
+  json_int(j, "index", stream);
+  json_int(j, "width", format.image_width);
+  json_int(j, "height", format.image_height);
+  json_int(j, "frames", frames);
+  json_double(j, "seconds", seconds);
+
+  if(seconds > 0.0)
+    {
+    json_double(j, "fps", frames / seconds);
+    if(first_pts != GAVL_TIME_UNDEFINED)
+      json_double(j, "realtime_factor",
+                  (double)(end_pts - first_pts) / format.timescale / seconds);
+    }
+  json_end_object(j);
+
+  gavl_video_frame_destroy(frame);
+  bgav_close(b);
+  }
+
+/* Seeking */
+
+static void bench_seek(json_t * j, const char * filename)
+  {
+  bgav_t * b;
+  int i, video;
+  double t;
+  double * random_ms = NULL;
+  double * sequential_ms = NULL;
+  int num_random = 0, num_sequential = 0;
+  gavl_time_t duration, time;
+  gavl_audio_format_t afmt;
+  gavl_audio_frame_t * aframe = NULL;
+  gavl_video_frame_t * vframe = NULL;
+
+  if(!(b = open_file(filename, NULL, NULL)))
+    return;
+
+  json_begin_object(j, "seek");
+
+  duration = bgav_get_duration(b, track);
+
+  if(!bgav_can_seek(b) || (duration == GAVL_TIME_UNDEFINED) ||
+     (duration <= 0) || (num_seeks <= 0))
+    {
+    json_int(j, "supported", 0);
+    goto end;
+    }
+
+  /* Measure up to the first decoded frame of the first video
+     (or audio) stream */
+
+  if(bgav_num_video_streams(b, track))
+    {
+    video = 1;
+    bgav_set_video_stream(b, 0, BGAV_STREAM_DECODE);
+    }
+  else if(bgav_num_audio_streams(b, track))
+    {
+    video = 0;
+    bgav_set_audio_stream(b, 0, BGAV_STREAM_DECODE);
+    }
+  else
+    {
+    json_int(j, "supported", 0);
+    goto end;
+    }
+
+  if(!bgav_start(b))
+    {
+    json_int(j, "supported", 0);
+    goto end;
+    }
+
+  json_int(j, "supported", 1);
+  json_string(j, "stream", video ? "video" : "audio");
+
+  if(video)
+    vframe = gavl_video_frame_create(bgav_get_video_format(b, 0));
+  else
+    {
+    gavl_audio_format_copy(&afmt, bgav_get_audio_format(b, 0));
+    afmt.samples_per_frame = AUDIO_SAMPLES;
+    aframe = gavl_audio_frame_create(&afmt);
+    }
+
+  random_ms = calloc(num_seeks, sizeof(*random_ms));
+  sequential_ms = calloc(num_seeks, sizeof(*sequential_ms));
+
+  srand(seed);
+
+  for(i = 0; i < 2 * num_seeks; i++)
+    {
+    /* First random, then sequential (forward) seeks */
+    if(i < num_seeks)
+      time = (gavl_time_t)((double)rand() / RAND_MAX * duration);
+    else
+      time = (duration * (i - num_seeks + 1)) / (num_seeks + 1);
+
+    t = get_ms();
+
+    bgav_seek(b, &time);
+
+    if(video)
+      {
+      if(!bgav_read_video(b, vframe, 0))
+        continue;
+      }
+    else
+      {
+      if(!bgav_read_audio(b, aframe, 0, AUDIO_SAMPLES))
+        continue;
+      }
+
+    if(i < num_seeks)
+      random_ms[num_random++] = get_ms() - t;
+    else
+      sequential_ms[num_sequential++] = get_ms() - t;
+    }
+
+  json_distribution(j, "random", random_ms, num_random);
+  json_distribution(j, "sequential", sequential_ms, num_sequential);
+
+  end:
+  json_end_object(j);
+
+  if(random_ms)
+    free(random_ms);
+  if(sequential_ms)
+    free(sequential_ms);
+  if(vframe)
+    gavl_video_frame_destroy(vframe);
+  if(aframe)
+    gavl_audio_frame_destroy(aframe);
+
+  bgav_close(b);
+  }
+
+static void bench_file(json_t * j, const char * filename)
+  {
+  bgav_t * b;
+  int i, num_audio, num_video;
+  double open_ms, select_ms;
+  gavl_time_t duration;
+
+  fprintf(stderr, "Benchmarking %s\n", filename);
+
+  json_begin_object(j, NULL);
+  json_string(j, "location", filename);
+
+  if(!(b = open_file(filename, &open_ms, &select_ms)))
+    {
+    json_int(j, "error", 1);
+    json_end_object(j);
+    return;
+    }
+
+  num_audio = bgav_num_audio_streams(b, track);
+  num_video = bgav_num_video_streams(b, track);
+  duration = bgav_get_duration(b, track);
+
+  bgav_close(b);
+
+  json_double(j, "open_ms", open_ms);
+  json_double(j, "select_track_ms", select_ms);
+  json_int(j, "audio_streams", num_audio);
+  json_int(j, "video_streams", num_video);
+
+  if(duration != GAVL_TIME_UNDEFINED)
+    json_double(j, "duration", gavl_time_to_seconds(duration));
+
+  fprintf(stderr, "  Demultiplexing\n");
+  bench_demux(j, filename);
+
+  fprintf(stderr, "  Decoding\n");
+  json_begin_array(j, "decode");
+  for(i = 0; i < num_audio; i++)
+    bench_decode_audio(j, filename, i);
+  for(i = 0; i < num_video; i++)
+    bench_decode_video(j, filename, i);
+  json_end_array(j);
+
+  fprintf(stderr, "  Seeking\n");
+  bench_seek(j, filename);
+
+  json_end_object(j);
+  }
+
+static void print_usage(void)
+  {
+  fprintf(stderr, "Usage: bgavbench [options] <location> [<location>...]\n");
+  fprintf(stderr, "-t <track>      Track (starting with 1)\n");
+  fprintf(stderr, "-seeks <num>    Number of random and sequential seeks (default: 20)\n");
+  fprintf(stderr, "-seed <num>     Seed for the random seek positions\n");
+  fprintf(stderr, "-d <seconds>    Maximum decoding time per stream\n");
+  fprintf(stderr, "-o <file>       Write JSON output to file instead of stdout\n");
+  fprintf(stderr, "-v <level>      Log verbosity\n");
+  }
+
+int main(int argc, char ** argv)
+  {
+  int i;
+  json_t j;
+  char * out_file = NULL;
+  int num_files = 0;
+
+  if(argc == 1)
+    {
+    print_usage();
+    return 0;
+    }
+
+  memset(&j, 0, sizeof(j));
+
+  /* Options come first */
+
+  i = 1;
+  while(i < argc - 1)
+    {
+    if(!strcmp(argv[i], "-t"))
+      track = atoi(argv[++i]) - 1;
+    else if(!strcmp(argv[i], "-seeks"))
+      num_seeks = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-seed"))
+      seed = strtoul(argv[++i], NULL, 10);
+    else if(!strcmp(argv[i], "-d"))
+      max_decode_time = gavl_seconds_to_time(strtod(argv[++i], NULL));
+    else if(!strcmp(argv[i], "-o"))
+      out_file = argv[++i];
+    else if(!strcmp(argv[i], "-v"))
+      gavl_set_log_verbose(atoi(argv[++i]));
+    else
+      break;
+    i++;
+    }
+
+  if(i >= argc)
+    {
+    print_usage();
+    return -1;
+    }
+
+  if(out_file)
+    {
+    if(!(j.out = fopen(out_file, "w")))
+      {
+      fprintf(stderr, "Cannot open %s\n", out_file);
+      return -1;
+      }
+    }
+  else
+    j.out = stdout;
+
+  timer = gavl_timer_create();
+  gavl_timer_start(timer);
+
+  j.first[0] = 1;
+
+  json_begin_object(&j, NULL);
+  json_string(&j, "version", BGAV_VERSION);
+  json_int(&j, "track", track + 1);
+  json_int(&j, "seeks", num_seeks);
+  json_int(&j, "seed", seed);
+
+  json_begin_array(&j, "files");
+  for(; i < argc; i++)
+    {
+    bench_file(&j, argv[i]);
+    num_files++;
+    }
+  json_end_array(&j);
+  json_end_object(&j);
+  fprintf(j.out, "\n");
+
+  if(out_file)
+    fclose(j.out);
+
+  gavl_timer_destroy(timer);
+
+  fprintf(stderr, "Benchmarked %d files\n", num_files);
+  return 0;
+  }
@@ -0,0 +1,147 @@
+/*****************************************************************
+ * gmerlin-avdecoder - a general purpose multimedia decoding library
+ *
+ * Copyright (c) 2001 - 2012 Members of the Gmerlin project
+ * gmerlin-general@lists.sourceforge.net
+ * http://gmerlin.sourceforge.net
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * *****************************************************************/
+
+/* Throughput benchmark for the bitstream reader used by the header
+   parsers. A synthetic buffer with H.264 slice header like syntax
+   elements (Exp-Golomb codes and short fixed length fields) is
+   parsed repeatedly. */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <avdec.h>
+#include <bitstream.h>
+
+#define NUM_HEADERS    100000
+#define FRAME_NUM_BITS 9
+
+typedef struct
+  {
+  uint8_t * buf;
+  int len;
+  int bits;
+  } writer_t;
+
+static void put_bits(writer_t * w, uint32_t val, int bits)
+  {
+  while(bits--)
+    {
+    if(!(w->bits & 7))
+      w->buf[w->len++] = 0;
+    if((val >> bits) & 1)
+      w->buf[w->len-1] |= 0x80 >> (w->bits & 7);
+    w->bits++;
+    }
+  }
+
+static void put_golomb_ue(writer_t * w, uint32_t val)
+  {
+  int num = 0;
+  
+  val++;
+  while((val >> num) > 1)
+    num++;
+  
+  put_bits(w, 0, num);
+  put_bits(w, val, num + 1);
+  }
+
+static void create_headers(writer_t * w)
+  {
+  int i;
+  
+  for(i = 0; i < NUM_HEADERS; i++)
+    {
+    put_golomb_ue(w, rand() % 8160); // first_mb_in_slice
+    put_golomb_ue(w, rand() % 10);   // slice_type
+    put_golomb_ue(w, rand() % 4);    // pic_parameter_set_id
+    put_bits(w, i & ((1 << FRAME_NUM_BITS)-1), FRAME_NUM_BITS); // frame_num
+    put_bits(w, rand() & 1, 1);      // field_pic_flag
+    }
+  }
+
+static int64_t parse_headers(const writer_t * w)
+  {
+  int i;
+  int64_t sum = 0;
+  bgav_bitstream_t b;
+  
+  bgav_bitstream_init(&b, w->buf, w->len);
+  
+  for(i = 0; i < NUM_HEADERS; i++)
+    {
+    sum += bgav_bitstream_get_golomb_ue_unchecked(&b);
+    sum += bgav_bitstream_get_golomb_ue_unchecked(&b);
+    sum += bgav_bitstream_get_golomb_ue_unchecked(&b);
+    sum += bgav_bitstream_get_unchecked(&b, FRAME_NUM_BITS);
+    sum += bgav_bitstream_get_unchecked(&b, 1);
+    }
+  return sum;
+  }
+
+int main(int argc, char ** argv)
+  {
+  writer_t w;
+  int i;
+  int iterations = 100;
+  int64_t sum = 0;
+  gavl_timer_t * timer;
+  double seconds;
+  
+  if(argc > 1)
+    iterations = strtol(argv[1], NULL, 10);
+
+  if(iterations <= 0)
+    {
+    fprintf(stderr, "Usage: bitstreambench [iterations]\n");
+    return -1;
+    }
+  
+  memset(&w, 0, sizeof(w));
+  /* Upper limit: 3 * 27 + FRAME_NUM_BITS + 1 bits per header */
+  w.buf = malloc(NUM_HEADERS * 16);
+  
+  srand(0);
+  create_headers(&w);
+
+  timer = gavl_timer_create();
+  gavl_timer_start(timer);
+  
+  for(i = 0; i < iterations; i++)
+    sum += parse_headers(&w);
+
+  gavl_timer_stop(timer);
+  seconds = gavl_time_to_seconds(gavl_timer_get(timer));
+  
+  printf("Parsed %d headers (%d bytes) %d times in %.3f seconds\n",
+         NUM_HEADERS, w.len, iterations, seconds);
+  printf("%.1f Mheaders/s, %.1f MB/s (checksum %"PRId64")\n",
+         (double)NUM_HEADERS * iterations / seconds / 1.0e6,
+         (double)w.len * iterations / seconds / 1.0e6,
+         sum);
+
+  gavl_timer_destroy(timer);
+  free(w.buf);
+  return 0;
+  }
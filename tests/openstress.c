@@ -0,0 +1,182 @@
+/*****************************************************************
+ * gmerlin-avdecoder - a general purpose multimedia decoding library
+ *
+ * Copyright (c) 2001 - 2012 Members of the Gmerlin project
+ * gmerlin-general@lists.sourceforge.net
+ * http://gmerlin.sourceforge.net
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * *****************************************************************/
+
+/*
+ *  Open, start and close decoders from many threads at the same time.
+ *  Catches races in the decoder initialization and shows how much the
+ *  opens are serialized.
+ */
+
+#include <avdec.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+static int num_threads = 16;
+static int num_iterations = 20;
+
+static char ** files;
+static int num_files;
+
+static pthread_mutex_t count_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int num_ok = 0;
+static int num_failed = 0;
+
+static int open_decode_close(const char * location)
+  {
+  int i;
+  int ret = 0;
+  bgav_t * file;
+  bgav_options_t * opt;
+  gavl_video_frame_t * vframe;
+  gavl_audio_frame_t * aframe;
+  
+  file = bgav_create();
+  opt = bgav_get_options(file);
+  /* Decoders must not spawn threads by themselves here */
+  bgav_options_set_threads(opt, 1);
+  
+  if(!bgav_open(file, location))
+    goto fail;
+  
+  bgav_select_track(file, 0);
+
+  for(i = 0; i < bgav_num_audio_streams(file, 0); i++)
+    bgav_set_audio_stream(file, i, BGAV_STREAM_DECODE);
+  for(i = 0; i < bgav_num_video_streams(file, 0); i++)
+    bgav_set_video_stream(file, i, BGAV_STREAM_DECODE);
+
+  if(!bgav_start(file))
+    goto fail;
+
+  /* Decode one frame of each stream */
+  
+  for(i = 0; i < bgav_num_audio_streams(file, 0); i++)
+    {
+    aframe = gavl_audio_frame_create(bgav_get_audio_format(file, i));
+    bgav_read_audio(file, aframe, i, bgav_get_audio_format(file, i)->samples_per_frame);
+    gavl_audio_frame_destroy(aframe);
+    }
+  for(i = 0; i < bgav_num_video_streams(file, 0); i++)
+    {
+    vframe = gavl_video_frame_create(bgav_get_video_format(file, i));
+    bgav_read_video(file, vframe, i);
+    gavl_video_frame_destroy(vframe);
+    }
+  
+  ret = 1;
+  fail:
+  bgav_close(file);
+  return ret;
+  }
+
+static void * thread_func(void * data)
+  {
+  int i;
+  int index = *((int*)data);
+  
+  for(i = 0; i < num_iterations; i++)
+    {
+    if(open_decode_close(files[(index + i) % num_files]))
+      {
+      pthread_mutex_lock(&count_mutex);
+      num_ok++;
+      pthread_mutex_unlock(&count_mutex);
+      }
+    else
+      {
+      pthread_mutex_lock(&count_mutex);
+      num_failed++;
+      pthread_mutex_unlock(&count_mutex);
+      }
+    }
+  return NULL;
+  }
+
+int main(int argc, char ** argv)
+  {
+  int i;
+  int arg_index;
+  pthread_t * threads;
+  int * indices;
+  gavl_timer_t * timer;
+  double seconds;
+  
+  if(argc == 1)
+    {
+    fprintf(stderr,
+            "Usage: openstress [-t threads] [-n iterations] <location1> [<location2> ...]\n");
+    return 0;
+    }
+
+  arg_index = 1;
+  
+  while(arg_index < argc - 1)
+    {
+    if(!strcmp(argv[arg_index], "-t"))
+      {
+      num_threads = strtol(argv[arg_index+1], NULL, 10);
+      arg_index+=2;
+      }
+    else if(!strcmp(argv[arg_index], "-n"))
+      {
+      num_iterations = strtol(argv[arg_index+1], NULL, 10);
+      arg_index+=2;
+      }
+    else
+      break;
+    }
+
+  files = argv + arg_index;
+  num_files = argc - arg_index;
+
+  if((num_threads < 1) || (num_iterations < 1) || (num_files < 1))
+    {
+    fprintf(stderr, "Invalid arguments\n");
+    return -1;
+    }
+  
+  threads = calloc(num_threads, sizeof(*threads));
+  indices = calloc(num_threads, sizeof(*indices));
+
+  timer = gavl_timer_create();
+  gavl_timer_start(timer);
+  
+  for(i = 0; i < num_threads; i++)
+    {
+    indices[i] = i;
+    pthread_create(&threads[i], NULL, thread_func, &indices[i]);
+    }
+  for(i = 0; i < num_threads; i++)
+    pthread_join(threads[i], NULL);
+
+  seconds = gavl_time_to_seconds(gavl_timer_get(timer));
+  gavl_timer_destroy(timer);
+  
+  fprintf(stderr, "%d threads, %d opens (%d failed) in %.2f seconds (%.1f opens/s)\n",
+          num_threads, num_ok + num_failed, num_failed, seconds,
+          (double)(num_ok + num_failed) / seconds);
+  
+  free(threads);
+  free(indices);
+  return num_failed ? -1 : 0;
+  }